@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <climits>
+
+#include "../core/allocatedpixmapindex_p.h"
+#include "../core/observer.h"
+
+// An observer that keeps the pages in [firstVisible, lastVisible] on screen
+class VisiblePagesObserver : public Okular::DocumentObserver
+{
+    public:
+        VisiblePagesObserver( int firstVisible, int lastVisible )
+            : m_firstVisible( firstVisible ), m_lastVisible( lastVisible )
+        {
+        }
+
+        bool canUnloadPixmap( int page ) const override
+        {
+            return page < m_firstVisible || page > m_lastVisible;
+        }
+
+        int m_firstVisible;
+        int m_lastVisible;
+};
+
+class AllocatedPixmapIndexTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testFarthestPixmap();
+        void testTakeAndRemoveObserver();
+        void benchmarkEviction();
+};
+
+void AllocatedPixmapIndexTest::testFarthestPixmap()
+{
+    VisiblePagesObserver pageView( 10, 12 );
+    VisiblePagesObserver thumbnails( 0, 20 );
+
+    Okular::AllocatedPixmapIndex index;
+    for ( int page = 0; page < 30; ++page )
+    {
+        index.insert( new AllocatedPixmap( &pageView, page, 100 ) );
+        if ( page % 2 == 0 )
+            index.insert( new AllocatedPixmap( &thumbnails, page, 10 ) );
+    }
+    QCOMPARE( index.count(), 45 );
+
+    // page 0 is 11 pages away from the viewport, page 29 is 18 pages away
+    AllocatedPixmap *p = index.farthestPixmap( 11, false );
+    QCOMPARE( p->page, 29 );
+    QCOMPARE( p->observer, &pageView );
+
+    // seen from the end of the document page 0 is the farthest one
+    p = index.farthestPixmap( 29, false, &thumbnails );
+    QCOMPARE( p->page, 0 );
+    QCOMPARE( p->observer, &thumbnails );
+
+    // all thumbnails are visible but the ones after page 20
+    p = index.farthestPixmap( 0, true, &thumbnails );
+    QCOMPARE( p->page, 28 );
+    p = index.farthestPixmap( 25, true, &thumbnails );
+    QCOMPARE( p->page, 22 );
+
+    // evicting everything unloadable must leave only the visible pixmaps,
+    // always in decreasing distance order
+    int lastDistance = INT_MAX;
+    while ( ( p = index.farthestPixmap( 11, true ) ) )
+    {
+        const int distance = qAbs( p->page - 11 );
+        QVERIFY( distance <= lastDistance );
+        lastDistance = distance;
+        index.remove( p );
+        delete p;
+    }
+    QCOMPARE( index.count(), 3 + 11 );
+}
+
+void AllocatedPixmapIndexTest::testTakeAndRemoveObserver()
+{
+    VisiblePagesObserver pageView( 0, 0 );
+    VisiblePagesObserver presentation( 0, 0 );
+
+    Okular::AllocatedPixmapIndex index;
+    for ( int page = 0; page < 10; ++page )
+    {
+        index.insert( new AllocatedPixmap( &pageView, page, 100 ) );
+        index.insert( new AllocatedPixmap( &presentation, page, 100 ) );
+    }
+
+    AllocatedPixmap *p = index.take( &pageView, 5 );
+    QVERIFY( p );
+    QCOMPARE( p->page, 5 );
+    QCOMPARE( p->observer, &pageView );
+    delete p;
+    QVERIFY( !index.take( &pageView, 5 ) );
+    QCOMPARE( index.count(), 19 );
+
+    index.removeObserver( &presentation );
+    QCOMPARE( index.count(), 9 );
+    QCOMPARE( index.farthestPixmap( 0, false, &presentation ), static_cast< AllocatedPixmap * >( nullptr ) );
+    QCOMPARE( index.farthestPixmap( 0, false )->observer, &pageView );
+
+    index.clear();
+    QVERIFY( index.isEmpty() );
+}
+
+void AllocatedPixmapIndexTest::benchmarkEviction()
+{
+    // 10k pixmaps split between a page view, a thumbnail list and a
+    // presentation, evicted one at a time as DocumentPrivate::cleanupPixmapMemory() does
+    VisiblePagesObserver pageView( 4998, 5002 );
+    VisiblePagesObserver thumbnails( 4990, 5010 );
+    VisiblePagesObserver presentation( 5000, 5000 );
+    Okular::DocumentObserver *observers[] = { &pageView, &thumbnails, &presentation };
+
+    Okular::AllocatedPixmapIndex index;
+    QBENCHMARK
+    {
+        for ( int i = 0; i < 10000; ++i )
+            index.insert( new AllocatedPixmap( observers[ i % 3 ], i, 4 * 1000 * 1400 ) );
+
+        AllocatedPixmap *p;
+        while ( ( p = index.farthestPixmap( 5000, true ) ) )
+        {
+            index.remove( p );
+            delete p;
+        }
+
+        index.clear();
+    }
+}
+
+QTEST_MAIN( AllocatedPixmapIndexTest )
+#include "allocatedpixmapindextest.moc"
@@ -31,6 +31,35 @@ class DocumentTest
     private slots:
         void testCloseDuringRotationJob();
         void testDocdataMigration();
+        void testPreviewBeforeFullRender();
+        void testOutdatedPreviewDropped();
+        void testPreviewDoesNotCancelRunningRequest();
+};
+
+// Records the sizes of the pixmaps the pages get, out of a list of expected ones
+class PixmapSizesObserver : public Okular::DocumentObserver
+{
+    public:
+        PixmapSizesObserver( Okular::Document *document, const QList<QSize> &sizes )
+            : m_document( document ), m_sizes( sizes )
+        {
+        }
+
+        void notifyPageChanged( int page, int flags ) override
+        {
+            if ( !( flags & Pixmap ) )
+                return;
+
+            for ( const QSize &size : qAsConst( m_sizes ) )
+            {
+                if ( m_document->page( page )->hasPixmap( this, size.width(), size.height() ) )
+                    m_received << qMakePair( page, size );
+            }
+        }
+
+        Okular::Document *m_document;
+        QList<QSize> m_sizes;
+        QList< QPair<int, QSize> > m_received;
 };
 
 // Test that we don't crash if the document is closed while a RotationJob
@@ -129,5 +158,108 @@ void DocumentTest::testDocdataMigration()
     delete m_document;
 }
 
+// Test that a large asynchronous request gets a low resolution preview of the
+// page that is rendered before it
+void DocumentTest::testPreviewBeforeFullRender()
+{
+    Okular::SettingsCore::instance( QStringLiteral("documenttest") );
+    Okular::Document *m_document = new Okular::Document( nullptr );
+    const QString testFile = QStringLiteral(KDESRCDIR "data/file1.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+    QCOMPARE( m_document->openDocument( testFile, QUrl(), mime ), Okular::Document::OpenSuccess );
+
+    PixmapSizesObserver *observer = new PixmapSizesObserver( m_document, QList<QSize>() << QSize( 125, 125 ) << QSize( 1000, 1000 ) );
+    m_document->addObserver( observer );
+
+    Okular::PixmapRequest *pixmapReq = new Okular::PixmapRequest(
+        observer, 0, 1000, 1000, 1, Okular::PixmapRequest::Asynchronous );
+    m_document->requestPixmaps( QLinkedList<Okular::PixmapRequest*>() << pixmapReq );
+
+    QTRY_VERIFY( m_document->page( 0 )->hasPixmap( observer, 1000, 1000 ) );
+    const QList< QPair<int, QSize> > expected = QList< QPair<int, QSize> >() << qMakePair( 0, QSize( 125, 125 ) ) << qMakePair( 0, QSize( 1000, 1000 ) );
+    QCOMPARE( observer->m_received, expected );
+
+    m_document->removeObserver( observer );
+    delete m_document;
+    delete observer;
+}
+
+// Test that a preview whose page got a pixmap at least as large while it was
+// queued is not rendered, nor replaces that pixmap
+void DocumentTest::testOutdatedPreviewDropped()
+{
+    Okular::SettingsCore::instance( QStringLiteral("documenttest") );
+    Okular::Document *m_document = new Okular::Document( nullptr );
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+    QCOMPARE( m_document->openDocument( testFile, QUrl(), mime ), Okular::Document::OpenSuccess );
+
+    PixmapSizesObserver *observer = new PixmapSizesObserver( m_document, QList<QSize>() << QSize( 100, 100 ) << QSize( 400, 400 ) );
+    m_document->addObserver( observer );
+
+    // small enough not to get a preview of its own
+    Okular::PixmapRequest *pixmapReq = new Okular::PixmapRequest(
+        observer, 0, 400, 400, 1, Okular::PixmapRequest::Asynchronous );
+    m_document->requestPixmaps( QLinkedList<Okular::PixmapRequest*>() << pixmapReq );
+    QTRY_VERIFY( m_document->page( 0 )->hasPixmap( observer, 400, 400 ) );
+    observer->m_received.clear();
+
+    // requests of the same priority are served in order, so the preview has
+    // been handled once the pixmap of the second page is there
+    Okular::PixmapRequest *previewReq = new Okular::PixmapRequest(
+        observer, 0, 100, 100, 1, Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Preview );
+    Okular::PixmapRequest *otherPageReq = new Okular::PixmapRequest(
+        observer, 1, 100, 100, 1, Okular::PixmapRequest::Asynchronous );
+    m_document->requestPixmaps( QLinkedList<Okular::PixmapRequest*>() << previewReq << otherPageReq );
+
+    QTRY_VERIFY( m_document->page( 1 )->hasPixmap( observer, 100, 100 ) );
+    const QList< QPair<int, QSize> > expected = QList< QPair<int, QSize> >() << qMakePair( 1, QSize( 100, 100 ) );
+    QCOMPARE( observer->m_received, expected );
+    QVERIFY( m_document->page( 0 )->hasPixmap( observer, 400, 400 ) );
+
+    m_document->removeObserver( observer );
+    delete m_document;
+    delete observer;
+}
+
+// Test that requesting a preview of a page doesn't cancel the render of that
+// page that is running
+void DocumentTest::testPreviewDoesNotCancelRunningRequest()
+{
+    Okular::SettingsCore::instance( QStringLiteral("documenttest") );
+    Okular::Document *m_document = new Okular::Document( nullptr );
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+    QCOMPARE( m_document->openDocument( testFile, QUrl(), mime ), Okular::Document::OpenSuccess );
+
+    PixmapSizesObserver *observer = new PixmapSizesObserver( m_document, QList<QSize>() << QSize( 100, 100 ) << QSize( 400, 400 ) );
+    m_document->addObserver( observer );
+
+    // the render runs in a thread, it is still executing when the preview
+    // comes since its end is handled in the event loop
+    Okular::PixmapRequest *pixmapReq = new Okular::PixmapRequest(
+        observer, 0, 400, 400, 1, Okular::PixmapRequest::Asynchronous );
+    m_document->requestPixmaps( QLinkedList<Okular::PixmapRequest*>() << pixmapReq );
+    Okular::PixmapRequest *previewReq = new Okular::PixmapRequest(
+        observer, 0, 100, 100, 1, Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Preview );
+    Okular::PixmapRequest *otherPageReq = new Okular::PixmapRequest(
+        observer, 1, 100, 100, 1, Okular::PixmapRequest::Asynchronous );
+    m_document->requestPixmaps( QLinkedList<Okular::PixmapRequest*>() << previewReq << otherPageReq, Okular::Document::NoOption );
+
+    // the full render is not cancelled, and the preview queued after it is
+    // outdated by then
+    QTRY_VERIFY( m_document->page( 1 )->hasPixmap( observer, 100, 100 ) );
+    QVERIFY( m_document->page( 0 )->hasPixmap( observer, 400, 400 ) );
+    const QList< QPair<int, QSize> > expected = QList< QPair<int, QSize> >() << qMakePair( 0, QSize( 400, 400 ) ) << qMakePair( 1, QSize( 100, 100 ) );
+    QCOMPARE( observer->m_received, expected );
+
+    m_document->removeObserver( observer );
+    delete m_document;
+    delete observer;
+}
+
 QTEST_MAIN( DocumentTest )
 #include "documenttest.moc"
@@ -0,0 +1,139 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QImage>
+#include <QPainter>
+
+#include <random>
+
+#include "../core/utils.h"
+#include "../settings_core.h"
+
+// Looks at every pixel, as reference
+static Okular::NormalizedRect referenceBoundingBox( const QImage &image )
+{
+    const QRgb paperColor = Okular::SettingsCore::paperColor().rgb() & 0xFFFFFF;
+    QRect box;
+    for ( int y = 0; y < image.height(); ++y )
+    {
+        for ( int x = 0; x < image.width(); ++x )
+        {
+            if ( ( image.pixel( x, y ) & 0xFFFFFF ) != paperColor )
+                box |= QRect( x, y, 1, 1 );
+        }
+    }
+    if ( box.isNull() )
+        return Okular::NormalizedRect( 0, 0, 0, 0 );
+    return Okular::NormalizedRect( box, image.width(), image.height() );
+}
+
+class ImageBoundingBoxTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void testBoundingBox_data();
+        void testBoundingBox();
+        void testRandomDots();
+        void benchmarkBoundingBox_data();
+        void benchmarkBoundingBox();
+};
+
+void ImageBoundingBoxTest::initTestCase()
+{
+    Okular::SettingsCore::instance( QStringLiteral( "imageboundingboxtest" ) );
+}
+
+void ImageBoundingBoxTest::testBoundingBox_data()
+{
+    QTest::addColumn<int>( "format" );
+    QTest::addColumn<QSize>( "size" );
+    QTest::addColumn<QRect>( "content" );
+
+    const QList<int> formats = { QImage::Format_RGB32, QImage::Format_ARGB32, QImage::Format_ARGB32_Premultiplied, QImage::Format_Mono };
+    for ( int format : formats )
+    {
+        const QByteArray name = QByteArray::number( format ) + ' ';
+        QTest::newRow( ( name + "blank" ).constData() ) << format << QSize( 100, 100 ) << QRect();
+        QTest::newRow( ( name + "single pixel" ).constData() ) << format << QSize( 101, 99 ) << QRect( 37, 51, 1, 1 );
+        QTest::newRow( ( name + "corner" ).constData() ) << format << QSize( 100, 100 ) << QRect( 99, 99, 1, 1 );
+        QTest::newRow( ( name + "whole image" ).constData() ) << format << QSize( 33, 17 ) << QRect( 0, 0, 33, 17 );
+        // thin lines between the rows the first pass looks at
+        QTest::newRow( ( name + "thin line on top" ).constData() ) << format << QSize( 600, 800 ) << QRect( 10, 3, 500, 1 );
+        QTest::newRow( ( name + "thin line at the bottom" ).constData() ) << format << QSize( 600, 800 ) << QRect( 20, 797, 500, 1 );
+        QTest::newRow( ( name + "page" ).constData() ) << format << QSize( 1241, 1754 ) << QRect( 120, 150, 1001, 1451 );
+    }
+}
+
+void ImageBoundingBoxTest::testBoundingBox()
+{
+    QFETCH( int, format );
+    QFETCH( QSize, size );
+    QFETCH( QRect, content );
+
+    QImage image( size, QImage::Format_ARGB32 );
+    image.fill( Qt::white );
+    QPainter p( &image );
+    p.fillRect( content, Qt::black );
+    p.end();
+    image = image.convertToFormat( static_cast<QImage::Format>( format ) );
+
+    const Okular::NormalizedRect expected = content.isNull() ? Okular::NormalizedRect( 0, 0, 0, 0 ) : Okular::NormalizedRect( content, size.width(), size.height() );
+    QCOMPARE( Okular::Utils::imageBoundingBox( &image ), expected );
+}
+
+void ImageBoundingBoxTest::testRandomDots()
+{
+    std::mt19937 random( 42 );
+    for ( int i = 0; i < 500; ++i )
+    {
+        const QImage::Format format = ( i % 2 ) ? QImage::Format_ARGB32 : QImage::Format_ARGB32_Premultiplied;
+        QImage image( 1 + random() % 70, 1 + random() % ( i % 5 ? 70 : 1200 ), format );
+        image.fill( Qt::white );
+        const int dots = random() % 5;
+        for ( int j = 0; j < dots; ++j )
+        {
+            // semi transparent dots too, to check the premultiplied colors
+            const QRgb color = ( j % 2 ) ? qRgba( 128, 128, 128, 128 ) : qRgb( random() % 256, random() % 256, random() % 256 );
+            image.setPixel( random() % image.width(), random() % image.height(), color );
+        }
+        QCOMPARE( Okular::Utils::imageBoundingBox( &image ), referenceBoundingBox( image ) );
+    }
+}
+
+void ImageBoundingBoxTest::benchmarkBoundingBox_data()
+{
+    QTest::addColumn<QRect>( "content" );
+
+    QTest::newRow( "margins" ) << QRect( 120, 150, 1001, 1451 );
+    QTest::newRow( "wide margins" ) << QRect( 500, 700, 200, 300 );
+    QTest::newRow( "blank" ) << QRect();
+}
+
+void ImageBoundingBoxTest::benchmarkBoundingBox()
+{
+    QFETCH( QRect, content );
+
+    // an A4 page at 150 dpi
+    QImage image( 1241, 1754, QImage::Format_ARGB32 );
+    image.fill( Qt::white );
+    QPainter p( &image );
+    p.fillRect( content, Qt::black );
+    p.end();
+
+    QBENCHMARK {
+        Okular::Utils::imageBoundingBox( &image );
+    }
+}
+
+QTEST_MAIN( ImageBoundingBoxTest )
+#include "imageboundingboxtest.moc"
@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <limits>
+#include <random>
+
+#include "../core/area.h"
+#include "../core/page.h"
+
+static const double distanceConsideredEqual = 25; // as in Page
+
+// The hit testing Page did before the index, walking all the rects
+static const Okular::ObjectRect *referenceObjectRect( const QLinkedList< Okular::ObjectRect * > &rects, Okular::ObjectRect::ObjectType type, double x, double y, double xScale, double yScale )
+{
+    QLinkedListIterator< Okular::ObjectRect * > it( rects );
+    it.toBack();
+    while ( it.hasPrevious() )
+    {
+        const Okular::ObjectRect *objrect = it.previous();
+        if ( ( objrect->objectType() == type ) && objrect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
+            return objrect;
+    }
+    return nullptr;
+}
+
+// A map like page: a grid of small links, some of them overlapping, and a few images
+static QLinkedList< Okular::ObjectRect * > mapRects( int count, std::mt19937 &random )
+{
+    QLinkedList< Okular::ObjectRect * > rects;
+    std::uniform_real_distribution< double > position( -0.05, 1.0 );
+    std::uniform_real_distribution< double > size( 0.001, 0.03 );
+    for ( int i = 0; i < count; ++i )
+    {
+        const double x = position( random ), y = position( random );
+        const Okular::ObjectRect::ObjectType type = i % 50 == 0 ? Okular::ObjectRect::Image : Okular::ObjectRect::Action;
+        rects.append( new Okular::ObjectRect( x, y, x + size( random ), y + size( random ), i % 7 == 0, type, nullptr ) );
+    }
+    return rects;
+}
+
+class ObjectRectIndexTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testSameAsWalking_data();
+        void testSameAsWalking();
+        void testForegroundFirst();
+};
+
+void ObjectRectIndexTest::testSameAsWalking_data()
+{
+    QTest::addColumn<int>( "count" );
+
+    QTest::newRow( "few" ) << 10;
+    QTest::newRow( "many" ) << 5000;
+}
+
+void ObjectRectIndexTest::testSameAsWalking()
+{
+    QFETCH( int, count );
+
+    std::mt19937 random( count );
+    Okular::Page page( 0, 1000, 1000, Okular::Rotation0 );
+    const QLinkedList< Okular::ObjectRect * > rects = mapRects( count, random );
+    page.setObjectRects( rects );
+
+    std::uniform_real_distribution< double > position( -0.1, 1.1 );
+    for ( int i = 0; i < 2000; ++i )
+    {
+        const double x = position( random ), y = position( random );
+        const double scale = i % 2 ? 1000 : 250;
+        for ( Okular::ObjectRect::ObjectType type : { Okular::ObjectRect::Action, Okular::ObjectRect::Image } )
+        {
+            const Okular::ObjectRect *expected = referenceObjectRect( rects, type, x, y, scale, scale );
+            QCOMPARE( page.objectRect( type, x, y, scale, scale ), expected );
+            QCOMPARE( page.objectRects( type, x, y, scale, scale ).isEmpty(), expected == nullptr );
+            if ( expected )
+            {
+                QCOMPARE( page.objectRects( type, x, y, scale, scale ).first(), expected );
+                QVERIFY( page.hasObjectRect( x, y, scale, scale ) );
+            }
+        }
+    }
+}
+
+void ObjectRectIndexTest::testForegroundFirst()
+{
+    Okular::Page page( 0, 1000, 1000, Okular::Rotation0 );
+    QLinkedList< Okular::ObjectRect * > rects;
+    // enough rects for the grid, all of them below the point
+    for ( int i = 0; i < 100; ++i )
+        rects.append( new Okular::ObjectRect( 0.1, 0.1, 0.2 + i * 0.001, 0.2, false, Okular::ObjectRect::Action, nullptr ) );
+    page.setObjectRects( rects );
+
+    QCOMPARE( page.objectRect( Okular::ObjectRect::Action, 0.15, 0.15, 1000, 1000 ), rects.last() );
+    const QLinkedList< const Okular::ObjectRect * > found = page.objectRects( Okular::ObjectRect::Action, 0.15, 0.15, 1000, 1000 );
+    QCOMPARE( found.count(), 100 );
+    QCOMPARE( found.first(), rects.last() );
+    QCOMPARE( found.last(), rects.first() );
+
+    // nearest keeps preferring the background on ties
+    double distance = -1;
+    QCOMPARE( page.nearestObjectRect( Okular::ObjectRect::Action, 0.05, 0.15, 1000, 1000, &distance ), rects.first() );
+    QCOMPARE( distance, 2500.0 );
+
+    // replacing the rects must not return the old ones
+    const QLinkedList< Okular::ObjectRect * > others = { new Okular::ObjectRect( 0.5, 0.5, 0.6, 0.6, false, Okular::ObjectRect::Action, nullptr ) };
+    page.setObjectRects( others );
+    QCOMPARE( page.objectRect( Okular::ObjectRect::Action, 0.15, 0.15, 1000, 1000 ), static_cast< const Okular::ObjectRect * >( nullptr ) );
+    QCOMPARE( page.objectRect( Okular::ObjectRect::Action, 0.55, 0.55, 1000, 1000 ), others.first() );
+}
+
+QTEST_MAIN( ObjectRectIndexTest )
+#include "objectrectindextest.moc"
@@ -0,0 +1,250 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QColor>
+#include <QImage>
+
+#include <random>
+
+#include "../ui/pagepainterkernels.h"
+
+// The per pixel loops PagePainter used before the kernels, as reference
+
+static inline int qt_div_255( int x ) { return ( x + ( x >> 8 ) + 0x80 ) >> 8; }
+
+static void referenceRecolor( QImage *image, const QColor &foreground, const QColor &background )
+{
+    const float scaleRed = background.redF() - foreground.redF();
+    const float scaleGreen = background.greenF() - foreground.greenF();
+    const float scaleBlue = background.blueF() - foreground.blueF();
+
+    for ( int y = 0; y < image->height(); y++ )
+    {
+        QRgb *pixels = reinterpret_cast<QRgb*>( image->scanLine( y ) );
+        for ( int x = 0; x < image->width(); x++ )
+        {
+            const int lightness = qGray( pixels[x] );
+            pixels[x] = qRgba( scaleRed * lightness + foreground.red(),
+                               scaleGreen * lightness + foreground.green(),
+                               scaleBlue * lightness + foreground.blue(),
+                               qAlpha( pixels[x] ) );
+        }
+    }
+}
+
+static void referenceBlackWhite( QImage *image, int con, int thr )
+{
+    unsigned int * data = (unsigned int *)image->bits();
+    const int pixels = image->width() * image->height();
+    for ( int i = 0; i < pixels; ++i )
+    {
+        int val = qGray( data[i] );
+        if ( val > thr )
+            val = 128 + (127 * (val - thr)) / (255 - thr);
+        else if ( val < thr )
+            val = (128 * val) / thr;
+        if ( con > 2 )
+        {
+            val = con * ( val - thr ) / 2 + thr;
+            if ( val > 255 )
+                val = 255;
+            else if ( val < 0 )
+                val = 0;
+        }
+        data[i] = qRgba( val, val, val, 255 );
+    }
+}
+
+static void referenceChangeAlpha( QImage *image, unsigned int destAlpha )
+{
+    unsigned int * data = (unsigned int *)image->bits();
+    const unsigned int pixels = image->width() * image->height();
+    for ( unsigned int i = 0; i < pixels; ++i )
+    {
+        const int source = data[i];
+        int sourceAlpha = qAlpha( source );
+        if ( sourceAlpha == 255 )
+            data[i] = qRgba( qRed(source), qGreen(source), qBlue(source), destAlpha );
+        else
+            data[i] = qRgba( qRed(source), qGreen(source), qBlue(source), qt_div_255( destAlpha * sourceAlpha ) );
+    }
+}
+
+static QImage randomImage( int width, int height )
+{
+    QImage image( width, height, QImage::Format_ARGB32_Premultiplied );
+    std::mt19937 random( width * 1000 + height );
+    for ( int y = 0; y < height; ++y )
+    {
+        QRgb *pixels = reinterpret_cast<QRgb*>( image.scanLine( y ) );
+        for ( int x = 0; x < width; ++x )
+        {
+            // make sure fully opaque and transparent pixels are there too
+            const QRgb color = random();
+            pixels[x] = ( x % 7 == 0 ) ? ( color | 0xff000000 ) : ( x % 11 == 0 ) ? ( color & 0x00ffffff ) : color;
+        }
+    }
+    return image;
+}
+
+class PagePainterKernelsTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void cleanup();
+        void testRecolor_data();
+        void testRecolor();
+        void testBlackWhite_data();
+        void testBlackWhite();
+        void testChangeAlpha_data();
+        void testChangeAlpha();
+        void benchmarkKernels_data();
+        void benchmarkKernels();
+
+    private:
+        void addImplementationColumns();
+};
+
+void PagePainterKernelsTest::cleanup()
+{
+    PagePainterKernels::setSimdEnabled( true );
+}
+
+void PagePainterKernelsTest::addImplementationColumns()
+{
+    QTest::addColumn<bool>( "simd" );
+    QTest::addColumn<int>( "width" );
+    QTest::addColumn<int>( "height" );
+
+    // odd sizes exercise the scalar tails of the vectorized loops
+    const QList<QSize> sizes = { QSize( 1, 1 ), QSize( 3, 5 ), QSize( 8, 2 ), QSize( 17, 13 ), QSize( 256, 256 ) };
+    for ( bool simd : { false, true } )
+    {
+        for ( const QSize &size : sizes )
+        {
+            const QByteArray name = QByteArray( simd ? "simd " : "scalar " ) + QByteArray::number( size.width() ) + 'x' + QByteArray::number( size.height() );
+            QTest::newRow( name.constData() ) << simd << size.width() << size.height();
+        }
+    }
+}
+
+void PagePainterKernelsTest::testRecolor_data()
+{
+    addImplementationColumns();
+}
+
+void PagePainterKernelsTest::testRecolor()
+{
+    QFETCH( bool, simd );
+    QFETCH( int, width );
+    QFETCH( int, height );
+
+    PagePainterKernels::setSimdEnabled( simd );
+    const QList<QPair<QColor, QColor>> colors = { { Qt::black, Qt::white }, { Qt::white, Qt::black },
+                                                  { QColor( 20, 40, 200 ), QColor( 250, 10, 100 ) } };
+    for ( const QPair<QColor, QColor> &c : colors )
+    {
+        QImage image = randomImage( width, height );
+        QImage expected = image;
+        PagePainterKernels::recolor( &image, c.first, c.second );
+        referenceRecolor( &expected, c.first, c.second );
+        QCOMPARE( image, expected );
+    }
+}
+
+void PagePainterKernelsTest::testBlackWhite_data()
+{
+    addImplementationColumns();
+}
+
+void PagePainterKernelsTest::testBlackWhite()
+{
+    QFETCH( bool, simd );
+    QFETCH( int, width );
+    QFETCH( int, height );
+
+    PagePainterKernels::setSimdEnabled( simd );
+    for ( int contrast : { 2, 4, 6 } )
+    {
+        for ( int threshold : { 0, 1, 127, 254, 255 } )
+        {
+            QImage image = randomImage( width, height );
+            QImage expected = image;
+            PagePainterKernels::blackWhite( &image, contrast, threshold );
+            referenceBlackWhite( &expected, contrast, threshold );
+            QCOMPARE( image, expected );
+        }
+    }
+}
+
+void PagePainterKernelsTest::testChangeAlpha_data()
+{
+    addImplementationColumns();
+}
+
+void PagePainterKernelsTest::testChangeAlpha()
+{
+    QFETCH( bool, simd );
+    QFETCH( int, width );
+    QFETCH( int, height );
+
+    PagePainterKernels::setSimdEnabled( simd );
+    for ( unsigned int alpha : { 0u, 1u, 100u, 254u, 255u } )
+    {
+        QImage image = randomImage( width, height );
+        QImage expected = image;
+        PagePainterKernels::changeAlpha( &image, alpha );
+        referenceChangeAlpha( &expected, alpha );
+        QCOMPARE( image, expected );
+    }
+}
+
+void PagePainterKernelsTest::benchmarkKernels_data()
+{
+    QTest::addColumn<QString>( "kernel" );
+    QTest::addColumn<bool>( "simd" );
+
+    for ( const QString &kernel : { QStringLiteral( "reference" ), QStringLiteral( "recolor" ), QStringLiteral( "blackwhite" ), QStringLiteral( "alpha" ) } )
+    {
+        for ( bool simd : { false, true } )
+        {
+            if ( kernel == QLatin1String( "reference" ) && simd )
+                continue;
+            const QByteArray name = kernel.toLatin1() + ( simd ? " simd" : " scalar" );
+            QTest::newRow( name.constData() ) << kernel << simd;
+        }
+    }
+}
+
+void PagePainterKernelsTest::benchmarkKernels()
+{
+    QFETCH( QString, kernel );
+    QFETCH( bool, simd );
+
+    PagePainterKernels::setSimdEnabled( simd );
+    // a 4K screen full of page
+    QImage image = randomImage( 3840, 2160 );
+
+    QBENCHMARK {
+        if ( kernel == QLatin1String( "reference" ) )
+            referenceRecolor( &image, Qt::white, Qt::black );
+        else if ( kernel == QLatin1String( "recolor" ) )
+            PagePainterKernels::recolor( &image, Qt::white, Qt::black );
+        else if ( kernel == QLatin1String( "blackwhite" ) )
+            PagePainterKernels::blackWhite( &image, 4, 127 );
+        else
+            PagePainterKernels::changeAlpha( &image, 200 );
+    }
+}
+
+QTEST_MAIN( PagePainterKernelsTest )
+#include "pagepainterkernelstest.moc"
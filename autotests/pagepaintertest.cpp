@@ -0,0 +1,214 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QPainter>
+#include <QPixmap>
+
+#include "../core/observer.h"
+#include "../core/page.h"
+#include "../ui/pagepainter.h"
+#include "../settings.h"
+#include "../settings_core.h"
+
+static const int pageWidth = 1200;
+static const int pageHeight = 1600;
+
+// A pixmap made of four solid quadrants, so that rescaled samples can be checked
+static QPixmap quadrantsPixmap( int width, int height )
+{
+    QImage image( width, height, QImage::Format_ARGB32_Premultiplied );
+    QPainter p( &image );
+    p.fillRect( 0, 0, width / 2, height / 2, Qt::red );
+    p.fillRect( width / 2, 0, width - width / 2, height / 2, Qt::green );
+    p.fillRect( 0, height / 2, width / 2, height - height / 2, Qt::blue );
+    p.fillRect( width / 2, height / 2, width - width / 2, height - height / 2, Qt::yellow );
+    p.end();
+    return QPixmap::fromImage( image );
+}
+
+// A checkerboard of differently colored cells, so that there are many
+// borders where the rescaled samples of different colors meet
+static QPixmap checkerboardPixmap( int width, int height )
+{
+    const int cells = 24;
+    QImage image( width, height, QImage::Format_ARGB32_Premultiplied );
+    QPainter p( &image );
+    for ( int row = 0; row < cells; ++row )
+    {
+        for ( int column = 0; column < cells; ++column )
+        {
+            const QRect cell( QPoint( column * width / cells, row * height / cells ),
+                              QPoint( ( column + 1 ) * width / cells - 1, ( row + 1 ) * height / cells - 1 ) );
+            p.fillRect( cell, QColor( column * 255 / cells, row * 255 / cells, ( row + column ) % 2 ? 255 : 0 ) );
+        }
+    }
+    p.end();
+    return QPixmap::fromImage( image );
+}
+
+// Whether the colors of @p a and @p b differ no more than @p tolerance in each channel
+static bool fuzzyComparePixel( QRgb a, QRgb b, int tolerance )
+{
+    return qAbs( qRed( a ) - qRed( b ) ) <= tolerance && qAbs( qGreen( a ) - qGreen( b ) ) <= tolerance &&
+           qAbs( qBlue( a ) - qBlue( b ) ) <= tolerance && qAbs( qAlpha( a ) - qAlpha( b ) ) <= tolerance;
+}
+
+class PagePainterTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void testCroppedPaint_data();
+        void testCroppedPaint();
+        void testColorTransform();
+        void benchmarkPaint_data();
+        void benchmarkPaint();
+
+    private:
+        QImage paint( Okular::Page *page, Okular::DocumentObserver *observer, const QRect &limits );
+};
+
+void PagePainterTest::initTestCase()
+{
+    Okular::Settings::instance( QStringLiteral( "pagepaintertest" ) );
+}
+
+QImage PagePainterTest::paint( Okular::Page *page, Okular::DocumentObserver *observer, const QRect &limits )
+{
+    QImage result( limits.size(), QImage::Format_ARGB32_Premultiplied );
+    QPainter p( &result );
+    p.translate( -limits.topLeft() );
+    PagePainter::paintPageOnPainter( &p, page, observer, 0, pageWidth, pageHeight, limits );
+    p.end();
+    return result;
+}
+
+void PagePainterTest::testCroppedPaint_data()
+{
+    QTest::addColumn<int>( "pixmapWidth" );
+    QTest::addColumn<int>( "pixmapHeight" );
+    QTest::addColumn<QRect>( "limits" );
+
+    QTest::newRow( "exact size, small area" ) << pageWidth << pageHeight << QRect( 550, 750, 100, 100 );
+    QTest::newRow( "exact size, whole page" ) << pageWidth << pageHeight << QRect( 0, 0, pageWidth, pageHeight );
+    QTest::newRow( "upscaled, small area" ) << pageWidth / 2 << pageHeight / 2 << QRect( 550, 750, 100, 100 );
+    QTest::newRow( "upscaled, whole page" ) << pageWidth / 2 << pageHeight / 2 << QRect( 0, 0, pageWidth, pageHeight );
+    QTest::newRow( "upscaled, unaligned area" ) << pageWidth / 3 << pageHeight / 3 << QRect( 333, 517, 211, 97 );
+    QTest::newRow( "downscaled, small area" ) << pageWidth * 2 << pageHeight * 2 << QRect( 550, 750, 100, 100 );
+    QTest::newRow( "downscaled, whole page" ) << pageWidth * 2 << pageHeight * 2 << QRect( 0, 0, pageWidth, pageHeight );
+}
+
+void PagePainterTest::testCroppedPaint()
+{
+    QFETCH( int, pixmapWidth );
+    QFETCH( int, pixmapHeight );
+    QFETCH( QRect, limits );
+
+    Okular::DocumentObserver observer;
+    Okular::Page page( 0, pageWidth, pageHeight, Okular::Rotation0 );
+    const QPixmap pixmap = checkerboardPixmap( pixmapWidth, pixmapHeight );
+    page.setPixmap( &observer, new QPixmap( pixmap ) );
+
+    // the former painting path: the whole page pixmap rescaled to the page
+    // size, then cropped to the painted area
+    const QImage expected = pixmap.scaled( pageWidth, pageHeight ).copy( limits ).toImage()
+                            .convertToFormat( QImage::Format_ARGB32_Premultiplied );
+
+    // the second paint may use the rescaled pixmap kept by the first one
+    for ( int i = 0; i < 2; ++i )
+    {
+        const QImage result = paint( &page, &observer, limits );
+        QCOMPARE( result.size(), expected.size() );
+
+        // rescaling only the painted part may sample a neighbour of the
+        // former sample, next to the cell borders
+        for ( int y = 0; y < result.height(); ++y )
+        {
+            for ( int x = 0; x < result.width(); ++x )
+            {
+                const QRgb pixel = result.pixel( x, y );
+                bool matches = false;
+                for ( int dy = -1; dy <= 1 && !matches; ++dy )
+                {
+                    for ( int dx = -1; dx <= 1 && !matches; ++dx )
+                    {
+                        const QPoint neighbour( x + dx, y + dy );
+                        matches = expected.rect().contains( neighbour ) && fuzzyComparePixel( pixel, expected.pixel( neighbour ), 2 );
+                    }
+                }
+                if ( !matches )
+                    QFAIL( qPrintable( QStringLiteral( "Pixel %1,%2 is %3, expected %4" ).arg( x ).arg( y )
+                                       .arg( pixel, 8, 16 ).arg( expected.pixel( x, y ), 8, 16 ) ) );
+            }
+        }
+    }
+}
+
+void PagePainterTest::testColorTransform()
+{
+    Okular::DocumentObserver observer;
+    Okular::Page page( 0, pageWidth, pageHeight, Okular::Rotation0 );
+    page.setPixmap( &observer, new QPixmap( quadrantsPixmap( pageWidth, pageHeight ) ) );
+    const QRect limits( 0, 0, pageWidth, pageHeight );
+    const QPoint red( pageWidth / 4, pageHeight / 4 ), yellow( pageWidth * 3 / 4, pageHeight * 3 / 4 );
+
+    Okular::SettingsCore::setChangeColors( true );
+    Okular::SettingsCore::setRenderMode( Okular::SettingsCore::EnumRenderMode::Inverted );
+
+    // painting again reuses the transformed pixmap
+    for ( int i = 0; i < 2; ++i )
+    {
+        QImage result( limits.size(), QImage::Format_ARGB32_Premultiplied );
+        QPainter p( &result );
+        PagePainter::paintPageOnPainter( &p, &page, &observer, PagePainter::Accessibility, pageWidth, pageHeight, limits );
+        p.end();
+        QCOMPARE( result.pixel( red ), qRgb( 0, 255, 255 ) );
+        QCOMPARE( result.pixel( yellow ), qRgb( 0, 0, 255 ) );
+    }
+
+    // a different transformation must not reuse the previous one
+    Okular::SettingsCore::setRenderMode( Okular::SettingsCore::EnumRenderMode::Recolor );
+    Okular::Settings::setRecolorForeground( Qt::black );
+    Okular::Settings::setRecolorBackground( Qt::white );
+    QImage result( limits.size(), QImage::Format_ARGB32_Premultiplied );
+    QPainter p( &result );
+    PagePainter::paintPageOnPainter( &p, &page, &observer, PagePainter::Accessibility, pageWidth, pageHeight, limits );
+    p.end();
+    const int redGray = qGray( qRgb( 255, 0, 0 ) ), yellowGray = qGray( qRgb( 255, 255, 0 ) );
+    QCOMPARE( result.pixel( red ), qRgb( redGray, redGray, redGray ) );
+    QCOMPARE( result.pixel( yellow ), qRgb( yellowGray, yellowGray, yellowGray ) );
+
+    Okular::SettingsCore::setChangeColors( false );
+}
+
+void PagePainterTest::benchmarkPaint_data()
+{
+    testCroppedPaint_data();
+}
+
+void PagePainterTest::benchmarkPaint()
+{
+    QFETCH( int, pixmapWidth );
+    QFETCH( int, pixmapHeight );
+    QFETCH( QRect, limits );
+
+    Okular::DocumentObserver observer;
+    Okular::Page page( 0, pageWidth, pageHeight, Okular::Rotation0 );
+    page.setPixmap( &observer, new QPixmap( quadrantsPixmap( pixmapWidth, pixmapHeight ) ) );
+
+    QBENCHMARK {
+        paint( &page, &observer, limits );
+    }
+}
+
+QTEST_MAIN( PagePainterTest )
+#include "pagepaintertest.moc"
@@ -0,0 +1,268 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QLinkedList>
+
+#include <random>
+
+#include "../core/generator.h"
+#include "../core/observer.h"
+#include "../core/pixmaprequestqueue_p.h"
+#include "../ui/priorities.h"
+
+// The sorted list Document used before the queue, as reference
+class ReferenceQueue
+{
+    public:
+        void push( Okular::PixmapRequest *request )
+        {
+            if ( !request->priority() )
+            {
+                m_stack.append( request );
+                return;
+            }
+            QLinkedList< Okular::PixmapRequest * >::iterator sIt = m_stack.begin(), sEnd = m_stack.end();
+            while ( sIt != sEnd && (*sIt)->priority() > request->priority() )
+                ++sIt;
+            m_stack.insert( sIt, request );
+        }
+
+        Okular::PixmapRequest *pop()
+        {
+            return m_stack.isEmpty() ? nullptr : m_stack.takeLast();
+        }
+
+        QList< Okular::PixmapRequest * > take( Okular::DocumentObserver *observer, const QSet< int > &pages, bool allPages )
+        {
+            QList< Okular::PixmapRequest * > taken;
+            QLinkedList< Okular::PixmapRequest * >::iterator sIt = m_stack.begin(), sEnd = m_stack.end();
+            while ( sIt != sEnd )
+            {
+                if ( (*sIt)->observer() == observer && ( allPages || pages.contains( (*sIt)->pageNumber() ) ) )
+                {
+                    taken.append( *sIt );
+                    sIt = m_stack.erase( sIt );
+                }
+                else
+                    ++sIt;
+            }
+            return taken;
+        }
+
+        QLinkedList< Okular::PixmapRequest * > m_stack;
+};
+
+// A scroll session through a long document: the first visible page of each
+// scroll tick, slow reading interleaved with fast scrolling and jumps
+static QVector< int > scrollSession( int pages )
+{
+    QVector< int > session;
+    std::mt19937 random( 5000 );
+    int page = 0;
+    for ( int tick = 0; tick < 100; ++tick )
+    {
+        if ( tick % 50 == 49 )
+            page = random() % pages;
+        else if ( tick % 20 < 5 )
+            page += 10;
+        else if ( tick % 3 == 0 )
+            page += 1;
+        page = qBound( 0, page, pages - 3 );
+        session.append( page );
+    }
+    return session;
+}
+
+// the requests PageView does in Greedy memory mode: the visible pages and all the others as preload
+static QLinkedList< Okular::PixmapRequest * > scrollRequests( Okular::DocumentObserver *observer, int firstVisible, int pages )
+{
+    QLinkedList< Okular::PixmapRequest * > requests;
+    for ( int page = firstVisible; page < firstVisible + 3; ++page )
+        requests.append( new Okular::PixmapRequest( observer, page, 600, 800, PAGEVIEW_PRIO, Okular::PixmapRequest::Asynchronous ) );
+    for ( int distance = 1; distance < pages; ++distance )
+    {
+        if ( firstVisible + 2 + distance < pages )
+            requests.append( new Okular::PixmapRequest( observer, firstVisible + 2 + distance, 600, 800, PAGEVIEW_PRELOAD_PRIO, Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Preload ) );
+        if ( firstVisible - distance >= 0 )
+            requests.append( new Okular::PixmapRequest( observer, firstVisible - distance, 600, 800, PAGEVIEW_PRELOAD_PRIO, Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Preload ) );
+    }
+    return requests;
+}
+
+class PixmapRequestQueueTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testOrder();
+        void testTake();
+        void testSameOrderAsList();
+        void benchmarkScrollSession_data();
+        void benchmarkScrollSession();
+};
+
+void PixmapRequestQueueTest::testOrder()
+{
+    Okular::DocumentObserver observer;
+    Okular::PixmapRequestQueue queue;
+    QVERIFY( queue.isEmpty() );
+    QCOMPARE( queue.top(), static_cast< Okular::PixmapRequest * >( nullptr ) );
+
+    Okular::PixmapRequest *preload1 = new Okular::PixmapRequest( &observer, 5, 100, 100, 4, Okular::PixmapRequest::Asynchronous );
+    Okular::PixmapRequest *visible1 = new Okular::PixmapRequest( &observer, 1, 100, 100, 1, Okular::PixmapRequest::Asynchronous );
+    Okular::PixmapRequest *preload2 = new Okular::PixmapRequest( &observer, 6, 100, 100, 4, Okular::PixmapRequest::Asynchronous );
+    Okular::PixmapRequest *visible2 = new Okular::PixmapRequest( &observer, 2, 100, 100, 1, Okular::PixmapRequest::Asynchronous );
+    Okular::PixmapRequest *sync1 = new Okular::PixmapRequest( &observer, 3, 100, 100, 0, Okular::PixmapRequest::NoFeature );
+    Okular::PixmapRequest *sync2 = new Okular::PixmapRequest( &observer, 4, 100, 100, 0, Okular::PixmapRequest::NoFeature );
+    for ( Okular::PixmapRequest *r : { preload1, visible1, preload2, visible2, sync1, sync2 } )
+        queue.push( r );
+    QCOMPARE( queue.count(), 6 );
+
+    // priority 0 requests are stacked, the others queued by priority
+    const QList< Okular::PixmapRequest * > expected = { sync2, sync1, visible1, visible2, preload1, preload2 };
+    for ( Okular::PixmapRequest *r : expected )
+    {
+        QCOMPARE( queue.top(), r );
+        QCOMPARE( queue.pop(), r );
+        delete r;
+    }
+    QVERIFY( queue.isEmpty() );
+}
+
+void PixmapRequestQueueTest::testTake()
+{
+    Okular::DocumentObserver pageView;
+    Okular::DocumentObserver thumbnails;
+    Okular::PixmapRequestQueue queue;
+    for ( int page = 0; page < 10; ++page )
+    {
+        queue.push( new Okular::PixmapRequest( &pageView, page, 100, 100, page % 3, Okular::PixmapRequest::Asynchronous ) );
+        queue.push( new Okular::PixmapRequest( &thumbnails, page, 10, 10, 2, Okular::PixmapRequest::Asynchronous ) );
+    }
+
+    QList< Okular::PixmapRequest * > taken = queue.take( &pageView, { 2, 4, 42 } );
+    QCOMPARE( taken.count(), 2 );
+    for ( Okular::PixmapRequest *r : qAsConst( taken ) )
+        QCOMPARE( r->observer(), &pageView );
+    qDeleteAll( taken );
+    QCOMPARE( queue.count(), 18 );
+
+    taken = queue.take( &thumbnails );
+    QCOMPARE( taken.count(), 10 );
+    qDeleteAll( taken );
+
+    Okular::PixmapRequest *r = queue.top();
+    queue.remove( r );
+    delete r;
+    QCOMPARE( queue.count(), 7 );
+
+    // the remaining ones still come out in order
+    int lastPriority = -1;
+    while ( !queue.isEmpty() )
+    {
+        r = queue.pop();
+        QVERIFY( r->priority() >= lastPriority );
+        lastPriority = r->priority();
+        delete r;
+    }
+
+    QVERIFY( queue.take( &pageView ).isEmpty() );
+    QVERIFY( queue.takeAll().isEmpty() );
+}
+
+void PixmapRequestQueueTest::testSameOrderAsList()
+{
+    Okular::DocumentObserver observers[2];
+    Okular::PixmapRequestQueue queue;
+    ReferenceQueue reference;
+    std::mt19937 random( 42 );
+
+    for ( int step = 0; step < 5000; ++step )
+    {
+        const int action = random() % 10;
+        if ( action < 6 )
+        {
+            Okular::DocumentObserver *observer = &observers[ random() % 2 ];
+            Okular::PixmapRequest *r = new Okular::PixmapRequest( observer, random() % 50, 100, 100, random() % 5, Okular::PixmapRequest::Asynchronous );
+            queue.push( r );
+            reference.push( r );
+        }
+        else if ( action < 9 )
+        {
+            Okular::PixmapRequest *r = reference.pop();
+            QCOMPARE( queue.pop(), r );
+            delete r;
+        }
+        else
+        {
+            Okular::DocumentObserver *observer = &observers[ random() % 2 ];
+            const QSet< int > pages = { int( random() % 50 ), int( random() % 50 ) };
+            const bool allPages = random() % 4 == 0;
+            QList< Okular::PixmapRequest * > taken = allPages ? queue.take( observer ) : queue.take( observer, pages );
+            QList< Okular::PixmapRequest * > expected = reference.take( observer, pages, allPages );
+            std::sort( taken.begin(), taken.end() );
+            std::sort( expected.begin(), expected.end() );
+            QCOMPARE( taken, expected );
+            qDeleteAll( taken );
+        }
+        QCOMPARE( queue.count(), reference.m_stack.count() );
+    }
+
+    qDeleteAll( queue.takeAll() );
+}
+
+void PixmapRequestQueueTest::benchmarkScrollSession_data()
+{
+    QTest::addColumn<bool>( "useQueue" );
+
+    QTest::newRow( "list" ) << false;
+    QTest::newRow( "queue" ) << true;
+}
+
+void PixmapRequestQueueTest::benchmarkScrollSession()
+{
+    QFETCH( bool, useQueue );
+
+    const int pages = 5000;
+    const QVector< int > session = scrollSession( pages );
+    Okular::DocumentObserver observer;
+
+    QBENCHMARK {
+        Okular::PixmapRequestQueue queue;
+        ReferenceQueue reference;
+        for ( int firstVisible : session )
+        {
+            // what Document::requestPixmaps does for each scroll tick
+            const QLinkedList< Okular::PixmapRequest * > requests = scrollRequests( &observer, firstVisible, pages );
+            if ( useQueue )
+            {
+                qDeleteAll( queue.take( &observer ) );
+                for ( Okular::PixmapRequest *r : requests )
+                    queue.push( r );
+            }
+            else
+            {
+                qDeleteAll( reference.take( &observer, QSet< int >(), true ) );
+                for ( Okular::PixmapRequest *r : requests )
+                    reference.push( r );
+            }
+
+            // a generator that gets a couple of pages rendered before the next tick
+            for ( int i = 0; i < 2; ++i )
+                delete useQueue ? queue.pop() : reference.pop();
+        }
+        qDeleteAll( queue.takeAll() );
+        qDeleteAll( reference.m_stack );
+    }
+}
+
+QTEST_MAIN( PixmapRequestQueueTest )
+#include "pixmaprequestqueuetest.moc"
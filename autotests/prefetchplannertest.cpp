@@ -0,0 +1,112 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "../ui/prefetchplanner.h"
+
+static const int pageHeight = 1000;
+static const int viewportHeight = 800;
+
+class PrefetchPlannerTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testStill();
+        void testScrollingDown();
+        void testScrollingUp();
+        void testFastScrolling();
+        void testStopped();
+        void testReset();
+
+    private:
+        // scroll at 'speed' pixels per second for 100 msecs, starting at 'msecs'
+        static void scroll( PrefetchPlanner *planner, qint64 msecs, int speed );
+};
+
+void PrefetchPlannerTest::scroll( PrefetchPlanner *planner, qint64 msecs, int speed )
+{
+    for ( int i = 0; i <= 10; ++i )
+        planner->addPosition( 50000 + speed * ( msecs + i * 10 ) / 1000, msecs + i * 10 );
+}
+
+void PrefetchPlannerTest::testStill()
+{
+    PrefetchPlanner planner;
+    planner.addPosition( 100, 0 );
+
+    const PrefetchPlanner::Plan plan = planner.plan( 10, 2, pageHeight, viewportHeight );
+    QCOMPARE( plan.pagesAfter, 2 );
+    QCOMPARE( plan.pagesBefore, 2 );
+    QVERIFY( plan.afterFirst );
+    QVERIFY( !plan.lowResolution );
+}
+
+void PrefetchPlannerTest::testScrollingDown()
+{
+    PrefetchPlanner planner;
+    scroll( &planner, 0, 2000 );
+    QCOMPARE( qRound( planner.velocity( 100 ) ), 2000 );
+
+    // 1.5 pages scroll by in the look ahead time
+    const PrefetchPlanner::Plan plan = planner.plan( 100, 1, pageHeight, viewportHeight );
+    QCOMPARE( plan.pagesAfter, 3 );
+    QCOMPARE( plan.pagesBefore, 0 );
+    QVERIFY( plan.afterFirst );
+    QVERIFY( !plan.lowResolution );
+}
+
+void PrefetchPlannerTest::testScrollingUp()
+{
+    PrefetchPlanner planner;
+    scroll( &planner, 0, -2000 );
+
+    const PrefetchPlanner::Plan plan = planner.plan( 100, 4, pageHeight, viewportHeight );
+    QCOMPARE( plan.pagesAfter, 2 );
+    QCOMPARE( plan.pagesBefore, 6 );
+    QVERIFY( !plan.afterFirst );
+}
+
+void PrefetchPlannerTest::testFastScrolling()
+{
+    PrefetchPlanner planner;
+    scroll( &planner, 0, 100000 );
+
+    // the pages ahead are capped
+    const PrefetchPlanner::Plan plan = planner.plan( 100, 1, pageHeight, viewportHeight );
+    QCOMPARE( plan.pagesAfter, 10 );
+    QCOMPARE( plan.pagesBefore, 0 );
+    QVERIFY( plan.lowResolution );
+}
+
+void PrefetchPlannerTest::testStopped()
+{
+    PrefetchPlanner planner;
+    scroll( &planner, 0, 5000 );
+    QVERIFY( planner.velocity( 100 ) > 0 );
+
+    // no new positions for a while means the scrolling stopped
+    QCOMPARE( planner.velocity( 1000 ), 0.0 );
+    const PrefetchPlanner::Plan plan = planner.plan( 1000, 1, pageHeight, viewportHeight );
+    QCOMPARE( plan.pagesAfter, 1 );
+    QCOMPARE( plan.pagesBefore, 1 );
+    QVERIFY( !plan.lowResolution );
+}
+
+void PrefetchPlannerTest::testReset()
+{
+    PrefetchPlanner planner;
+    scroll( &planner, 0, 5000 );
+    planner.reset();
+    QCOMPARE( planner.velocity( 100 ), 0.0 );
+}
+
+QTEST_MAIN( PrefetchPlannerTest )
+#include "prefetchplannertest.moc"
@@ -9,7 +9,10 @@
 
 #include <QtTest>
 
+#include <algorithm>
+
 #include "../core/document.h"
+#include "../core/observer.h"
 #include "../core/page.h"
 #include "../core/textpage.h"
 #include "../settings_core.h"
@@ -31,6 +34,19 @@ class SearchFinishedReceiver : public QObject
         int m_id;
         Okular::Document::SearchStatus m_status;
 };
+
+// Records the pages whose highlights change, in the order they are notified
+class HighlightsObserver : public Okular::DocumentObserver
+{
+    public:
+        void notifyPageChanged( int page, int flags ) override
+        {
+            if ( flags & Highlights )
+                m_pages << page;
+        }
+
+        QList<int> m_pages;
+};
     
 class SearchTest : public QObject
 {
@@ -48,6 +64,10 @@ class SearchTest : public QObject
         void testHyphenAtEndOfPage();
         void testOneColumn();
         void testTwoColumns();
+        void testAllDocumentSearchMatchesSerialSearch();
+        void testResetSearchWhileSearchingAllDocument();
+        void testCloseDocumentWhileSearchingAllDocument();
+        void testAllDocumentSearchWithoutTextPages();
 };
 
 void SearchTest::initTestCase()
@@ -423,5 +443,141 @@ void SearchTest::testTwoColumns()
   delete page;
 }
 
+void SearchTest::testAllDocumentSearchMatchesSerialSearch()
+{
+    // the pages of this document have no text yet, so it is extracted and
+    // searched by jobs, while the pages of the other one are searched as they
+    // are, one after the other
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+
+    Okular::Document threaded(nullptr);
+    QCOMPARE(threaded.openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+    HighlightsObserver threadedObserver;
+    threaded.addObserver(&threadedObserver);
+    QSignalSpy threadedSpy(&threaded, &Okular::Document::searchFinished);
+
+    Okular::Document serial(nullptr);
+    QCOMPARE(serial.openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+    for (uint i = 0; i < serial.pages(); ++i)
+    {
+        serial.requestTextPage(i);
+        QVERIFY(serial.page(i)->hasTextPage());
+    }
+    HighlightsObserver serialObserver;
+    serial.addObserver(&serialObserver);
+    QSignalSpy serialSpy(&serial, &Okular::Document::searchFinished);
+
+    const int searchId = 0;
+    threaded.searchText(searchId, QStringLiteral("Page 2"), true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor(Qt::yellow));
+    serial.searchText(searchId, QStringLiteral("Page 2"), true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor(Qt::yellow));
+    QTRY_COMPARE(threadedSpy.count(), 1);
+    QTRY_COMPARE(serialSpy.count(), 1);
+    QCOMPARE(threadedSpy.at(0).at(1).value<Okular::Document::SearchStatus>(), Okular::Document::MatchFound);
+    QCOMPARE(serialSpy.at(0).at(1).value<Okular::Document::SearchStatus>(), Okular::Document::MatchFound);
+
+    // the matches are committed from the first page to the last one
+    QVERIFY(!threadedObserver.m_pages.isEmpty());
+    QCOMPARE(threadedObserver.m_pages.first(), 1);
+    QVERIFY(std::is_sorted(threadedObserver.m_pages.constBegin(), threadedObserver.m_pages.constEnd()));
+    QCOMPARE(threadedObserver.m_pages, serialObserver.m_pages);
+
+    for (uint i = 0; i < threaded.pages(); ++i)
+    {
+        QVERIFY(threaded.page(i)->hasTextPage());
+        QCOMPARE(threaded.page(i)->hasHighlights(searchId), serial.page(i)->hasHighlights(searchId));
+    }
+
+    threaded.removeObserver(&threadedObserver);
+    serial.removeObserver(&serialObserver);
+}
+
+void SearchTest::testResetSearchWhileSearchingAllDocument()
+{
+    Okular::Document d(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+    QCOMPARE(d.openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+    HighlightsObserver observer;
+    d.addObserver(&observer);
+    QSignalSpy spy(&d, &Okular::Document::searchFinished);
+
+    // every page matches, reset as soon as the first one is committed while
+    // the jobs of the next ones are running
+    const int searchId = 0;
+    d.searchText(searchId, QStringLiteral("Page"), true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor(Qt::yellow));
+    while (observer.m_pages.isEmpty() && spy.isEmpty())
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    QCOMPARE(spy.count(), 0);
+    d.resetSearch(searchId);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).value<Okular::Document::SearchStatus>(), Okular::Document::SearchCancelled);
+
+    // the jobs still report back, nothing of them must be committed
+    observer.m_pages.clear();
+    QTest::qWait(500);
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(observer.m_pages.isEmpty());
+    for (uint i = 0; i < d.pages(); ++i)
+        QVERIFY(!d.page(i)->hasHighlights(searchId));
+
+    d.removeObserver(&observer);
+}
+
+void SearchTest::testCloseDocumentWhileSearchingAllDocument()
+{
+    Okular::Document d(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+    QCOMPARE(d.openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+    HighlightsObserver observer;
+    d.addObserver(&observer);
+    QSignalSpy spy(&d, &Okular::Document::searchFinished);
+
+    const int searchId = 0;
+    d.searchText(searchId, QStringLiteral("Page"), true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor(Qt::yellow));
+    while (observer.m_pages.isEmpty() && spy.isEmpty())
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    QCOMPARE(spy.count(), 0);
+    d.closeDocument();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).value<Okular::Document::SearchStatus>(), Okular::Document::SearchCancelled);
+
+    QTest::qWait(500);
+    QCOMPARE(spy.count(), 1);
+
+    // the document is usable again
+    QCOMPARE(d.openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+    d.searchText(searchId, QStringLiteral("Page 2"), true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor(Qt::yellow));
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(1).value<Okular::Document::SearchStatus>(), Okular::Document::MatchFound);
+
+    d.removeObserver(&observer);
+}
+
+void SearchTest::testAllDocumentSearchWithoutTextPages()
+{
+    // the image generator extracts no text, its jobs give back no text page
+    Okular::Document d(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/potato.jpg");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+    QCOMPARE(d.openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+    QSignalSpy spy(&d, &Okular::Document::searchFinished);
+
+    const int searchId = 0;
+    d.searchText(searchId, QStringLiteral("potato"), true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor(Qt::yellow));
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).value<Okular::Document::SearchStatus>(), Okular::Document::NoMatchFound);
+    for (uint i = 0; i < d.pages(); ++i)
+    {
+        QVERIFY(!d.page(i)->hasTextPage());
+        QVERIFY(!d.page(i)->hasHighlights(searchId));
+    }
+}
+
 QTEST_MAIN( SearchTest )
 #include "searchtest.moc"
@@ -0,0 +1,88 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "../core/area.h"
+#include "../core/textpage.h"
+
+Q_DECLARE_METATYPE( Okular::NormalizedRect )
+
+class TextPageTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testAreaRoundTrip_data();
+        void testAreaRoundTrip();
+        void testWordAtEdge();
+};
+
+void TextPageTest::testAreaRoundTrip_data()
+{
+    QTest::addColumn<Okular::NormalizedRect>( "area" );
+
+    QTest::newRow( "simple" ) << Okular::NormalizedRect( 0.25, 0.5, 0.75, 1.0 );
+    QTest::newRow( "thirds" ) << Okular::NormalizedRect( 1.0 / 3, 2.0 / 3, 0.7 + 1e-12, 0.9 );
+    // a glyph of a 10000 pixels wide page is 1e-4 wide
+    QTest::newRow( "tiny" ) << Okular::NormalizedRect( 0.123456789012, 0.1000000001, 0.123556789012, 0.1001000001 );
+    QTest::newRow( "outside" ) << Okular::NormalizedRect( -0.01, -1e-9, 1.0 + 1e-9, 1.01 );
+}
+
+void TextPageTest::testAreaRoundTrip()
+{
+    QFETCH( Okular::NormalizedRect, area );
+
+    Okular::TextPage page;
+    page.append( QStringLiteral( "okular" ), new Okular::NormalizedRect( area ) );
+
+    const Okular::TextEntity::List words = page.words( nullptr, Okular::TextPage::AnyPixelTextAreaInclusionBehaviour );
+    QCOMPARE( words.count(), 1 );
+    QCOMPARE( words.first()->text(), QStringLiteral( "okular" ) );
+
+    // the boxes are stored as floats, a lot closer than NormalizedRect::operator== asks
+    const double precision = 1e-7;
+    const Okular::NormalizedRect *stored = words.first()->area();
+    QVERIFY( qAbs( stored->left - area.left ) < precision );
+    QVERIFY( qAbs( stored->top - area.top ) < precision );
+    QVERIFY( qAbs( stored->right - area.right ) < precision );
+    QVERIFY( qAbs( stored->bottom - area.bottom ) < precision );
+    QVERIFY( stored->left < stored->right && stored->top < stored->bottom );
+    qDeleteAll( words );
+}
+
+void TextPageTest::testWordAtEdge()
+{
+    const double left = 1.0 / 3, top = 0.1, right = 0.4, bottom = 0.2;
+
+    Okular::TextEntity::List entities;
+    entities.append( new Okular::TextEntity( QStringLiteral( "word" ), new Okular::NormalizedRect( left, top, right, bottom ) ) );
+    Okular::TextPage page( entities );
+
+    // the exact corner of the rect is inside of it, even if 1/3 is rounded up as a float
+    QString word;
+    Okular::RegularAreaRect *area = page.wordAt( Okular::NormalizedPoint( left, top ), &word );
+    QVERIFY( area );
+    QCOMPARE( word, QStringLiteral( "word" ) );
+    QCOMPARE( area->count(), 1 );
+    delete area;
+
+    area = page.wordAt( Okular::NormalizedPoint( right, bottom ), &word );
+    QVERIFY( area );
+    delete area;
+
+    // and a fraction of a pixel out of it is not
+    area = page.wordAt( Okular::NormalizedPoint( left - 1e-4, top ), &word );
+    QVERIFY( !area );
+    area = page.wordAt( Okular::NormalizedPoint( right, bottom + 1e-4 ), &word );
+    QVERIFY( !area );
+}
+
+QTEST_MAIN( TextPageTest )
+#include "textpagetest.moc"
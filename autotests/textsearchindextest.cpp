@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QTemporaryDir>
+
+#include "../core/textsearchindex_p.h"
+
+class TextSearchIndexTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testPagesMatching_data();
+        void testPagesMatching();
+        void testIncompleteIndex();
+        void testSaveAndLoad();
+
+    private:
+        static QString pagesString( const QBitArray &pages );
+};
+
+QString TextSearchIndexTest::pagesString( const QBitArray &pages )
+{
+    QStringList ret;
+    for ( int i = 0; i < pages.size(); ++i )
+    {
+        if ( pages.testBit( i ) )
+            ret << QString::number( i );
+    }
+    return ret.join( QLatin1Char( ',' ) );
+}
+
+void TextSearchIndexTest::testPagesMatching_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("pages");
+
+    QTest::newRow("word") << QStringLiteral("brown") << QStringLiteral("0");
+    QTest::newRow("case") << QStringLiteral("QUICK") << QStringLiteral("0,2");
+    QTest::newRow("substring") << QStringLiteral("ump") << QStringLiteral("0,1");
+    QTest::newRow("phrase") << QStringLiteral("quick brown") << QStringLiteral("0");
+    QTest::newRow("phrase across word boundaries") << QStringLiteral("ick bro") << QStringLiteral("0");
+    QTest::newRow("phrase middle word") << QStringLiteral("he lazy d") << QStringLiteral("1");
+    QTest::newRow("phrase middle word is whole") << QStringLiteral("he laz d") << QString();
+    QTest::newRow("hyphenated") << QStringLiteral("specification") << QStringLiteral("2");
+    QTest::newRow("hyphen kept") << QStringLiteral("specifi-") << QStringLiteral("2");
+    QTest::newRow("missing") << QStringLiteral("cow") << QString();
+}
+
+void TextSearchIndexTest::testPagesMatching()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, pages);
+
+    Okular::TextSearchIndex index;
+    index.reset( 3 );
+    index.addPage( 0, QStringLiteral("The quick brown fox jumps\n") );
+    index.addPage( 1, QStringLiteral("over the lazy dog that jumped\n") );
+    index.addPage( 2, QStringLiteral("a Quick specifi-\ncation\n") );
+    QVERIFY( index.isComplete() );
+
+    QCOMPARE( pagesString( index.pagesMatching( query ) ), pages );
+}
+
+void TextSearchIndexTest::testIncompleteIndex()
+{
+    Okular::TextSearchIndex index;
+    index.reset( 2 );
+    index.addPage( 1, QStringLiteral("lorem ipsum") );
+    QVERIFY( index.isPageIndexed( 1 ) );
+    QVERIFY( !index.isPageIndexed( 0 ) );
+    QVERIFY( !index.isComplete() );
+
+    // nothing can be ruled out yet
+    QCOMPARE( pagesString( index.pagesMatching( QStringLiteral("dolor") ) ), QStringLiteral("0,1") );
+
+    index.addPage( 0, QStringLiteral("dolor sit amet") );
+    QVERIFY( index.isComplete() );
+    QCOMPARE( pagesString( index.pagesMatching( QStringLiteral("dolor") ) ), QStringLiteral("0") );
+}
+
+void TextSearchIndexTest::testSaveAndLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QString fileName = dir.path() + QStringLiteral("/test.index");
+
+    Okular::TextSearchIndex index;
+    index.reset( 2 );
+    index.addPage( 0, QStringLiteral("lorem ipsum") );
+    QVERIFY( !index.save( fileName, QStringLiteral("key") ) );
+    index.addPage( 1, QStringLiteral("dolor sit amet") );
+    QVERIFY( index.save( fileName, QStringLiteral("key") ) );
+
+    Okular::TextSearchIndex loaded;
+    QVERIFY( loaded.load( fileName, QStringLiteral("key"), 2 ) );
+    QVERIFY( loaded.isComplete() );
+    QCOMPARE( pagesString( loaded.pagesMatching( QStringLiteral("sit") ) ), QStringLiteral("1") );
+
+    // a different document or number of pages discards the index
+    QVERIFY( !loaded.load( fileName, QStringLiteral("otherkey"), 2 ) );
+    QVERIFY( !loaded.isComplete() );
+    QVERIFY( !loaded.load( fileName, QStringLiteral("key"), 3 ) );
+    QCOMPARE( loaded.pageCount(), 3 );
+}
+
+QTEST_MAIN( TextSearchIndexTest )
+#include "textsearchindextest.moc"
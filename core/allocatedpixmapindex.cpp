@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "allocatedpixmapindex_p.h"
+
+// local includes
+#include "observer.h"
+
+using namespace Okular;
+
+static AllocatedPixmap *farthestPixmapIn( const QMap< int, AllocatedPixmap * > &pixmaps, int viewportPage, bool unloadableOnly )
+{
+    if ( pixmaps.isEmpty() )
+        return nullptr;
+
+    // Walk from both ends of the index towards the viewport page, the
+    // farthest remaining pixmap is always one of the two ends
+    QMap< int, AllocatedPixmap * >::const_iterator low = pixmaps.constBegin();
+    QMap< int, AllocatedPixmap * >::const_iterator high = pixmaps.constEnd();
+    --high;
+    for ( int remaining = pixmaps.size(); remaining > 0; --remaining )
+    {
+        const bool takeLow = qAbs( low.key() - viewportPage ) >= qAbs( high.key() - viewportPage );
+        AllocatedPixmap *p = takeLow ? low.value() : high.value();
+        if ( !unloadableOnly || p->observer->canUnloadPixmap( p->page ) )
+            return p;
+
+        if ( takeLow )
+            ++low;
+        else
+            --high;
+    }
+
+    return nullptr;
+}
+
+AllocatedPixmapIndex::AllocatedPixmapIndex()
+{
+}
+
+AllocatedPixmapIndex::~AllocatedPixmapIndex()
+{
+    clear();
+}
+
+bool AllocatedPixmapIndex::isEmpty() const
+{
+    return m_pixmaps.isEmpty();
+}
+
+int AllocatedPixmapIndex::count() const
+{
+    return m_pixmaps.size();
+}
+
+void AllocatedPixmapIndex::insert( AllocatedPixmap *pixmap )
+{
+    Q_ASSERT( !m_observerPixmaps.value( pixmap->observer ).contains( pixmap->page ) );
+
+    m_pixmaps.insert( pixmap->page, pixmap );
+    m_observerPixmaps[ pixmap->observer ].insert( pixmap->page, pixmap );
+}
+
+void AllocatedPixmapIndex::remove( AllocatedPixmap *pixmap )
+{
+    m_pixmaps.remove( pixmap->page, pixmap );
+
+    QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > >::iterator oIt = m_observerPixmaps.find( pixmap->observer );
+    if ( oIt != m_observerPixmaps.end() )
+    {
+        oIt->remove( pixmap->page );
+        if ( oIt->isEmpty() )
+            m_observerPixmaps.erase( oIt );
+    }
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::take( DocumentObserver *observer, int page )
+{
+    AllocatedPixmap *pixmap = m_observerPixmaps.value( observer ).value( page );
+    if ( pixmap )
+        remove( pixmap );
+    return pixmap;
+}
+
+void AllocatedPixmapIndex::removeObserver( DocumentObserver *observer )
+{
+    const QMap< int, AllocatedPixmap * > pixmaps = m_observerPixmaps.take( observer );
+    for ( AllocatedPixmap *p : pixmaps )
+    {
+        m_pixmaps.remove( p->page, p );
+        delete p;
+    }
+}
+
+void AllocatedPixmapIndex::clear()
+{
+    qDeleteAll( m_pixmaps );
+    m_pixmaps.clear();
+    m_observerPixmaps.clear();
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::farthestPixmap( int viewportPage, bool unloadableOnly, DocumentObserver *observer ) const
+{
+    if ( observer )
+        return farthestPixmapIn( m_observerPixmaps.value( observer ), viewportPage, unloadableOnly );
+
+    return farthestPixmapIn( m_pixmaps, viewportPage, unloadableOnly );
+}
+
+/* kate: replace-tabs on; indent-width 4; */
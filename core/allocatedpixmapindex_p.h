@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_ALLOCATEDPIXMAPINDEX_P_H_
+#define _OKULAR_ALLOCATEDPIXMAPINDEX_P_H_
+
+#include <QHash>
+#include <QMap>
+
+namespace Okular {
+class DocumentObserver;
+}
+
+struct AllocatedPixmap
+{
+    // owner of the page
+    Okular::DocumentObserver *observer;
+    int page;
+    qulonglong memory;
+    // public constructor: initialize data
+    AllocatedPixmap( Okular::DocumentObserver *o, int p, qulonglong m ) : observer( o ), page( p ), memory( m ) {}
+};
+
+namespace Okular {
+
+/* Keeps the [MEM] allocation descriptors of the observers' pixmaps indexed
+ * by page number. The pixmap farthest from the viewport, i.e. the next one
+ * to evict, is always at one of the two ends of the index whatever the
+ * viewport page is, so it is found without walking all the descriptors and
+ * nothing has to be reordered when the viewport moves. */
+class AllocatedPixmapIndex
+{
+    public:
+        AllocatedPixmapIndex();
+        ~AllocatedPixmapIndex();
+
+        bool isEmpty() const;
+        int count() const;
+
+        /* Adds @p pixmap to the index, taking its ownership. There must not
+         * be another descriptor for the same observer and page */
+        void insert( AllocatedPixmap *pixmap );
+
+        /* Removes @p pixmap from the index, the caller takes its ownership */
+        void remove( AllocatedPixmap *pixmap );
+
+        /* Removes the descriptor of @p observer for @p page from the index
+         * and returns it, or returns NULL if there is none */
+        AllocatedPixmap *take( DocumentObserver *observer, int page );
+
+        /* Deletes all the descriptors owned by @p observer */
+        void removeObserver( DocumentObserver *observer );
+
+        /* Deletes all the descriptors */
+        void clear();
+
+        /* Returns the pixmap that is farthest from @p viewportPage, or NULL
+         * if none is suitable. If unloadableOnly is set, only pixmaps that
+         * their observer allows to unload are returned. If observer is set,
+         * only its pixmaps are considered */
+        AllocatedPixmap *farthestPixmap( int viewportPage, bool unloadableOnly, DocumentObserver *observer = nullptr ) const;
+
+    private:
+        Q_DISABLE_COPY( AllocatedPixmapIndex )
+
+        QMultiMap< int, AllocatedPixmap * > m_pixmaps;
+        QHash< DocumentObserver *, QMap< int, AllocatedPixmap * > > m_observerPixmaps;
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
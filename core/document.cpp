@@ -29,9 +29,11 @@
 // qt/kde/system includes
 #include <QtAlgorithms>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QMap>
+#include <QMutexLocker>
 #include <qtemporaryfile.h>
 #include <QTextStream>
 #include <QTimer>
@@ -63,6 +65,7 @@
 
 // local includes
 #include "action.h"
+#include "allocatedpixmapindex_p.h"
 #include "annotations.h"
 #include "annotations_p.h"
 #include "audioplayer.h"
@@ -86,6 +89,8 @@
 #include "sourcereference.h"
 #include "sourcereference_p.h"
 #include "texteditors_p.h"
+#include "textpage.h"
+#include "textsearchjob_p.h"
 #include "tile.h"
 #include "tilesmanager_p.h"
 #include "utils_p.h"
@@ -102,16 +107,6 @@
 
 using namespace Okular;
 
-struct AllocatedPixmap
-{
-    // owner of the page
-    DocumentObserver *observer;
-    int page;
-    qulonglong memory;
-    // public constructor: initialize data
-    AllocatedPixmap( DocumentObserver *o, int p, qulonglong m ) : observer( o ), page( p ), memory( m ) {}
-};
-
 struct ArchiveData
 {
     ArchiveData()
@@ -123,8 +118,54 @@ struct ArchiveData
     QTemporaryFile metadataFile;
 };
 
+// state of an AllDocument or Google* search while it walks the document
+struct AllPagesSearch
+{
+    AllPagesSearch()
+        : matchAll( false ), nextPageToSearch( 0 ), nextPageToCommit( 0 ), foundAMatch( false ), hopPending( false )
+    {
+        static int lastSerial = 0;
+        serial = ++lastSerial;
+    }
+
+    ~AllPagesSearch()
+    {
+        // the jobs report back to the document anyway, they are ignored then
+        for ( TextSearchJob *job : qAsConst( runningJobs ) )
+            job->abort();
+
+        for ( const TextSearchMatches &matches : qAsConst( pageMatches ) )
+            for ( const QVector< RegularAreaRect * > &wordMatches : matches )
+                qDeleteAll( wordMatches );
+    }
+
+    int serial;
+    QStringList words;
+    QVector< QColor > wordColors;
+    bool matchAll;
+    // pages are searched in any order but committed from the first to the last
+    int nextPageToSearch;
+    int nextPageToCommit;
+    QMap< int, TextSearchMatches > pageMatches;
+    QSet< TextSearchJob * > runningJobs;
+    // the pages the search index can't rule out, all when it is empty
+    QBitArray candidatePages;
+    bool foundAMatch;
+    bool hopPending;
+};
+
 struct RunningSearch
 {
+    RunningSearch()
+        : allPagesSearch( nullptr )
+    {
+    }
+
+    ~RunningSearch()
+    {
+        delete allPagesSearch;
+    }
+
     // store search properties
     int continueOnPage;
     RegularAreaRect continueOnMatch;
@@ -138,6 +179,8 @@ struct RunningSearch
     bool isCurrentlySearching : 1;
     QColor cachedColor;
     int pagesDone;
+
+    AllPagesSearch *allPagesSearch;
 };
 
 #define foreachObserver( cmd ) {\
@@ -268,6 +311,11 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
     if ( memoryToFree < 1 )
         return;
 
+    // The caches of the generator are not part of the pixmap memory budget,
+    // so the pixmaps still go down to theirs while the caches shrink too
+    if ( m_generator )
+        m_generator->freeCachedMemory( memoryToFree );
+
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
 
     // Create a QMap of visible rects, indexed by page number
@@ -305,7 +353,7 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
 
     // Store pages that weren't completely removed
 
-    QLinkedList< AllocatedPixmap * > pixmapsToKeep;
+    QList< AllocatedPixmap * > pixmapsToKeep;
     while (memoryToFree > 0)
     {
         int clean_hits = 0;
@@ -345,7 +393,8 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
         if (clean_hits == 0) break;
     }
 
-    m_allocatedPixmaps += pixmapsToKeep;
+    for ( AllocatedPixmap *p : qAsConst( pixmapsToKeep ) )
+        m_allocatedPixmaps.insert( p );
     //p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
 }
 
@@ -354,38 +403,29 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
  * thenRemoveIt is set, the pixmap is removed from m_allocatedPixmaps before
  * returning it
  */
+void DocumentPrivate::adjustAllocatedPixmapMemory( DocumentObserver *observer, int page, qlonglong bytes )
+{
+    AllocatedPixmap * p = m_allocatedPixmaps.take( observer, page );
+    if ( !p )
+        return;
+
+    // never take away more than what was added, see cleanupPixmapMemory
+    if ( bytes < 0 && qulonglong( -bytes ) > p->memory )
+        bytes = -qlonglong( p->memory );
+    p->memory += bytes;
+    m_allocatedPixmapsTotalMemory += bytes;
+    m_allocatedPixmaps.insert( p );
+}
+
 AllocatedPixmap * DocumentPrivate::searchLowestPriorityPixmap( bool unloadableOnly, bool thenRemoveIt, DocumentObserver *observer )
 {
-    QLinkedList< AllocatedPixmap * >::iterator pIt = m_allocatedPixmaps.begin();
-    QLinkedList< AllocatedPixmap * >::iterator pEnd = m_allocatedPixmaps.end();
-    QLinkedList< AllocatedPixmap * >::iterator farthestPixmap = pEnd;
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
 
     /* Find the pixmap that is farthest from the current viewport */
-    int maxDistance = -1;
-    while ( pIt != pEnd )
-    {
-        const AllocatedPixmap * p = *pIt;
-        // Filter by observer
-        if ( observer == nullptr || p->observer == observer )
-        {
-            const int distance = qAbs( p->page - currentViewportPage );
-            if ( maxDistance < distance && ( !unloadableOnly || p->observer->canUnloadPixmap( p->page ) ) )
-            {
-                maxDistance = distance;
-                farthestPixmap = pIt;
-            }
-        }
-        ++pIt;
-    }
-
-    /* No pixmap to remove */
-    if ( farthestPixmap == pEnd )
-        return nullptr;
+    AllocatedPixmap * selectedPixmap = m_allocatedPixmaps.farthestPixmap( currentViewportPage, unloadableOnly, observer );
 
-    AllocatedPixmap * selectedPixmap = *farthestPixmap;
-    if ( thenRemoveIt )
-        m_allocatedPixmaps.erase( farthestPixmap );
+    if ( selectedPixmap && thenRemoveIt )
+        m_allocatedPixmaps.remove( selectedPixmap );
     return selectedPixmap;
 }
 
@@ -1183,6 +1223,8 @@ void DocumentPrivate::performSetAnnotationContents( const QString & newContents,
 
 void DocumentPrivate::recalculateForms()
 {
+    loadAllPageDetails();
+
     const QVariant fco = m_parent->metaData(QStringLiteral("FormCalculateOrder"));
     const QVector<int> formCalculateOrder = fco.value<QVector<int>>();
     foreach(int formId, formCalculateOrder) {
@@ -1370,14 +1412,9 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
     // find a request
     PixmapRequest * request = nullptr;
     m_pixmapRequestsMutex.lock();
-    while ( !m_pixmapRequestsStack.isEmpty() && !request )
+    while ( !m_pixmapRequestsQueue.isEmpty() && !request )
     {
-        PixmapRequest * r = m_pixmapRequestsStack.last();
-        if (!r)
-        {
-            m_pixmapRequestsStack.pop_back();
-            continue;
-        }
+        PixmapRequest * r = m_pixmapRequestsQueue.top();
 
         QRect requestRect = r->isTile() ? r->normalizedRect().geometry( r->width(), r->height() ) : QRect( 0, 0, r->width(), r->height() );
         TilesManager *tilesManager = r->d->tilesManager();
@@ -1386,25 +1423,37 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         // If it's a preload but the generator is not threaded no point in trying to preload
         if ( r->preload() && !m_generator->hasFeature( Generator::Threaded ) )
         {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
             delete r;
         }
         // request only if page isn't already present and request has valid id
         else if ( ( !r->d->mForce && r->page()->hasPixmap( r->observer(), r->width(), r->height(), r->normalizedRect() ) ) || !m_observers.contains(r->observer()) )
         {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
+            delete r;
+        }
+        // Ignore previews of pages that meanwhile got a better pixmap
+        else if ( r->d->isOutdatedPreview() )
+        {
+            m_pixmapRequestsQueue.pop();
             delete r;
         }
         else if ( !r->d->mForce && r->preload() && qAbs( r->pageNumber() - currentViewportPage ) >= maxDistance )
         {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
             //qCDebug(OkularCoreDebug) << "Ignoring request that doesn't fit in cache";
             delete r;
         }
         // Ignore requests for pixmaps that are already being generated
         else if ( tilesManager && tilesManager->isRequesting( r->normalizedRect(), r->width(), r->height() ) )
         {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
+            delete r;
+        }
+        // Ignore requests that another rendering thread is already working on
+        else if ( !r->d->mForce && !tilesManager && isPixmapBeingGenerated( r ) )
+        {
+            m_pixmapRequestsQueue.pop();
             delete r;
         }
         // If the requested area is above 8000000 pixels, and we're not rendering most of the page,  switch on the tile manager
@@ -1461,7 +1510,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
                 // preload requests issued by PageView if the requested page is
                 // not visible and the user has just switched from a non-tiled
                 // zoom level to a tiled one
-                m_pixmapRequestsStack.pop_back();
+                m_pixmapRequestsQueue.pop();
                 delete r;
             }
         }
@@ -1479,7 +1528,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         }
         else if ( (long)requestRect.width() * (long)requestRect.height() > 200000000L && (SettingsCore::memoryLevel() != SettingsCore::EnumMemoryLevel::Greedy ) )
         {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
             if ( !m_warnedOutOfMemory )
             {
                 qCWarning(OkularCoreDebug).nospace() << "Running out of memory on page " << r->pageNumber()
@@ -1518,7 +1567,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
     {
         QRect requestRect = !request->isTile() ? QRect(0, 0, request->width(), request->height() ) : request->normalizedRect().geometry( request->width(), request->height() );
         qCDebug(OkularCoreDebug).nospace() << "sending request observer=" << request->observer() << " " <<requestRect.width() << "x" << requestRect.height() << "@" << request->pageNumber() << " async == " << request->asynchronous() << " isTile == " << request->isTile();
-        m_pixmapRequestsStack.removeAll ( request );
+        m_pixmapRequestsQueue.remove( request );
 
         if ( tm )
             tm->setRequest( request->normalizedRect(), request->width(), request->height() );
@@ -1539,9 +1588,21 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         // we always have to unlock _before_ the generatePixmap() because
         // a sync generation would end with requestDone() -> deadlock, and
         // we can not really know if the generator can do async requests
+        const bool asynchronous = request->asynchronous();
         m_executingPixmapRequests.push_back( request );
         m_pixmapRequestsMutex.unlock();
         m_generator->generatePixmap( request );
+
+        // generators rendering in parallel may have more idle threads, keep
+        // them busy (a sync generation already went through requestDone())
+        if ( asynchronous && m_generator->canGeneratePixmap() )
+        {
+            m_pixmapRequestsMutex.lock();
+            const bool hasPixmaps = !m_pixmapRequestsQueue.isEmpty();
+            m_pixmapRequestsMutex.unlock();
+            if ( hasPixmaps )
+                sendGeneratorPixmapRequest();
+        }
     }
     else
     {
@@ -1551,6 +1612,26 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
     }
 }
 
+bool DocumentPrivate::isPixmapBeingGenerated( PixmapRequest *request ) const
+{
+    // executing requests already had their size swapped for the rotation
+    const bool swapped = (int)m_rotation % 2;
+    const int width = swapped ? request->height() : request->width();
+    const int height = swapped ? request->width() : request->height();
+
+    for ( PixmapRequest *executingRequest : m_executingPixmapRequests )
+    {
+        if ( executingRequest->observer() == request->observer() &&
+             executingRequest->pageNumber() == request->pageNumber() &&
+             !executingRequest->isTile() && !executingRequest->shouldAbortRender() &&
+             executingRequest->width() == width && executingRequest->height() == height )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 void DocumentPrivate::rotationFinished( int page, Okular::Page *okularPage )
 {
     Okular::Page *wantedPage = m_pagesVector.value( page, 0 );
@@ -1610,7 +1691,6 @@ void DocumentPrivate::slotGeneratorConfigChanged()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll( m_allocatedPixmaps );
         m_allocatedPixmaps.clear();
         m_allocatedPixmapsTotalMemory = 0;
 
@@ -1745,12 +1825,15 @@ void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMa
     {
         // get page
         Page * page = m_pagesVector[ searchStruct->currentPage ];
+        // no need to extract the text of the pages without the text
+        const bool candidate = searchStruct->candidatePages.isEmpty() || searchStruct->candidatePages.testBit( page->number() );
         // request search page if needed
-        if ( !page->hasTextPage() )
+        if ( candidate && !page->hasTextPage() )
             m_parent->requestTextPage( page->number() );
 
         // if found a match on the current page, end the loop
-        searchStruct->match = page->findText( searchStruct->searchID, search->cachedString, forward ? FromTop : FromBottom, search->cachedCaseSensitivity );
+        if ( candidate )
+            searchStruct->match = page->findText( searchStruct->searchID, search->cachedString, forward ? FromTop : FromBottom, search->cachedCaseSensitivity );
         if ( !searchStruct->match )
         {
             if (forward) searchStruct->currentPage++;
@@ -1826,212 +1909,187 @@ void DocumentPrivate::doProcessSearchMatch( RegularAreaRect *match, RunningSearc
     delete pagesToNotify;
 }
 
-void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID)
+void DocumentPrivate::scheduleAllPagesSearch( int searchID, AllPagesSearch *state )
 {
-    QMap< Page *, QVector<RegularAreaRect *> > *pageMatches = static_cast< QMap< Page *, QVector<RegularAreaRect *> > * >(pageMatchesMap);
-    QSet< int > *pagesToNotify = static_cast< QSet< int > * >( pagesToNotifySet );
-    RunningSearch *search = m_searches.value(searchID);
+    if ( state->hopPending )
+        return;
 
-    if (m_searchCancelled || !search)
-    {
-        typedef QVector<RegularAreaRect *> MatchesVector;
+    state->hopPending = true;
+    const int serial = state->serial;
+    QTimer::singleShot(0, m_parent, [this, searchID, serial] {
+        RunningSearch *search = m_searches.value( searchID );
+        // the search was reset or restarted meanwhile
+        if ( !search || !search->allPagesSearch || search->allPagesSearch->serial != serial )
+            return;
 
-        QApplication::restoreOverrideCursor();
+        search->allPagesSearch->hopPending = false;
+        doContinueAllPagesSearch( searchID );
+    });
+}
 
-        if (search) search->isCurrentlySearching = false;
+void DocumentPrivate::cancelAllPagesSearch( int searchID, RunningSearch *search )
+{
+    delete search->allPagesSearch;
+    search->allPagesSearch = nullptr;
+    search->isCurrentlySearching = false;
 
-        emit m_parent->searchFinished( searchID, Document::SearchCancelled );
-        foreach(const MatchesVector &mv, *pageMatches) qDeleteAll(mv);
-        delete pageMatches;
-        delete pagesToNotify;
+    QApplication::restoreOverrideCursor();
+
+    // the highlights of the pages already committed are kept
+    foreach(DocumentObserver *observer, m_observers)
+        observer->notifySetup( m_pagesVector, 0 );
+
+    emit m_parent->searchFinished( searchID, Document::SearchCancelled );
+}
+
+void DocumentPrivate::doContinueAllPagesSearch( int searchID )
+{
+    RunningSearch *search = m_searches.value( searchID );
+    AllPagesSearch *state = search ? search->allPagesSearch : nullptr;
+    if ( !state )
+        return;
+
+    if ( m_searchCancelled )
+    {
+        cancelAllPagesSearch( searchID, search );
         return;
     }
 
-    if (currentPage < m_pagesVector.count())
+    const int pageCount = m_pagesVector.count();
+
+    // 1. search the next pages: the ones whose text is already there are
+    // searched right away, the others are extracted and searched by jobs when
+    // the generator can extract text out of the GUI thread. Otherwise the text
+    // is extracted here, one page per event loop iteration at most
+    const bool threaded = m_generator->hasFeature( Generator::Threaded ) && m_pageController;
+    const int maxJobs = qMax( 1, QThread::idealThreadCount() );
+    bool extractedText = false;
+    QElapsedTimer timer;
+    timer.start();
+    while ( state->nextPageToSearch < pageCount && timer.elapsed() < 20 )
     {
-        // get page (from the first to the last)
-        Page *page = m_pagesVector.at(currentPage);
-        int pageNumber = page->number(); // redundant? is it == currentPage ?
+        Page *page = m_pagesVector.at( state->nextPageToSearch );
 
-        // request search page if needed
-        if ( !page->hasTextPage() )
-            m_parent->requestTextPage( pageNumber );
+        // no need to extract the text of the pages without any of the words
+        if ( !state->candidatePages.isEmpty() && !state->candidatePages.testBit( page->number() ) )
+        {
+            state->pageMatches.insert( page->number(), TextSearchMatches() );
+            ++state->nextPageToSearch;
+            continue;
+        }
 
-        // loop on a page adding highlights for all found items
-        RegularAreaRect * lastMatch = nullptr;
-        while ( true )
+        if ( !page->hasTextPage() )
         {
-            if ( lastMatch )
-                lastMatch = page->findText( searchID, search->cachedString, NextResult, search->cachedCaseSensitivity, lastMatch );
-            else
-                lastMatch = page->findText( searchID, search->cachedString, FromTop, search->cachedCaseSensitivity );
+            if ( threaded )
+            {
+                if ( state->runningJobs.count() >= maxJobs )
+                    break;
+
+                TextSearchJob *job = new TextSearchJob( m_generator, page, searchID, state->words, search->cachedCaseSensitivity );
+                state->runningJobs.insert( job );
+                m_pageController->addTextSearchJob( job );
+                ++state->nextPageToSearch;
+                continue;
+            }
 
-            if ( !lastMatch )
+            if ( extractedText )
                 break;
 
-            // add highlight rect to the matches map
-            (*pageMatches)[page].append(lastMatch);
+            m_parent->requestTextPage( page->number() );
+            extractedText = true;
         }
-        delete lastMatch;
 
-        QTimer::singleShot(0, m_parent, [this, pagesToNotifySet, pageMatches, currentPage, searchID] { doContinueAllDocumentSearch(pagesToNotifySet, pageMatches, currentPage + 1, searchID); });
+        state->pageMatches.insert( page->number(), TextSearchJob::findMatches( page->d->m_text, searchID, state->words, search->cachedCaseSensitivity ) );
+        ++state->nextPageToSearch;
     }
-    else
+
+    // 2. commit the searched pages in order, so the matches show up from the
+    // first page to the last one while the search goes on
+    while ( state->nextPageToCommit < pageCount && state->pageMatches.contains( state->nextPageToCommit ) )
     {
-        // reset cursor to previous shape
-        QApplication::restoreOverrideCursor();
+        const int pageNumber = state->nextPageToCommit++;
+        const TextSearchMatches matches = state->pageMatches.take( pageNumber );
 
-        search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap< Page *, QVector<RegularAreaRect *> >::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for ( ; it != itEnd; ++it)
+        bool allMatched = !matches.isEmpty(), anyMatched = false;
+        for ( const QVector< RegularAreaRect * > &wordMatches : matches )
         {
-            foreach(RegularAreaRect *match, it.value())
-            {
-                it.key()->d->setHighlight( searchID, match, search->cachedColor );
-                delete match;
-            }
-            search->highlightedPages.insert( it.key()->number() );
-            pagesToNotify->insert( it.key()->number() );
+            allMatched = allMatched && !wordMatches.isEmpty();
+            anyMatched = anyMatched || !wordMatches.isEmpty();
         }
 
-        foreach(DocumentObserver *observer, m_observers)
-            observer->notifySetup( m_pagesVector, 0 );
+        // if not all words are present in page, drop the partial highlights
+        if ( state->matchAll ? allMatched : anyMatched )
+        {
+            Page *page = m_pagesVector.at( pageNumber );
+            for ( int w = 0; w < matches.count(); ++w )
+            {
+                for ( RegularAreaRect *match : matches[ w ] )
+                    page->d->setHighlight( searchID, match, state->wordColors[ w ] );
+            }
+            search->highlightedPages.insert( pageNumber );
+            state->foundAMatch = true;
 
-        // notify observers about highlights changes
-        foreach(int pageNumber, *pagesToNotify)
             foreach(DocumentObserver *observer, m_observers)
                 observer->notifyPageChanged( pageNumber, DocumentObserver::Highlights );
+        }
 
-        if (foundAMatch) emit m_parent->searchFinished(searchID, Document::MatchFound );
-        else emit m_parent->searchFinished( searchID, Document::NoMatchFound );
+        for ( const QVector< RegularAreaRect * > &wordMatches : matches )
+            qDeleteAll( wordMatches );
+    }
 
-        delete pageMatches;
-        delete pagesToNotify;
+    if ( state->nextPageToCommit < pageCount )
+    {
+        // the running jobs call back when done, anything else is left for the
+        // next event loop iteration
+        if ( state->runningJobs.isEmpty() || ( state->nextPageToSearch < pageCount && state->runningJobs.count() < maxJobs ) )
+            scheduleAllPagesSearch( searchID, state );
+        return;
     }
-}
 
-void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words)
-{
-    typedef QPair<RegularAreaRect *, QColor> MatchColor;
-    QMap< Page *, QVector<MatchColor> > *pageMatches = static_cast< QMap< Page *, QVector<MatchColor> > * >(pageMatchesMap);
-    QSet< int > *pagesToNotify = static_cast< QSet< int > * >( pagesToNotifySet );
-    RunningSearch *search = m_searches.value(searchID);
+    // 3. all done: reset cursor to previous shape
+    QApplication::restoreOverrideCursor();
 
-    if (m_searchCancelled || !search)
-    {
-        typedef QVector<MatchColor> MatchesVector;
+    const bool foundAMatch = state->foundAMatch;
+    delete state;
+    search->allPagesSearch = nullptr;
+    search->isCurrentlySearching = false;
 
-        QApplication::restoreOverrideCursor();
+    // send page lists to update observers (since some filter on bookmarks)
+    foreach(DocumentObserver *observer, m_observers)
+        observer->notifySetup( m_pagesVector, 0 );
 
-        if (search) search->isCurrentlySearching = false;
+    if (foundAMatch) emit m_parent->searchFinished( searchID, Document::MatchFound );
+    else emit m_parent->searchFinished( searchID, Document::NoMatchFound );
+}
 
-        emit m_parent->searchFinished( searchID, Document::SearchCancelled );
+void DocumentPrivate::textSearchFinished( TextSearchJob *job )
+{
+    const int searchID = job->searchID();
+    RunningSearch *search = m_searches.value( searchID );
+    AllPagesSearch *state = search ? search->allPagesSearch : nullptr;
 
-        foreach(const MatchesVector &mv, *pageMatches)
-        {
-            foreach(const MatchColor &mc, mv) delete mc.first;
-        }
-        delete pageMatches;
-        delete pagesToNotify;
+    // a job of a search that was reset or restarted meanwhile
+    if ( !state || !state->runningJobs.remove( job ) )
         return;
-    }
 
-    const int wordCount = words.count();
-    const int hueStep = (wordCount > 1) ? (60 / (wordCount - 1)) : 60;
-    int baseHue, baseSat, baseVal;
-    search->cachedColor.getHsv( &baseHue, &baseSat, &baseVal );
-
-    if (currentPage < m_pagesVector.count())
+    Page *page = job->page();
+    TextPage *textPage = job->takeTextPage();
+    if ( textPage )
     {
-        // get page (from the first to the last)
-        Page *page = m_pagesVector.at(currentPage);
-        int pageNumber = page->number(); // redundant? is it == currentPage ?
-
-        // request search page if needed
+        // keep the extracted text, unless the page got one meanwhile
         if ( !page->hasTextPage() )
-            m_parent->requestTextPage( pageNumber );
-
-        // loop on a page adding highlights for all found items
-        bool allMatched = wordCount > 0,
-             anyMatched = false;
-        for ( int w = 0; w < wordCount; w++ )
         {
-            const QString &word = words[ w ];
-            int newHue = baseHue - w * hueStep;
-            if ( newHue < 0 )
-                newHue += 360;
-            QColor wordColor = QColor::fromHsv( newHue, baseSat, baseVal );
-            RegularAreaRect * lastMatch = nullptr;
-            // add all highlights for current word
-            bool wordMatched = false;
-            while ( true )
-            {
-                if ( lastMatch )
-                    lastMatch = page->findText( searchID, word, NextResult, search->cachedCaseSensitivity, lastMatch );
-                else
-                    lastMatch = page->findText( searchID, word, FromTop, search->cachedCaseSensitivity);
-
-                if ( !lastMatch )
-                    break;
-
-                // add highligh rect to the matches map
-                (*pageMatches)[page].append(MatchColor(lastMatch, wordColor));
-                wordMatched = true;
-            }
-            allMatched = allMatched && wordMatched;
-            anyMatched = anyMatched || wordMatched;
+            page->d->setPreparedTextPage( textPage );
+            textGenerationDone( page );
         }
-
-        // if not all words are present in page, remove partial highlights
-        const bool matchAll = search->cachedType == Document::GoogleAll;
-        if ( !allMatched && matchAll )
+        else
         {
-            QVector<MatchColor> &matches = (*pageMatches)[page];
-            foreach(const MatchColor &mc, matches) delete mc.first;
-            pageMatches->remove(page);
+            delete textPage;
         }
-
-        QTimer::singleShot(0, m_parent, [this, pagesToNotifySet, pageMatches, currentPage, searchID, words] { doContinueGooglesDocumentSearch(pagesToNotifySet, pageMatches, currentPage + 1, searchID, words); });
     }
-    else
-    {
-        // reset cursor to previous shape
-        QApplication::restoreOverrideCursor();
 
-        search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap< Page *, QVector<MatchColor> >::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for ( ; it != itEnd; ++it)
-        {
-            foreach(const MatchColor &mc, it.value())
-            {
-                it.key()->d->setHighlight( searchID, mc.first, mc.second );
-                delete mc.first;
-            }
-            search->highlightedPages.insert( it.key()->number() );
-            pagesToNotify->insert( it.key()->number() );
-        }
-
-        // send page lists to update observers (since some filter on bookmarks)
-        foreach(DocumentObserver *observer, m_observers)
-            observer->notifySetup( m_pagesVector, 0 );
-
-        // notify observers about highlights changes
-        foreach(int pageNumber, *pagesToNotify)
-            foreach(DocumentObserver *observer, m_observers)
-                observer->notifyPageChanged( pageNumber, DocumentObserver::Highlights );
-
-        if (foundAMatch) emit m_parent->searchFinished( searchID, Document::MatchFound );
-        else emit m_parent->searchFinished( searchID, Document::NoMatchFound );
-
-        delete pageMatches;
-        delete pagesToNotify;
-    }
+    state->pageMatches.insert( page->number(), job->takeMatches() );
+    doContinueAllPagesSearch( searchID );
 }
 
 QVariant DocumentPrivate::documentMetaData( const Generator::DocumentMetaDataKey key, const QVariant &option ) const
@@ -2248,11 +2306,7 @@ void DocumentPrivate::loadSyncFile( const QString & filePath )
 void DocumentPrivate::clearAndWaitForRequests()
 {
     m_pixmapRequestsMutex.lock();
-    QLinkedList< PixmapRequest * >::const_iterator sIt = m_pixmapRequestsStack.constBegin();
-    QLinkedList< PixmapRequest * >::const_iterator sEnd = m_pixmapRequestsStack.constEnd();
-    for ( ; sIt != sEnd; ++sIt )
-        delete *sIt;
-    m_pixmapRequestsStack.clear();
+    qDeleteAll( m_pixmapRequestsQueue.takeAll() );
     m_pixmapRequestsMutex.unlock();
 
     QEventLoop loop;
@@ -2619,6 +2673,8 @@ Document::OpenResult Document::openDocument(const QString & docFile, const QUrl
     d->m_pageController = new PageController();
     connect( d->m_pageController, &PageController::rotationFinished,
              this, [this](int p, Okular::Page *op) { d->rotationFinished(p, op); } );
+    connect( d->m_pageController, &PageController::textSearchFinished,
+             this, [this](Okular::TextSearchJob *job) { d->textSearchFinished(job); } );
 
     for ( Page *p : qAsConst(d->m_pagesVector) )
         p->d->m_doc = d;
@@ -2643,6 +2699,7 @@ Document::OpenResult Document::openDocument(const QString & docFile, const QUrl
 
     d->m_metadataLoadingCompleted = true;
     d->m_bookmarkManager->setUrl( d->m_url );
+    d->loadSearchIndex();
 
     // 3. setup observers internal lists and data
     foreachObserver( notifySetup( d->m_pagesVector, DocumentObserver::DocumentChanged | DocumentObserver::UrlChanged ) );
@@ -2675,6 +2732,16 @@ Document::OpenResult Document::openDocument(const QString & docFile, const QUrl
     }
     d->m_memCheckTimer->start( 2000 );
 
+    // load the page details the generator left out while the user is not doing anything
+    if ( !d->m_pageDetailsTimer )
+    {
+        d->m_pageDetailsTimer = new QTimer( this );
+        d->m_pageDetailsTimer->setSingleShot( true );
+        connect( d->m_pageDetailsTimer, &QTimer::timeout, this, [this] { d->loadPendingPageDetails(); } );
+    }
+    d->m_nextPageDetails = 0;
+    d->m_pageDetailsTimer->start();
+
     const DocumentViewport nextViewport = d->nextDocumentViewport();
     if ( nextViewport.isValid() )
     {
@@ -2743,6 +2810,15 @@ void Document::closeDocument()
 
     emit aboutToClose();
 
+    // stop the searches walking the document, their jobs go away with the page controller
+    const QList< int > searchIDs = d->m_searches.keys();
+    for ( const int searchID : searchIDs )
+    {
+        RunningSearch *search = d->m_searches.value( searchID );
+        if ( search && search->allPagesSearch )
+            d->cancelAllPagesSearch( searchID, search );
+    }
+
     delete d->m_pageController;
     d->m_pageController = nullptr;
 
@@ -2781,6 +2857,12 @@ void Document::closeDocument()
         d->m_memCheckTimer->stop();
     if ( d->m_saveBookmarksTimer )
         d->m_saveBookmarksTimer->stop();
+    if ( d->m_pageDetailsTimer )
+        d->m_pageDetailsTimer->stop();
+    d->m_nextPageDetails = 0;
+    if ( d->m_pageSizesTimer )
+        d->m_pageSizesTimer->stop();
+    d->m_pendingPageSizes.clear();
 
     if ( d->m_generator )
     {
@@ -2821,9 +2903,10 @@ void Document::closeDocument()
     d->m_pagesVector.clear();
 
     // clear 'memory allocation' descriptors
-    qDeleteAll( d->m_allocatedPixmaps );
     d->m_allocatedPixmaps.clear();
 
+    d->m_searchIndex.reset( 0 );
+
     // clear 'running searches' descriptors
     QMap< int, RunningSearch * >::const_iterator rIt = d->m_searches.constBegin();
     QMap< int, RunningSearch * >::const_iterator rEnd = d->m_searches.constEnd();
@@ -2889,19 +2972,7 @@ void Document::removeObserver( DocumentObserver * pObserver )
             (*it)->deletePixmap( pObserver );
 
         // [MEM] free observer's allocation descriptors
-        QLinkedList< AllocatedPixmap * >::iterator aIt = d->m_allocatedPixmaps.begin();
-        QLinkedList< AllocatedPixmap * >::iterator aEnd = d->m_allocatedPixmaps.end();
-        while ( aIt != aEnd )
-        {
-            AllocatedPixmap * p = *aIt;
-            if ( p->observer == pObserver )
-            {
-                aIt = d->m_allocatedPixmaps.erase( aIt );
-                delete p;
-            }
-            else
-                ++aIt;
-        }
+        d->m_allocatedPixmaps.removeObserver( pObserver );
 
         for ( PixmapRequest *executingRequest : qAsConst( d->m_executingPixmapRequests ) )
         {
@@ -2934,13 +3005,18 @@ void Document::reparseConfig()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll( d->m_allocatedPixmaps );
         d->m_allocatedPixmaps.clear();
         d->m_allocatedPixmapsTotalMemory = 0;
 
         // send reload signals to observers
         foreachObserver( notifyContentsCleared( DocumentObserver::Pixmap ) );
     }
+    else
+    {
+        // the color transformations of the pixmaps may have changed
+        for ( Page *page : qAsConst( d->m_pagesVector ) )
+            page->d->deleteTransformedPixmaps();
+    }
 
     // free memory if in 'low' profile
     if ( SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low &&
@@ -3094,6 +3170,8 @@ void Document::setVisiblePageRects( const QVector< VisiblePageRect * > & visible
     for ( ; vIt != vEnd; ++vIt )
         delete *vIt;
     d->m_pageRects = visiblePageRects;
+    for ( const VisiblePageRect *rect : visiblePageRects )
+        d->loadPageDetails( rect->pageNumber );
     // notify change to all other (different from id) observers
     foreach(DocumentObserver *o, d->m_observers)
         if ( o != excludeObserver )
@@ -3319,6 +3397,11 @@ static bool shouldCancelRenderingBecauseOf( const PixmapRequest & executingReque
     if ( executingRequest.observer() != otherRequest.observer() )
         return false;
 
+    // Same priority and observer, one is a preview -> don't cancel
+    // previews are quick and shown until the full render of the page is ready
+    if ( executingRequest.preview() || otherRequest.preview() )
+        return false;
+
     // Same priority and observer, different page number -> don't cancel
     // may still end up cancelled later in the parent caller if none of the requests
     // is of the executingRequest page and RemoveAllPrevious is specified
@@ -3385,6 +3468,30 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests )
     requestPixmaps( requests, RemoveAllPrevious );
 }
 
+// pages requested with more pixels than this get a low resolution preview first
+static const qint64 previewMinimumPixels = 250000;
+// how many times smaller than the full render a preview is, in each direction
+static const int previewDownscale = 8;
+
+// whether to render a preview of the page of 'request' while it is rendered
+static bool wantsPreview( const PixmapRequest *request, const Generator *generator )
+{
+    // only worth it when the full render doesn't block the user interface;
+    // priority 0 requests are served last-in first-out, they would come after
+    if ( !generator->hasFeature( Generator::Threaded ) || !request->asynchronous() || request->preload() ||
+         request->preview() || request->isTile() || request->priority() == 0 ||
+         PixmapRequestPrivate::get( request )->tilesManager() )
+        return false;
+
+    const qint64 pixels = (qint64)request->width() * request->height();
+    if ( pixels < previewMinimumPixels )
+        return false;
+
+    // nothing to gain if the page already has a pixmap as sharp as the preview
+    const QPixmap *pixmap = PagePrivate::get( request->page() )->m_pixmaps.value( request->observer() ).m_pixmap;
+    return !pixmap || (qint64)pixmap->width() * pixmap->height() * previewDownscale * previewDownscale < pixels;
+}
+
 void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests, PixmapRequestFlags reqOptions )
 {
     if ( requests.isEmpty() )
@@ -3415,21 +3522,13 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
     }
     const bool removeAllPrevious = reqOptions & RemoveAllPrevious;
     d->m_pixmapRequestsMutex.lock();
-    QLinkedList< PixmapRequest * >::iterator sIt = d->m_pixmapRequestsStack.begin(), sEnd = d->m_pixmapRequestsStack.end();
-    while ( sIt != sEnd )
-    {
-        if ( (*sIt)->observer() == requesterObserver
-             && ( removeAllPrevious || requestedPages.contains( (*sIt)->pageNumber() ) ) )
-        {
-            // delete request and remove it from stack
-            delete *sIt;
-            sIt = d->m_pixmapRequestsStack.erase( sIt );
-        }
-        else
-            ++sIt;
-    }
+    if ( removeAllPrevious )
+        qDeleteAll( d->m_pixmapRequestsQueue.take( requesterObserver ) );
+    else
+        qDeleteAll( d->m_pixmapRequestsQueue.take( requesterObserver, requestedPages ) );
 
     // 1.B [PREPROCESS REQUESTS] tweak some values of the requests
+    QList< PixmapRequest * > previews;
     for ( PixmapRequest *request : requests )
     {
         // set the 'page field' (see PixmapRequest) and check if it is valid
@@ -3469,6 +3568,17 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
 
         if ( !request->asynchronous() )
             request->d->mPriority = 0;
+
+        // show a quick low resolution render of the page until this one is done
+        if ( wantsPreview( request, d->m_generator ) )
+        {
+            PixmapRequest *preview = new PixmapRequest( request->observer(), request->pageNumber(), 1, 1, request->priority(), PixmapRequest::Asynchronous | PixmapRequest::Preview );
+            // the size of the request already accounts for the device pixel ratio
+            preview->d->mWidth = qMax( 1, request->width() / previewDownscale );
+            preview->d->mHeight = qMax( 1, request->height() / previewDownscale );
+            preview->d->mPage = request->page();
+            previews.append( preview );
+        }
     }
 
     // 1.C [CANCEL REQUESTS] cancel those requests that are running and should be cancelled because of the new requests coming in
@@ -3504,23 +3614,12 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
         }
     }
 
-    // 2. [ADD TO STACK] add requests to stack
+    // 2. [ADD TO QUEUE] add requests to the queue, sorted by priority, the
+    // previews first so that they are served before the requests of their priority
+    for ( PixmapRequest *preview : qAsConst( previews ) )
+        d->m_pixmapRequestsQueue.push( preview );
     for ( PixmapRequest *request : requests )
-    {
-        // add request to the 'stack' at the right place
-        if ( !request->priority() )
-            // add priority zero requests to the top of the stack
-            d->m_pixmapRequestsStack.append( request );
-        else
-        {
-            // insert in stack sorted by priority
-            sIt = d->m_pixmapRequestsStack.begin();
-            sEnd = d->m_pixmapRequestsStack.end();
-            while ( sIt != sEnd && (*sIt)->priority() > request->priority() )
-                ++sIt;
-            d->m_pixmapRequestsStack.insert( sIt, request );
-        }
-    }
+        d->m_pixmapRequestsQueue.push( request );
     d->m_pixmapRequestsMutex.unlock();
 
     // 3. [START FIRST GENERATION] if <NO>generator is ready, start a new generation,
@@ -3785,6 +3884,8 @@ void Document::setViewport( const DocumentViewport & viewport, DocumentObserver
         return;
     }
 
+    d->loadPageDetails( viewport.pageNumber );
+
     // if already broadcasted, don't redo it
     DocumentViewport & oldViewport = *d->m_viewportIterator;
     // disabled by enrico on 2005-03-18 (less debug output)
@@ -3912,6 +4013,14 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     s->cachedColor = color;
     s->isCurrentlySearching = true;
 
+    // a whole document search still running with this searchID is superseded
+    if ( s->allPagesSearch )
+    {
+        delete s->allPagesSearch;
+        s->allPagesSearch = nullptr;
+        QApplication::restoreOverrideCursor();
+    }
+
     // global data for search
     QSet< int > *pagesToNotify = new QSet< int >;
 
@@ -3926,12 +4035,57 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     QApplication::setOverrideCursor( Qt::WaitCursor );
 
     // 1. ALLDOC - process all document marking pages
-    if ( type == AllDocument )
+    // 4. GOOGLE* - process all document marking pages
+    if ( type == AllDocument || type == GoogleAll || type == GoogleAny )
     {
-        QMap< Page *, QVector<RegularAreaRect *> > *pageMatches = new QMap< Page *, QVector<RegularAreaRect *> >;
+        AllPagesSearch *state = new AllPagesSearch();
+        if ( type == AllDocument )
+        {
+            // search and highlight 'text' (as a solid phrase) on all pages
+            state->words << text;
+            state->wordColors << color;
+        }
+        else
+        {
+            // search and highlight every word in 'text' on all pages
+            state->words = text.split( QLatin1Char ( ' ' ), QString::SkipEmptyParts );
+            state->matchAll = type == GoogleAll;
+
+            const int wordCount = state->words.count();
+            const int hueStep = (wordCount > 1) ? (60 / (wordCount - 1)) : 60;
+            int baseHue, baseSat, baseVal;
+            color.getHsv( &baseHue, &baseSat, &baseVal );
+            for ( int w = 0; w < wordCount; w++ )
+            {
+                int newHue = baseHue - w * hueStep;
+                if ( newHue < 0 )
+                    newHue += 360;
+                state->wordColors << QColor::fromHsv( newHue, baseSat, baseVal );
+            }
+        }
+        // only look at the pages the search indexes can't rule out
+        state->candidatePages = QBitArray( d->m_pagesVector.count(), state->matchAll );
+        for ( const QString &word : qAsConst( state->words ) )
+        {
+            const QBitArray wordPages = d->pagesMatchingText( word );
+            if ( wordPages.isEmpty() )
+            {
+                state->candidatePages = QBitArray();
+                break;
+            }
+            if ( state->matchAll )
+                state->candidatePages &= wordPages;
+            else
+                state->candidatePages |= wordPages;
+        }
+        s->allPagesSearch = state;
 
-        // search and highlight 'text' (as a solid phrase) on all pages
-        QTimer::singleShot(0, this, [this, pagesToNotify, pageMatches, searchID] { d->doContinueAllDocumentSearch(pagesToNotify, pageMatches, 0, searchID); });
+        // the matches are notified page by page, do it now for the stale highlights
+        for ( const int pageNumber : qAsConst( *pagesToNotify ) )
+            foreachObserver( notifyPageChanged( pageNumber, DocumentObserver::Highlights ) );
+        delete pagesToNotify;
+
+        d->scheduleAllPagesSearch( searchID, state );
     }
     // 2. NEXTMATCH - find next matching item (or start from top)
     // 3. PREVMATCH - find previous matching item (or start from bottom)
@@ -3968,18 +4122,10 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
         searchStruct->match = match;
         searchStruct->currentPage = currentPage;
         searchStruct->searchID = searchID;
+        searchStruct->candidatePages = d->pagesMatchingText( text );
 
         QTimer::singleShot(0, this, [this, searchStruct] { d->doContinueDirectionMatchSearch(searchStruct); });
     }
-    // 4. GOOGLE* - process all document marking pages
-    else if ( type == GoogleAll || type == GoogleAny )
-    {
-        QMap< Page *, QVector< QPair<RegularAreaRect *, QColor> > > *pageMatches = new QMap< Page *, QVector<QPair<RegularAreaRect *, QColor> > >;
-        const QStringList words = text.split( QLatin1Char ( ' ' ), QString::SkipEmptyParts );
-
-        // search and highlight every word in 'text' on all pages
-        QTimer::singleShot(0, this, [this, pagesToNotify, pageMatches, searchID, words] { d->doContinueGooglesDocumentSearch(pagesToNotify, pageMatches, 0, searchID, words); });
-    }
 }
 
 void Document::continueSearch( int searchID )
@@ -4030,6 +4176,10 @@ void Document::resetSearch( int searchID )
     // get previous parameters for search
     RunningSearch * s = *searchIt;
 
+    // stop walking the document if it is still doing so
+    if ( s->allPagesSearch )
+        d->cancelAllPagesSearch( searchID, s );
+
     // unhighlight pages and inform observers about that
     for (const int pageNumber : qAsConst(s->highlightedPages))
     {
@@ -4048,6 +4198,16 @@ void Document::resetSearch( int searchID )
 void Document::cancelSearch()
 {
     d->m_searchCancelled = true;
+
+    // the aborted jobs still report back, cancelling their search then
+    for ( RunningSearch *search : qAsConst( d->m_searches ) )
+    {
+        if ( search->allPagesSearch )
+        {
+            for ( TextSearchJob *job : qAsConst( search->allPagesSearch->runningJobs ) )
+                job->abort();
+        }
+    }
 }
 
 void Document::undo()
@@ -4867,6 +5027,19 @@ bool Document::swapBackingFile( const QString &newFileName, const QUrl &url )
                 }
             }
 
+            // the undo commands and the pages refer to the current annotations and forms
+            for ( Page *newPage : qAsConst( newPagesVector ) )
+            {
+                if ( !newPage->detailsLoaded() )
+                {
+                    {
+                        QMutexLocker locker( d->m_generator->userMutex() );
+                        newPage->setDetailsLoaded( true );
+                    }
+                    d->m_generator->loadPageDetails( newPage );
+                }
+            }
+
             for (int i = 0; i < d->m_pagesVector.count(); ++i)
             {
                 // switch the PagePrivate* from newPage to oldPage
@@ -4886,6 +5059,7 @@ bool Document::swapBackingFile( const QString &newFileName, const QUrl &url )
                 rectsToDelete << oldPage->m_rects;
                 oldPage->m_annotations = newPage->m_annotations;
                 oldPage->m_rects = newPage->m_rects;
+                oldPage->d->invalidateObjectRectIndex();
             }
             qDeleteAll( newPagesVector );
         }
@@ -4894,6 +5068,7 @@ bool Document::swapBackingFile( const QString &newFileName, const QUrl &url )
         d->m_docFileName = newFileName;
         d->updateMetadataXmlNameAndDocSize();
         d->m_bookmarkManager->setUrl( d->m_url );
+        d->loadSearchIndex();
         d->m_documentInfo = DocumentInfo();
         d->m_documentInfoAskedKeys.clear();
 
@@ -5378,17 +5553,12 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
     if ( !req->shouldAbortRender() )
     {
         // [MEM] 1.1 find and remove a previous entry for the same page and id
-        QLinkedList< AllocatedPixmap * >::iterator aIt = m_allocatedPixmaps.begin();
-        QLinkedList< AllocatedPixmap * >::iterator aEnd = m_allocatedPixmaps.end();
-        for ( ; aIt != aEnd; ++aIt )
-            if ( (*aIt)->page == req->pageNumber() && (*aIt)->observer == req->observer() )
-            {
-                AllocatedPixmap * p = *aIt;
-                m_allocatedPixmaps.erase( aIt );
-                m_allocatedPixmapsTotalMemory -= p->memory;
-                delete p;
-                break;
-            }
+        AllocatedPixmap * previousPixmap = m_allocatedPixmaps.take( req->observer(), req->pageNumber() );
+        if ( previousPixmap )
+        {
+            m_allocatedPixmapsTotalMemory -= previousPixmap->memory;
+            delete previousPixmap;
+        }
 
         DocumentObserver *observer = req->observer();
         if ( m_observers.contains(observer) )
@@ -5402,7 +5572,7 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
                 memoryBytes = 4 * req->width() * req->height();
 
             AllocatedPixmap * memoryPage = new AllocatedPixmap( req->observer(), req->pageNumber(), memoryBytes );
-            m_allocatedPixmaps.append( memoryPage );
+            m_allocatedPixmaps.insert( memoryPage );
             m_allocatedPixmapsTotalMemory += memoryBytes;
 
             // 2. notify an observer that its pixmap changed
@@ -5422,12 +5592,81 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
 
     // 4. start a new generation if some is pending
     m_pixmapRequestsMutex.lock();
-    bool hasPixmaps = !m_pixmapRequestsStack.isEmpty();
+    bool hasPixmaps = !m_pixmapRequestsQueue.isEmpty();
     m_pixmapRequestsMutex.unlock();
     if ( hasPixmaps )
         sendGeneratorPixmapRequest();
 }
 
+// how long to gather the page sizes given by the generator before relayouting the pages
+static const int pageSizesDelay = 250;
+
+void DocumentPrivate::setPageSizes( const QMap< int, QSizeF > &sizes )
+{
+    QMap< int, QSizeF >::const_iterator it = sizes.constBegin(), itEnd = sizes.constEnd();
+    for ( ; it != itEnd; ++it )
+        m_pendingPageSizes.insert( it.key(), it.value() );
+
+    if ( !m_pageSizesTimer )
+    {
+        m_pageSizesTimer = new QTimer( m_parent );
+        m_pageSizesTimer->setSingleShot( true );
+        m_pageSizesTimer->setInterval( pageSizesDelay );
+        QObject::connect( m_pageSizesTimer, &QTimer::timeout, m_parent, [this] { applyPendingPageSizes(); } );
+    }
+    if ( !m_pageSizesTimer->isActive() )
+        m_pageSizesTimer->start();
+}
+
+void DocumentPrivate::applyPendingPageSizes()
+{
+    // the sizes may come before the document got the pages
+    if ( m_pagesVector.isEmpty() )
+    {
+        if ( m_generator )
+            m_pageSizesTimer->start();
+        else
+            m_pendingPageSizes.clear();
+        return;
+    }
+
+    const QMap< int, QSizeF > sizes = m_pendingPageSizes;
+    m_pendingPageSizes.clear();
+
+    QVector< int > changedPages;
+    QMap< int, QSizeF >::const_iterator it = sizes.constBegin(), itEnd = sizes.constEnd();
+    for ( ; it != itEnd; ++it )
+    {
+        Page * kp = m_pagesVector.value( it.key() );
+        if ( !kp || it.value().isEmpty() )
+            continue;
+
+        // the page keeps its size rotated
+        const bool swapped = kp->rotation() % 2;
+        const double width = swapped ? kp->height() : kp->width();
+        const double height = swapped ? kp->width() : kp->height();
+        if ( width == it.value().width() && height == it.value().height() )
+            continue;
+
+        // the pixmaps of the page are deleted with the size change
+        for ( DocumentObserver *observer : qAsConst( m_observers ) )
+        {
+            AllocatedPixmap *p = m_allocatedPixmaps.take( observer, it.key() );
+            if ( p )
+            {
+                m_allocatedPixmapsTotalMemory -= p->memory;
+                delete p;
+            }
+        }
+        kp->d->changeSize( PageSize( it.value().width(), it.value().height(), QString() ) );
+        changedPages.append( it.key() );
+    }
+
+    // only the resized pages are notified, the observers relayout them once
+    for ( int page : qAsConst( changedPages ) )
+        foreachObserverD( notifyPageChanged( page, DocumentObserver::Size ) );
+}
+
 void DocumentPrivate::setPageBoundingBox( int page, const NormalizedRect& boundingBox )
 {
     Page * kp = m_pagesVector[ page ];
@@ -5487,6 +5726,106 @@ void DocumentPrivate::textGenerationDone( Page *page )
 
     // 2. Add the page to the fifo of generated text pages
     m_allocatedTextPagesFifo.append( page->number() );
+
+    // 3. Feed the search index with the words of the page
+    indexTextPage( page );
+}
+
+QString DocumentPrivate::searchIndexFileName() const
+{
+    if ( m_xmlFileName.isEmpty() )
+        return QString();
+
+    // stored next to the docdata file, with the same base name
+    QString fileName = m_xmlFileName;
+    if ( fileName.endsWith( QLatin1String( ".xml" ) ) )
+        fileName.chop( 4 );
+    return fileName + QStringLiteral( ".index" );
+}
+
+QString DocumentPrivate::searchIndexKey() const
+{
+    // the docdata file name only tells apart documents by name and size
+    return m_generatorName + QLatin1Char( '/' ) + QFileInfo( m_docFileName ).lastModified().toString( Qt::ISODate );
+}
+
+void DocumentPrivate::loadSearchIndex()
+{
+    const QString fileName = searchIndexFileName();
+    if ( fileName.isEmpty() || !SettingsCore::persistentSearchIndex() )
+    {
+        // nowhere to keep the index, don't spend memory on it
+        m_searchIndex.reset( 0 );
+        return;
+    }
+
+    if ( m_searchIndex.load( fileName, searchIndexKey(), m_pagesVector.count() ) )
+        qCDebug(OkularCoreDebug) << "Loaded search index" << fileName;
+}
+
+void DocumentPrivate::indexTextPage( Page *page )
+{
+    // without a persistent index nothing would keep the text of the page
+    if ( !m_searchIndex.pageCount() || m_searchIndex.isComplete() || m_searchIndex.isPageIndexed( page->number() ) || !page->d->m_text )
+        return;
+
+    m_searchIndex.addPage( page->number(), page->d->m_text->text( nullptr ) );
+
+    // once every page is in, keep it for the next time the document is opened
+    if ( m_searchIndex.isComplete() )
+    {
+        const QString fileName = searchIndexFileName();
+        if ( !m_searchIndex.save( fileName, searchIndexKey() ) )
+            qCWarning(OkularCoreDebug) << "Failed to save search index" << fileName;
+    }
+}
+
+QBitArray DocumentPrivate::pagesMatchingText( const QString &text ) const
+{
+    // our own index is built from the same text the search looks at, prefer it
+    if ( m_searchIndex.isComplete() )
+        return m_searchIndex.pagesMatching( text );
+
+    const QBitArray pages = m_generator->pagesMatchingText( text );
+    return pages.size() == m_pagesVector.count() ? pages : QBitArray();
+}
+
+void DocumentPrivate::loadPageDetails( int page, bool notify )
+{
+    Page *p = m_pagesVector.value( page );
+    if ( !p || p->detailsLoaded() || !m_generator )
+        return;
+
+    // mark them as loaded first, the generator may query them while loading;
+    // the render threads read the flag under the generator mutex
+    {
+        QMutexLocker locker( m_generator->userMutex() );
+        p->setDetailsLoaded( true );
+    }
+    m_generator->loadPageDetails( p );
+
+    // also when nothing was added, so that the observers stop waiting for them
+    if ( notify )
+        foreachObserverD( notifyPageChanged( page, DocumentObserver::Annotations ) );
+}
+
+void DocumentPrivate::loadAllPageDetails()
+{
+    for ( int i = 0; i < m_pagesVector.count(); ++i )
+        loadPageDetails( i );
+}
+
+void DocumentPrivate::loadPendingPageDetails()
+{
+    // load a few pages at a time, not to block the user interface
+    QElapsedTimer time;
+    time.start();
+    const int count = m_pagesVector.count();
+    while ( m_nextPageDetails < count && time.elapsed() < 20 )
+        loadPageDetails( m_nextPageDetails++ );
+
+    if ( m_nextPageDetails < count )
+        m_pageDetailsTimer->start();
 }
 
 void Document::setRotation( int r )
@@ -5538,7 +5877,6 @@ void Document::setPageSize( const PageSize &size )
     for ( ; pIt != pEnd; ++pIt )
         (*pIt)->d->changeSize( size );
     // clear 'memory allocation' descriptors
-    qDeleteAll( d->m_allocatedPixmaps );
     d->m_allocatedPixmaps.clear();
     d->m_allocatedPixmapsTotalMemory = 0;
     // notify the generator that the current page size has changed
@@ -28,8 +28,11 @@
 #include <KPluginMetaData>
 
 // local includes
+#include "allocatedpixmapindex_p.h"
 #include "fontinfo.h"
 #include "generator.h"
+#include "pixmaprequestqueue_p.h"
+#include "textsearchindex_p.h"
 
 class QUndoStack;
 class QEventLoop;
@@ -38,14 +41,15 @@ class QTimer;
 class QTemporaryFile;
 class KPluginMetaData;
 
-struct AllocatedPixmap;
 struct ArchiveData;
+struct AllPagesSearch;
 struct RunningSearch;
 
 namespace Okular {
 class ScriptAction;
 class ConfigInterface;
 class PageController;
+class TextSearchJob;
 class SaveInterface;
 class Scripter;
 class View;
@@ -90,6 +94,8 @@ struct DoContinueDirectionMatchSearchStruct
     RegularAreaRect *match;
     int currentPage;
     int searchID;
+    // the pages that may contain the text, all when it is empty
+    QBitArray candidatePages;
 };
 
 enum LoadDocumentInfoFlag
@@ -116,6 +122,9 @@ class DocumentPrivate
             m_bookmarkManager( nullptr ),
             m_memCheckTimer( nullptr ),
             m_saveBookmarksTimer( nullptr ),
+            m_pageDetailsTimer( nullptr ),
+            m_nextPageDetails( 0 ),
+            m_pageSizesTimer( nullptr ),
             m_generator( nullptr ),
             m_walletGenerator( nullptr ),
             m_generatorsLoaded( false ),
@@ -141,6 +150,8 @@ class DocumentPrivate
         void cleanupPixmapMemory();
         void cleanupPixmapMemory( qulonglong memoryToFree );
         AllocatedPixmap * searchLowestPriorityPixmap( bool unloadableOnly = false, bool thenRemoveIt = false, DocumentObserver *observer = nullptr /* any */ );
+        // add 'bytes', that can be negative, to the memory used by the pixmap of 'observer' for 'page'
+        void adjustAllocatedPixmapMemory( DocumentObserver *observer, int page, qlonglong bytes );
         void calculateMaxTextPages();
         qulonglong getTotalMemory();
         qulonglong getFreeMemory( qulonglong *freeSwap = nullptr );
@@ -169,6 +180,15 @@ class DocumentPrivate
         bool canRemoveExternalAnnotations() const;
         OKULARCORE_EXPORT static QString docDataFileName(const QUrl &url, qint64 document_size);
         bool cancelRenderingBecauseOf( PixmapRequest *executingRequest, PixmapRequest *newRequest );
+        bool isPixmapBeingGenerated( PixmapRequest *request ) const;
+        QString searchIndexFileName() const;
+        QString searchIndexKey() const;
+        void loadSearchIndex();
+        void indexTextPage( Page *page );
+        QBitArray pagesMatchingText( const QString &text ) const;
+        void loadPageDetails( int page, bool notify = true );
+        void loadAllPageDetails();
+        void loadPendingPageDetails();
 
         // Methods that implement functionality needed by undo commands
         void performAddPageAnnotation( int page, Annotation *annotation );
@@ -189,8 +209,10 @@ class DocumentPrivate
         void refreshPixmaps( int );
         void _o_configChanged();
         void doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct);
-        void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID);
-        void doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words);
+        void scheduleAllPagesSearch( int searchID, AllPagesSearch *state );
+        void cancelAllPagesSearch( int searchID, RunningSearch *search );
+        void doContinueAllPagesSearch( int searchID );
+        void textSearchFinished( TextSearchJob *job );
 
         void doProcessSearchMatch( RegularAreaRect *match, RunningSearch *search, QSet< int > *pagesToNotify, int currentPage, int searchID, bool moveViewport, const QColor & color );
 
@@ -213,6 +235,14 @@ class DocumentPrivate
          */
         void setPageBoundingBox( int page, const NormalizedRect& boundingBox );
 
+        /**
+         * Sets the size of the pages in @p sizes (in terms of upright orientation,
+         * i.e., Rotation0), see Generator::updatePageSizes(). The sizes coming
+         * within a short time are applied together.
+         */
+        void setPageSizes( const QMap< int, QSizeF > &sizes );
+        void applyPendingPageSizes();
+
         /**
          * Request a particular metadata of the Document itself (ie, not something
          * depending on the document type/backend).
@@ -267,15 +297,18 @@ class DocumentPrivate
 
         // observers / requests / allocator stuff
         QSet< DocumentObserver * > m_observers;
-        QLinkedList< PixmapRequest * > m_pixmapRequestsStack;
+        PixmapRequestQueue m_pixmapRequestsQueue;
         QLinkedList< PixmapRequest * > m_executingPixmapRequests;
         QMutex m_pixmapRequestsMutex;
-        QLinkedList< AllocatedPixmap * > m_allocatedPixmaps;
+        AllocatedPixmapIndex m_allocatedPixmaps;
         qulonglong m_allocatedPixmapsTotalMemory;
         QList< int > m_allocatedTextPagesFifo;
         int m_maxAllocatedTextPages;
         bool m_warnedOutOfMemory;
 
+        // words of the document to the pages they are in, to narrow down searches
+        TextSearchIndex m_searchIndex;
+
         // the rotation applied to the document
         Rotation m_rotation;
 
@@ -296,6 +329,14 @@ class DocumentPrivate
         QTimer *m_memCheckTimer;
         QTimer *m_saveBookmarksTimer;
 
+        // loads the page details left out by the generator while idle
+        QTimer *m_pageDetailsTimer;
+        int m_nextPageDetails;
+
+        // the page sizes given by the generator, applied in batches
+        QMap< int, QSizeF > m_pendingPageSizes;
+        QTimer *m_pageSizesTimer;
+
         QHash<QString, GeneratorInfo> m_loadedGenerators;
         Generator * m_generator;
         QString m_generatorName;
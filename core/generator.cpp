@@ -33,6 +33,7 @@
 #include "document_p.h"
 #include "page.h"
 #include "page_p.h"
+#include "settings_core.h"
 #include "textpage.h"
 #include "utils.h"
 
@@ -40,8 +41,8 @@ using namespace Okular;
 
 GeneratorPrivate::GeneratorPrivate()
     : m_document( nullptr ),
-      mPixmapGenerationThread( nullptr ), mTextPageGenerationThread( nullptr ),
-      m_mutex( nullptr ), m_threadsMutex( nullptr ), mPixmapReady( true ), mTextPageReady( true ),
+      mTextPageGenerationThread( nullptr ),
+      m_mutex( nullptr ), m_threadsMutex( nullptr ), mRunningPixmapRequests( 0 ), mTextPageReady( true ),
       m_closing( false ), m_closingLoop( nullptr ),
       m_dpi(72.0, 72.0)
 {
@@ -50,10 +51,11 @@ GeneratorPrivate::GeneratorPrivate()
 
 GeneratorPrivate::~GeneratorPrivate()
 {
-    if ( mPixmapGenerationThread )
-        mPixmapGenerationThread->wait();
-
-    delete mPixmapGenerationThread;
+    for ( PixmapGenerationThread *thread : qAsConst( mPixmapGenerationThreads ) )
+    {
+        thread->wait();
+        delete thread;
+    }
 
     if ( mTextPageGenerationThread )
         mTextPageGenerationThread->wait();
@@ -66,15 +68,20 @@ GeneratorPrivate::~GeneratorPrivate()
 
 PixmapGenerationThread* GeneratorPrivate::pixmapGenerationThread()
 {
-    if ( mPixmapGenerationThread )
-        return mPixmapGenerationThread;
+    // a thread is idle once its finished() signal has been handled
+    for ( PixmapGenerationThread *thread : qAsConst( mPixmapGenerationThreads ) )
+    {
+        if ( !thread->request() )
+            return thread;
+    }
 
     Q_Q( Generator );
-    mPixmapGenerationThread = new PixmapGenerationThread( q );
-    QObject::connect( mPixmapGenerationThread, &PixmapGenerationThread::finished, q, [this] { pixmapGenerationFinished(); },
+    PixmapGenerationThread *thread = new PixmapGenerationThread( q );
+    QObject::connect( thread, &PixmapGenerationThread::finished, q, [this, thread] { pixmapGenerationFinished( thread ); },
                       Qt::QueuedConnection );
+    mPixmapGenerationThreads.append( thread );
 
-    return mPixmapGenerationThread;
+    return thread;
 }
 
 TextPageGenerationThread* GeneratorPrivate::textPageGenerationThread()
@@ -90,20 +97,22 @@ TextPageGenerationThread* GeneratorPrivate::textPageGenerationThread()
     return mTextPageGenerationThread;
 }
 
-void GeneratorPrivate::pixmapGenerationFinished()
+void GeneratorPrivate::pixmapGenerationFinished( PixmapGenerationThread *thread )
 {
     Q_Q( Generator );
-    PixmapRequest *request = mPixmapGenerationThread->request();
-    const QImage& img = mPixmapGenerationThread->image();
-    mPixmapGenerationThread->endGeneration();
+    PixmapRequest *request = thread->request();
+    const QImage& img = thread->image();
+    const bool calcBoundingBox = thread->calcBoundingBox();
+    const NormalizedRect boundingBox = thread->boundingBox();
+    thread->endGeneration();
 
     QMutexLocker locker( threadsLock() );
 
     if ( m_closing )
     {
-        mPixmapReady = true;
+        --mRunningPixmapRequests;
         delete request;
-        if ( mTextPageReady )
+        if ( mRunningPixmapRequests == 0 && mTextPageReady )
         {
             locker.unlock();
             m_closingLoop->quit();
@@ -112,24 +121,31 @@ void GeneratorPrivate::pixmapGenerationFinished()
     }
 
 
+    // a preview finishing after the full render of its page, e.g. in another
+    // thread, must not replace it
+    const bool outdatedPreview = request->d->isOutdatedPreview();
+    if ( outdatedPreview )
+        request->d->mShouldAbortRender = 1;
+
     if ( !request->shouldAbortRender() )
     {
         request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( img ) ), request->normalizedRect() );
         const int pageNumber = request->page()->number();
 
-        if ( mPixmapGenerationThread->calcBoundingBox() )
-            q->updatePageBoundingBox( pageNumber, mPixmapGenerationThread->boundingBox() );
+        if ( calcBoundingBox )
+            q->updatePageBoundingBox( pageNumber, boundingBox );
     }
-    else
+    else if ( !outdatedPreview )
     {
-        // Cancel the text page generation too if it's still running
-        if ( mTextPageGenerationThread && mTextPageGenerationThread->isRunning() ) {
+        // Cancel the text page generation too if it's still running for the same page
+        if ( mTextPageGenerationThread && mTextPageGenerationThread->isRunning() &&
+             mTextPageGenerationThread->page() == request->page() ) {
             mTextPageGenerationThread->abortExtraction();
             mTextPageGenerationThread->wait();
         }
     }
 
-    mPixmapReady = true;
+    --mRunningPixmapRequests;
     q->signalPixmapRequestDone( request );
 }
 
@@ -145,7 +161,7 @@ void GeneratorPrivate::textpageGenerationFinished()
     if ( m_closing )
     {
         delete mTextPageGenerationThread->textPage();
-        if ( mPixmapReady )
+        if ( mRunningPixmapRequests == 0 )
         {
             locker.unlock();
             m_closingLoop->quit();
@@ -161,6 +177,15 @@ void GeneratorPrivate::textpageGenerationFinished()
     }
 }
 
+int GeneratorPrivate::maxPixmapGenerationThreads() const
+{
+    if ( !m_features.contains( Generator::ParallelRendering ) )
+        return 1;
+
+    const int threads = SettingsCore::renderingThreads();
+    return threads > 0 ? threads : qMax( 1, QThread::idealThreadCount() );
+}
+
 QMutex* GeneratorPrivate::threadsLock()
 {
     if ( !m_threadsMutex )
@@ -232,7 +257,7 @@ bool Generator::closeDocument()
     d->m_closing = true;
 
     d->threadsLock()->lock();
-    if ( !( d->mPixmapReady && d->mTextPageReady ) )
+    if ( !( d->mRunningPixmapRequests == 0 && d->mTextPageReady ) )
     {
         QEventLoop loop;
         d->m_closingLoop = &loop;
@@ -258,15 +283,16 @@ bool Generator::closeDocument()
 bool Generator::canGeneratePixmap() const
 {
     Q_D( const Generator );
-    return d->mPixmapReady;
+    return d->mRunningPixmapRequests < d->maxPixmapGenerationThreads();
 }
 
 void Generator::generatePixmap( PixmapRequest *request )
 {
     Q_D( Generator );
-    d->mPixmapReady = false;
+    ++d->mRunningPixmapRequests;
 
-    const bool calcBoundingBox = !request->isTile() && !request->page()->isBoundingBoxKnown();
+    // previews are too coarse for a precise bounding box
+    const bool calcBoundingBox = !request->isTile() && !request->preview() && !request->page()->isBoundingBoxKnown();
 
     if ( request->asynchronous() && hasFeature( Threaded ) )
     {
@@ -274,12 +300,17 @@ void Generator::generatePixmap( PixmapRequest *request )
         {
             // It can happen that the text generation has already finished but
             // mTextPageReady is still false because textpageGenerationFinished
-            // didn't have time to run, if so queue ourselves
-            QTimer::singleShot(0, this, [this, request] { generatePixmap(request); });
+            // didn't have time to run, if so queue ourselves; the request
+            // keeps its slot in the rendering pool until then
+            QTimer::singleShot(0, this, [this, request] {
+                --d_ptr->mRunningPixmapRequests;
+                generatePixmap(request);
+            });
             return;
         }
 
-        d->pixmapGenerationThread()->startGeneration( request, calcBoundingBox );
+        PixmapGenerationThread *pixmapThread = d->pixmapGenerationThread();
+        pixmapThread->startGeneration( request, calcBoundingBox );
 
         /**
          * We create the text page for every page that is visible to the
@@ -292,7 +323,7 @@ void Generator::generatePixmap( PixmapRequest *request )
             // dummy is used as a way to make sure the lambda gets disconnected each time it is executed
             // since not all the times the pixmap generation thread starts we want the text generation thread to also start
             QObject *dummy = new QObject();
-            connect(d_ptr->pixmapGenerationThread(), &QThread::started, dummy, [this, dummy] {
+            connect(pixmapThread, &QThread::started, dummy, [this, dummy] {
                 delete dummy;
                 d_ptr->textPageGenerationThread()->startGeneration();
             });
@@ -305,7 +336,7 @@ void Generator::generatePixmap( PixmapRequest *request )
     request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( img ) ), request->normalizedRect() );
     const int pageNumber = request->page()->number();
 
-    d->mPixmapReady = true;
+    --d->mRunningPixmapRequests;
 
     signalPixmapRequestDone( request );
     if ( calcBoundingBox )
@@ -337,6 +368,20 @@ TextPage* Generator::textPage( TextRequest * )
     return nullptr;
 }
 
+void Generator::loadPageDetails( Page * )
+{
+}
+
+qulonglong Generator::freeCachedMemory( qulonglong )
+{
+    return 0;
+}
+
+QBitArray Generator::pagesMatchingText( const QString & )
+{
+    return QBitArray();
+}
+
 DocumentInfo Generator::generateDocumentInfo(const QSet<DocumentInfo::Key> &keys) const
 {
     Q_UNUSED(keys);
@@ -522,6 +567,13 @@ void Generator::updatePageBoundingBox( int page, const NormalizedRect & bounding
         d->m_document->setPageBoundingBox( page, boundingBox );
 }
 
+void Generator::updatePageSizes( const QMap< int, QSizeF > &sizes )
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->setPageSizes( sizes );
+}
+
 void Generator::requestFontData(const Okular::FontInfo & /*font*/, QByteArray * /*data*/)
 {
 
@@ -634,6 +686,11 @@ bool PixmapRequest::preload() const
     return d->mFeatures & Preload;
 }
 
+bool PixmapRequest::preview() const
+{
+    return d->mFeatures & Preview;
+}
+
 Page* PixmapRequest::page() const
 {
     return d->mPage;
@@ -682,6 +739,19 @@ Okular::TilesManager* PixmapRequestPrivate::tilesManager() const
     return mPage->d->tilesManager(mObserver);
 }
 
+bool PixmapRequestPrivate::isOutdatedPreview() const
+{
+    if ( !( mFeatures & PixmapRequest::Preview ) )
+        return false;
+
+    if ( tilesManager() )
+        return true;
+
+    // compare the areas, the sizes may be swapped by the page rotation
+    const QPixmap *pixmap = mPage->d->m_pixmaps.value( mObserver ).m_pixmap;
+    return pixmap && (qint64)pixmap->width() * pixmap->height() >= (qint64)mWidth * mHeight;
+}
+
 PixmapRequestPrivate *PixmapRequestPrivate::get(const PixmapRequest *req)
 {
     return req->d;
@@ -22,6 +22,7 @@
 #include "pagesize.h"
 
 #include <QList>
+#include <QMap>
 #include <QObject>
 #include <QSharedDataPointer>
 #include <QSizeF>
@@ -192,6 +193,7 @@ class OKULARCORE_EXPORT Generator : public QObject
     /// @cond PRIVATE
     friend class PixmapGenerationThread;
     friend class TextPageGenerationThread;
+    friend class TextSearchJobInternal;
     /// @endcond
 
     Q_OBJECT
@@ -213,7 +215,8 @@ class OKULARCORE_EXPORT Generator : public QObject
             PrintToFile,       ///< Whether the Generator supports export to PDF & PS through the Print Dialog
             TiledRendering,    ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
             SwapBackingFile,   ///< Whether the Generator can hot-swap the file it's reading from @since 1.3
-            SupportsCancelling ///< Whether the Generator can cancel requests @since 1.4
+            SupportsCancelling, ///< Whether the Generator can cancel requests @since 1.4
+            ParallelRendering  ///< Whether the Generator can render several pixmap requests at the same time from different threads @since 1.10
         };
 
         /**
@@ -307,6 +310,9 @@ class OKULARCORE_EXPORT Generator : public QObject
         /**
          * This method returns whether the generator is ready to
          * handle a new pixmap request.
+         *
+         * Generators with the @ref ParallelRendering feature are ready as
+         * long as one of their rendering threads is idle.
          */
         virtual bool canGeneratePixmap() const;
 
@@ -522,7 +528,8 @@ class OKULARCORE_EXPORT Generator : public QObject
          * Must return a null image if the request was cancelled and the generator supports cancelling
          *
          * @warning this method may be executed in its own separated thread if the
-         * @ref Threaded is enabled!
+         * @ref Threaded is enabled! If @ref ParallelRendering is enabled too it
+         * may be executed by several threads at the same time.
          */
         virtual QImage image( PixmapRequest *request );
 
@@ -538,6 +545,49 @@ class OKULARCORE_EXPORT Generator : public QObject
          */
         virtual TextPage* textPage( TextRequest *request );
 
+        /**
+         * Loads the annotations, form fields, page actions and transition of
+         * @p page, that the generator left out when loading the document by
+         * marking the page with Page::setDetailsLoaded( false ).
+         *
+         * It is called at most once per page, from the main thread, when the
+         * page is shown, when its details are needed or when the document is
+         * idle. The default implementation does nothing.
+         *
+         * @since 1.10
+         */
+        virtual void loadPageDetails( Page *page );
+
+        /**
+         * Frees up to @p bytes of the memory that the generator keeps by
+         * itself, e.g. decoded pages or rendered images, and returns how
+         * many bytes it freed.
+         *
+         * It is called from the main thread when the pixmaps of the document
+         * take more memory than what the memory level allows, so it must not
+         * wait for a rendering in progress. The default implementation does
+         * nothing and returns 0.
+         *
+         * @since 1.10
+         */
+        virtual qulonglong freeCachedMemory( qulonglong bytes );
+
+        /**
+         * Returns the pages that may contain @p text, as told by a search
+         * index of the document that the generator has, e.g. one the document
+         * format provides, so that Document::searchText() does not extract
+         * the text of the other pages.
+         *
+         * The returned array has a bit per page. It must be set for every
+         * page where TextPage::findText() may find @p text ignoring the case,
+         * and is better set for a few more pages than missing one. It is
+         * called from the main thread. The default implementation returns a
+         * null array, meaning every page has to be searched.
+         *
+         * @since 1.10
+         */
+        virtual QBitArray pagesMatchingText( const QString &text );
+
         /**
          * Returns a pointer to the document.
          */
@@ -586,6 +636,20 @@ class OKULARCORE_EXPORT Generator : public QObject
          */
         void updatePageBoundingBox( int page, const NormalizedRect & boundingBox );
 
+        /**
+         * Set the size of some pages after they have already been handed to
+         * the Document, e.g. when the generator gave them a provisional size
+         * to load the document faster. @p sizes maps page numbers to their
+         * width and height, as given to the Page constructor.
+         *
+         * It must be called from the main thread. The sizes given within a
+         * short time are applied together, so a generator can report them one
+         * page at a time and the observers still relayout the pages once.
+         *
+         * @since 1.10
+         */
+        void updatePageSizes( const QMap< int, QSizeF > &sizes );
+
         /**
          * Returns DPI, previously set via setDPI()
          * @since 0.19 (KDE 4.13)
@@ -640,7 +704,8 @@ class OKULARCORE_EXPORT PixmapRequest
         {
             NoFeature = 0,
             Asynchronous = 1,
-            Preload = 2
+            Preload = 2,
+            Preview = 4 ///< A quick low resolution render, shown until the full one is ready @since 1.10
         };
         Q_DECLARE_FLAGS( PixmapRequestFeatures, PixmapRequestFeature )
 
@@ -702,6 +767,17 @@ class OKULARCORE_EXPORT PixmapRequest
          */
         bool preload() const;
 
+        /**
+         * Returns whether the request is for a low resolution preview of the
+         * page, that is replaced by the full render as soon as it's ready.
+         *
+         * Generators can render previews in a cheaper way, e.g. skipping
+         * antialiasing.
+         *
+         * @since 1.10
+         */
+        bool preview() const;
+
         /**
          * Returns a pointer to the page where the pixmap shall be generated for.
          */
@@ -18,6 +18,7 @@
 #include <QSet>
 #include <QThread>
 #include <QImage>
+#include <QVector>
 
 class QEventLoop;
 class QMutex;
@@ -48,12 +49,16 @@ class GeneratorPrivate
         Q_DECLARE_PUBLIC( Generator )
         Generator *q_ptr;
 
+        // returns an idle thread of the pixmap rendering pool, creating it if needed
         PixmapGenerationThread* pixmapGenerationThread();
         TextPageGenerationThread* textPageGenerationThread();
 
-        void pixmapGenerationFinished();
+        void pixmapGenerationFinished( PixmapGenerationThread *thread );
         void textpageGenerationFinished();
 
+        // how many pixmap requests can be rendered at the same time
+        int maxPixmapGenerationThreads() const;
+
         QMutex* threadsLock();
 
         virtual QVariant metaData( const QString &key, const QVariant &option ) const;
@@ -63,11 +68,11 @@ class GeneratorPrivate
         // NOTE: the following should be a QSet< GeneratorFeature >,
         // but it is not to avoid #include'ing generator.h
         QSet< int > m_features;
-        PixmapGenerationThread *mPixmapGenerationThread;
+        QVector< PixmapGenerationThread * > mPixmapGenerationThreads;
         TextPageGenerationThread *mTextPageGenerationThread;
         mutable QMutex *m_mutex;
         QMutex *m_threadsMutex;
-        bool mPixmapReady : 1;
+        int mRunningPixmapRequests;
         bool mTextPageReady : 1;
         bool m_closing : 1;
         QEventLoop *m_closingLoop;
@@ -81,6 +86,10 @@ class PixmapRequestPrivate
         void swap();
         TilesManager *tilesManager() const;
 
+        // whether this is a preview request of a page that already has a
+        // pixmap at least as big, or tiles, making it useless
+        bool isOutdatedPreview() const;
+
         static PixmapRequestPrivate *get(const PixmapRequest *req);
 
         DocumentObserver *mObserver;
@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "objectrectindex_p.h"
+
+#include <QPainterPath>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Okular;
+
+// below this many rects of a type walking them is as fast as the grid
+static const int minimumGridRects = 32;
+static const int maximumGridSide = 128;
+
+static inline int cellIndex( double position, int cells )
+{
+    return qBound( 0, static_cast< int >( std::floor( position * cells ) ), cells - 1 );
+}
+
+ObjectRectIndex::ObjectRectIndex( const QLinkedList< ObjectRect * > &rects )
+{
+    for ( ObjectRect *rect : rects )
+        m_rects[ rect->objectType() ].append( rect );
+
+    for ( ObjectRect::ObjectType type : { ObjectRect::Action, ObjectRect::Image } )
+    {
+        const QVector< ObjectRect * > &typeRects = m_rects[ type ];
+        if ( typeRects.count() < minimumGridRects )
+            continue;
+
+        // about four rects per cell if they were evenly spread
+        Grid &grid = m_grids[ type ];
+        grid.columns = grid.rows = qBound( 1, static_cast< int >( std::sqrt( typeRects.count() / 4.0 ) ), maximumGridSide );
+        grid.cells.resize( grid.columns * grid.rows );
+        for ( int i = 0; i < typeRects.count(); ++i )
+        {
+            // rects outside of the page end up in the border cells
+            const QRectF bounds = typeRects.at( i )->region().boundingRect();
+            const int left = cellIndex( bounds.left(), grid.columns ), right = cellIndex( bounds.right(), grid.columns );
+            const int top = cellIndex( bounds.top(), grid.rows ), bottom = cellIndex( bounds.bottom(), grid.rows );
+            for ( int row = top; row <= bottom; ++row )
+                for ( int column = left; column <= right; ++column )
+                    grid.cells[ row * grid.columns + column ].append( i );
+        }
+    }
+}
+
+QVector< const ObjectRect * > ObjectRectIndex::candidates( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double distance ) const
+{
+    QVector< const ObjectRect * > result;
+    const QVector< ObjectRect * > &typeRects = m_rects[ type ];
+    const Grid &grid = m_grids[ type ];
+
+    if ( grid.cells.isEmpty() || !( xScale > 0 ) || !( yScale > 0 ) || !std::isfinite( distance ) )
+    {
+        result.reserve( typeRects.count() );
+        for ( int i = typeRects.count() - 1; i >= 0; --i )
+            result.append( typeRects.at( i ) );
+        return result;
+    }
+
+    // the cells of the area around the point within 'distance' pixels
+    const double dx = distance / xScale, dy = distance / yScale;
+    const int left = cellIndex( x - dx, grid.columns ), right = cellIndex( x + dx, grid.columns );
+    const int top = cellIndex( y - dy, grid.rows ), bottom = cellIndex( y + dy, grid.rows );
+
+    QVector< int > indexes;
+    for ( int row = top; row <= bottom; ++row )
+        for ( int column = left; column <= right; ++column )
+            indexes += grid.cells.at( row * grid.columns + column );
+
+    // a rect can be in more than one of the cells
+    if ( left != right || top != bottom )
+    {
+        std::sort( indexes.begin(), indexes.end() );
+        indexes.erase( std::unique( indexes.begin(), indexes.end() ), indexes.end() );
+    }
+
+    result.reserve( indexes.count() );
+    for ( int i = indexes.count() - 1; i >= 0; --i )
+        result.append( typeRects.at( indexes.at( i ) ) );
+    return result;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -0,0 +1,62 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_OBJECTRECTINDEX_P_H_
+#define _OKULAR_OBJECTRECTINDEX_P_H_
+
+#include <QLinkedList>
+#include <QVector>
+
+#include "area.h"
+
+namespace Okular {
+
+/* A snapshot of the object rects of a page, grouped by type in page order,
+ * for the hit testing done on every mouse move.
+ *
+ * Actions and images do not move once added, so they are also bucketed in
+ * a uniform grid over the page, and a lookup only looks at the rects of the
+ * cells around the point. Annotations can be moved at any time and source
+ * references are lines, so those are simply walked.
+ *
+ * The rects in the foreground, i.e. the last ones in the page list, are
+ * preferred as Page always did. The index must be rebuilt whenever the rects
+ * of the page are added, removed, or rotated. */
+class ObjectRectIndex
+{
+    public:
+        explicit ObjectRectIndex( const QLinkedList< ObjectRect * > &rects );
+
+        /* Returns the rects of @p type that can be closer than @p distance
+         * pixels to the point (@p x, @p y) at a page size of @p xScale x
+         * @p yScale, from the foreground to the background. The caller still
+         * has to check their actual distance */
+        QVector< const ObjectRect * > candidates( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double distance ) const;
+
+    private:
+        Q_DISABLE_COPY( ObjectRectIndex )
+
+        struct Grid
+        {
+            int columns = 0;
+            int rows = 0;
+            // indexes in the rects of the type, in increasing order for each cell
+            QVector< QVector< int > > cells;
+        };
+
+        static const int s_typeCount = ObjectRect::SourceRef + 1;
+        QVector< ObjectRect * > m_rects[ s_typeCount ];
+        Grid m_grids[ s_typeCount ];
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -35,6 +35,7 @@
 #include "document_p.h"
 #include "form.h"
 #include "form_p.h"
+#include "objectrectindex_p.h"
 #include "observer.h"
 #include "pagecontroller_p.h"
 #include "pagesize.h"
@@ -55,6 +56,7 @@
 using namespace Okular;
 
 static const double distanceConsideredEqual = 25; // 5px
+static const double distanceConsideredEqualPx = 5;
 
 static void deleteObjectRects( QLinkedList< ObjectRect * >& rects, const QSet<ObjectRect::ObjectType>& which )
 {
@@ -73,9 +75,9 @@ PagePrivate::PagePrivate( Page *page, uint n, double w, double h, Rotation o )
     : m_page( page ), m_number( n ), m_orientation( o ),
       m_width( w ), m_height( h ), m_doc( nullptr ), m_boundingBox( 0, 0, 1, 1 ),
       m_rotation( Rotation0 ),
-      m_text( nullptr ), m_transition( nullptr ), m_textSelections( nullptr ),
+      m_text( nullptr ), m_transition( nullptr ), m_textSelections( nullptr ), m_objectRectIndex( nullptr ),
       m_openingAction( nullptr ), m_closingAction( nullptr ), m_duration( -1 ),
-      m_isBoundingBoxKnown( false )
+      m_isBoundingBoxKnown( false ), m_detailsLoaded( true )
 {
     // avoid Division-By-Zero problems in the program
     if ( m_width <= 0 )
@@ -92,6 +94,7 @@ PagePrivate::~PagePrivate()
     delete m_closingAction;
     delete m_text;
     delete m_transition;
+    delete m_objectRectIndex;
 }
 
 PagePrivate *PagePrivate::get( Page * page )
@@ -114,6 +117,7 @@ void PagePrivate::imageRotationDone( RotationJob * job )
     if ( it != m_pixmaps.end() )
     {
         PixmapObject &object = it.value();
+        deleteTransformedPixmap( it.key(), object );
         (*object.m_pixmap) = QPixmap::fromImage( job->image() );
         object.m_rotation = job->rotation();
     } else {
@@ -266,10 +270,14 @@ bool Page::hasObjectRect( double x, double y, double xScale, double yScale ) con
     if ( m_rects.isEmpty() )
         return false;
 
-    QLinkedList< ObjectRect * >::const_iterator it = m_rects.begin(), end = m_rects.end();
-    for ( ; it != end; ++it )
-        if ( (*it)->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
-            return true;
+    const ObjectRectIndex *index = d->objectRectIndex();
+    for ( ObjectRect::ObjectType type : { ObjectRect::Action, ObjectRect::Image, ObjectRect::OAnnotation, ObjectRect::SourceRef } )
+    {
+        const QVector< const ObjectRect * > rects = index->candidates( type, x, y, xScale, yScale, distanceConsideredEqualPx );
+        for ( const ObjectRect *objrect : rects )
+            if ( objrect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
+                return true;
+    }
 
     return false;
 }
@@ -409,6 +417,7 @@ void PagePrivate::rotateAt( Rotation orientation )
     QLinkedList< ObjectRect * >::const_iterator objectIt = m_page->m_rects.begin(), end = m_page->m_rects.end();
     for ( ; objectIt != end; ++objectIt )
         (*objectIt)->transform( matrix );
+    invalidateObjectRectIndex();
 
     const QTransform highlightRotationMatrix = Okular::buildRotationMatrix( (Rotation)(((int)m_rotation - (int)oldRotation + 4) % 4) );
     QLinkedList< HighlightAreaRect* >::const_iterator hlIt = m_page->m_highlights.begin(), hlItEnd = m_page->m_highlights.end();
@@ -420,7 +429,9 @@ void PagePrivate::rotateAt( Rotation orientation )
 
 void PagePrivate::changeSize( const PageSize &size )
 {
-    if ( size.isNull() || ( size.width() == m_width && size.height() == m_height ) )
+    // m_width and m_height are rotated, the size is not
+    const bool swapped = m_rotation % 2;
+    if ( size.isNull() || ( size.width() == ( swapped ? m_height : m_width ) && size.height() == ( swapped ? m_width : m_height ) ) )
         return;
 
     m_page->deletePixmaps();
@@ -435,13 +446,11 @@ void PagePrivate::changeSize( const PageSize &size )
 
 const ObjectRect * Page::objectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const
 {
-    // Walk list in reverse order so that annotations in the foreground are preferred
-    QLinkedListIterator< ObjectRect * > it( m_rects );
-    it.toBack();
-    while ( it.hasPrevious() )
+    // The candidates come in reverse order so that annotations in the foreground are preferred
+    const QVector< const ObjectRect * > rects = d->objectRectIndex()->candidates( type, x, y, xScale, yScale, distanceConsideredEqualPx );
+    for ( const ObjectRect *objrect : rects )
     {
-        const ObjectRect *objrect = it.previous();
-        if ( ( objrect->objectType() == type ) && objrect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
+        if ( objrect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
             return objrect;
     }
 
@@ -452,12 +461,10 @@ QLinkedList< const ObjectRect * > Page::objectRects( ObjectRect::ObjectType type
 {
     QLinkedList< const ObjectRect * > result;
 
-    QLinkedListIterator< ObjectRect * > it( m_rects );
-    it.toBack();
-    while ( it.hasPrevious() )
+    const QVector< const ObjectRect * > rects = d->objectRectIndex()->candidates( type, x, y, xScale, yScale, distanceConsideredEqualPx );
+    for ( const ObjectRect *objrect : rects )
     {
-        const ObjectRect *objrect = it.previous();
-        if ( ( objrect->objectType() == type ) && objrect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
+        if ( objrect->distanceSqr( x, y, xScale, yScale ) < distanceConsideredEqual )
             result.append( objrect );
     }
 
@@ -467,20 +474,18 @@ QLinkedList< const ObjectRect * > Page::objectRects( ObjectRect::ObjectType type
 
 const ObjectRect* Page::nearestObjectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double * distance ) const
 {
-    ObjectRect * res = nullptr;
+    const ObjectRect * res = nullptr;
     double minDistance = std::numeric_limits<double>::max();
 
-    QLinkedList< ObjectRect * >::const_iterator it = m_rects.constBegin(), end = m_rects.constEnd();
-    for ( ; it != end; ++it )
+    // walked from the foreground, on ties the one in the background wins as it always did
+    const QVector< const ObjectRect * > rects = d->objectRectIndex()->candidates( type, x, y, xScale, yScale, std::numeric_limits<double>::infinity() );
+    for ( const ObjectRect *objrect : rects )
     {
-        if ( (*it)->objectType() == type )
+        const double d = objrect->distanceSqr( x, y, xScale, yScale );
+        if ( d <= minDistance )
         {
-            double d = (*it)->distanceSqr( x, y, xScale, yScale );
-            if ( d < minDistance )
-            {
-                res = (*it);
-                minDistance = d;
-            }
+            res = objrect;
+            minDistance = d;
         }
     }
 
@@ -548,6 +553,7 @@ void PagePrivate::setPixmap( DocumentObserver *observer, QPixmap *pixmap, const
         QMap< DocumentObserver*, PagePrivate::PixmapObject >::iterator it = m_pixmaps.find( observer );
         if ( it != m_pixmaps.end() )
         {
+            deleteTransformedPixmap( observer, it.value() );
             delete it.value().m_pixmap;
         }
         else
@@ -571,17 +577,114 @@ void PagePrivate::setPixmap( DocumentObserver *observer, QPixmap *pixmap, const
     }
 }
 
-void Page::setTextPage( TextPage * textPage )
+const QPixmap *PagePrivate::transformedPixmap( DocumentObserver *observer, quint64 key ) const
 {
-    delete d->m_text;
+    QMap< DocumentObserver*, PagePrivate::PixmapObject >::const_iterator it = m_pixmaps.constFind( observer );
+    if ( it == m_pixmaps.constEnd() || it.value().m_transformKey != key )
+        return nullptr;
 
-    d->m_text = textPage;
-    if ( d->m_text )
+    return it.value().m_transformedPixmap;
+}
+
+void PagePrivate::setTransformedPixmap( DocumentObserver *observer, quint64 key, QPixmap *pixmap )
+{
+    QMap< DocumentObserver*, PagePrivate::PixmapObject >::iterator it = m_pixmaps.find( observer );
+    if ( it == m_pixmaps.end() )
     {
-        d->m_text->d->m_page = this;
-        // Correct/optimize text order for search and text selection
-        d->m_text->d->correctTextOrder();
+        delete pixmap;
+        return;
     }
+
+    deleteTransformedPixmap( observer, it.value() );
+    it.value().m_transformedPixmap = pixmap;
+    it.value().m_transformKey = key;
+    if ( m_doc )
+        m_doc->adjustAllocatedPixmapMemory( observer, m_number, 4LL * pixmap->width() * pixmap->height() );
+}
+
+void PagePrivate::deleteTransformedPixmaps()
+{
+    QMap< DocumentObserver*, PagePrivate::PixmapObject >::iterator it = m_pixmaps.begin(), end = m_pixmaps.end();
+    for ( ; it != end; ++it )
+        deleteTransformedPixmap( it.key(), it.value() );
+}
+
+const QPixmap *PagePrivate::scaledPixmap( DocumentObserver *observer, qint64 sourceKey, int width, int height ) const
+{
+    QMap< DocumentObserver*, PagePrivate::PixmapObject >::const_iterator it = m_pixmaps.constFind( observer );
+    if ( it == m_pixmaps.constEnd() || !it.value().m_scaledPixmap || it.value().m_scaledSourceKey != sourceKey )
+        return nullptr;
+
+    const QPixmap *scaled = it.value().m_scaledPixmap;
+    if ( scaled->width() != width || scaled->height() != height )
+        return nullptr;
+
+    return scaled;
+}
+
+void PagePrivate::setScaledPixmap( DocumentObserver *observer, qint64 sourceKey, QPixmap *pixmap )
+{
+    QMap< DocumentObserver*, PagePrivate::PixmapObject >::iterator it = m_pixmaps.find( observer );
+    if ( it == m_pixmaps.end() )
+    {
+        delete pixmap;
+        return;
+    }
+
+    deleteScaledPixmap( observer, it.value() );
+    it.value().m_scaledPixmap = pixmap;
+    it.value().m_scaledSourceKey = sourceKey;
+    if ( m_doc )
+        m_doc->adjustAllocatedPixmapMemory( observer, m_number, 4LL * pixmap->width() * pixmap->height() );
+}
+
+void PagePrivate::deleteScaledPixmap( DocumentObserver *observer, PixmapObject &object )
+{
+    if ( !object.m_scaledPixmap )
+        return;
+
+    if ( m_doc )
+        m_doc->adjustAllocatedPixmapMemory( observer, m_number, -4LL * object.m_scaledPixmap->width() * object.m_scaledPixmap->height() );
+    delete object.m_scaledPixmap;
+    object.m_scaledPixmap = nullptr;
+    object.m_scaledSourceKey = 0;
+}
+
+void PagePrivate::deleteTransformedPixmap( DocumentObserver *observer, PixmapObject &object )
+{
+    // the scaled pixmap may derive from the transformed one
+    deleteScaledPixmap( observer, object );
+
+    if ( !object.m_transformedPixmap )
+        return;
+
+    if ( m_doc )
+        m_doc->adjustAllocatedPixmapMemory( observer, m_number, -4LL * object.m_transformedPixmap->width() * object.m_transformedPixmap->height() );
+    delete object.m_transformedPixmap;
+    object.m_transformedPixmap = nullptr;
+    object.m_transformKey = 0;
+}
+
+void PagePrivate::prepareTextPage( TextPage *textPage )
+{
+    textPage->d->m_page = m_page;
+    // Correct/optimize text order for search and text selection
+    textPage->d->correctTextOrder();
+}
+
+void PagePrivate::setPreparedTextPage( TextPage *textPage )
+{
+    delete m_text;
+
+    m_text = textPage;
+}
+
+void Page::setTextPage( TextPage * textPage )
+{
+    if ( textPage )
+        d->prepareTextPage( textPage );
+
+    d->setPreparedTextPage( textPage );
 }
 
 void Page::setObjectRects( const QLinkedList< ObjectRect * > & rects )
@@ -600,6 +703,7 @@ void Page::setObjectRects( const QLinkedList< ObjectRect * > & rects )
         (*objectIt)->transform( matrix );
 
     m_rects << rects;
+    d->invalidateObjectRectIndex();
 }
 
 void PagePrivate::setHighlight( int s_id, RegularAreaRect *rect, const QColor & color )
@@ -630,6 +734,7 @@ void Page::setSourceReferences( const QLinkedList< SourceRefObjectRect * > & ref
     for ( SourceRefObjectRect *rect : refRects ) {
         m_rects << rect;
     }
+    d->invalidateObjectRectIndex();
 }
 
 void Page::setDuration( double seconds )
@@ -680,6 +785,7 @@ void Page::addAnnotation( Annotation * annotation )
     annotation->d_ptr->annotationTransform( matrix );
 
     m_rects.append( rect );
+    d->invalidateObjectRectIndex();
 }
 
 bool Page::removeAnnotation( Annotation * annotation )
@@ -701,6 +807,7 @@ bool Page::removeAnnotation( Annotation * annotation )
                     it = m_rects.erase( it );
                     rectfound = true;
                 }
+            d->invalidateObjectRectIndex();
             qCDebug(OkularCoreDebug) << "removed annotation:" << annotation->uniqueName();
             annotation->d_ptr->m_page = nullptr;
             m_annotations.erase( aIt );
@@ -743,6 +850,16 @@ void Page::setFormFields( const QLinkedList< FormField * >& fields )
     }
 }
 
+void Page::setDetailsLoaded( bool loaded )
+{
+    d->m_detailsLoaded = loaded;
+}
+
+bool Page::detailsLoaded() const
+{
+    return d->m_detailsLoaded;
+}
+
 void Page::deletePixmap( DocumentObserver *observer )
 {
     TilesManager *tm = d->tilesManager( observer );
@@ -755,6 +872,8 @@ void Page::deletePixmap( DocumentObserver *observer )
     {
         PagePrivate::PixmapObject object = d->m_pixmaps.take( observer );
         delete object.m_pixmap;
+        delete object.m_transformedPixmap;
+        delete object.m_scaledPixmap;
     }
 }
 
@@ -764,6 +883,8 @@ void Page::deletePixmaps()
     while ( it.hasNext() ) {
         it.next();
         delete it.value().m_pixmap;
+        delete it.value().m_transformedPixmap;
+        delete it.value().m_scaledPixmap;
     }
 
     d->m_pixmaps.clear();
@@ -778,6 +899,7 @@ void Page::deleteRects()
     QSet<ObjectRect::ObjectType> which;
     which << ObjectRect::Action << ObjectRect::Image;
     deleteObjectRects( m_rects, which );
+    d->invalidateObjectRectIndex();
 }
 
 void PagePrivate::deleteHighlights( int s_id )
@@ -806,12 +928,14 @@ void PagePrivate::deleteTextSelections()
 void Page::deleteSourceReferences()
 {
     deleteObjectRects( m_rects, QSet<ObjectRect::ObjectType>() << ObjectRect::SourceRef );
+    d->invalidateObjectRectIndex();
 }
 
 void Page::deleteAnnotations()
 {
     // delete ObjectRects of type Annotation
     deleteObjectRects( m_rects, QSet<ObjectRect::ObjectType>() << ObjectRect::OAnnotation );
+    d->invalidateObjectRectIndex();
     // delete all stored annotations
     QLinkedList< Annotation * >::const_iterator aIt = m_annotations.begin(), aEnd = m_annotations.end();
     for ( ; aIt != aEnd; ++aIt )
@@ -823,6 +947,9 @@ bool PagePrivate::restoreLocalContents( const QDomNode & pageNode )
 {
     bool loadedAnything = false; // set if something actually gets loaded
 
+    // the restored contents refer to the ones of the document
+    m_doc->loadPageDetails( m_number, false );
+
     // iterate over all children (annotationList, ...)
     QDomNode childNode = pageNode.firstChild();
     while ( childNode.isElement() )
@@ -1071,6 +1198,19 @@ void PagePrivate::setTilesManager( const DocumentObserver *observer, TilesManage
     m_tilesManagers.insert(observer, tm);
 }
 
+const ObjectRectIndex *PagePrivate::objectRectIndex()
+{
+    if ( !m_objectRectIndex )
+        m_objectRectIndex = new ObjectRectIndex( m_page->m_rects );
+    return m_objectRectIndex;
+}
+
+void PagePrivate::invalidateObjectRectIndex()
+{
+    delete m_objectRectIndex;
+    m_objectRectIndex = nullptr;
+}
+
 void PagePrivate::adoptGeneratedContents( PagePrivate *oldPage )
 {
     rotateAt( oldPage->m_rotation );
@@ -352,6 +352,29 @@ class OKULARCORE_EXPORT Page
          */
         void setFormFields( const QLinkedList< FormField * >& fields );
 
+        /**
+         * Sets whether the annotations, form fields, page actions and
+         * transition of the page have been loaded, which is the default.
+         *
+         * Generators that load them only when needed mark their pages as
+         * not loaded yet; the document then calls Generator::loadPageDetails()
+         * when the page is shown or its details are needed.
+         *
+         * Once the page is in the document, call it while holding the
+         * generator's user mutex, as the render threads read it.
+         *
+         * @since 1.10
+         */
+        void setDetailsLoaded( bool loaded );
+
+        /**
+         * Returns whether the annotations, form fields, page actions and
+         * transition of the page have been loaded.
+         *
+         * @since 1.10
+         */
+        bool detailsLoaded() const;
+
         /**
          * Deletes the pixmap for the given @p observer
          */
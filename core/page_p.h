@@ -35,6 +35,7 @@ class DocumentObserver;
 class DocumentPrivate;
 class FormField;
 class HighlightAreaRect;
+class ObjectRectIndex;
 class Page;
 class PageSize;
 class PageTransition;
@@ -141,12 +142,84 @@ class PagePrivate
 
         void setPixmap( DocumentObserver *observer, QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap );
 
+        /**
+         * Binds @p textPage to the page and corrects its text order, like
+         * Page::setTextPage() does, but without setting it. Allows to prepare
+         * text pages outside of the GUI thread.
+         */
+        void prepareTextPage( TextPage *textPage );
+
+        /**
+         * Sets the text page of the page to @p textPage, that must have been
+         * prepared by prepareTextPage() already.
+         */
+        void setPreparedTextPage( TextPage *textPage );
+
+        /**
+         * Returns the pixmap of @p observer with its colors transformed by the
+         * transformation identified by @p key, if setTransformedPixmap() stored
+         * one for the current pixmap, otherwise returns nullptr.
+         */
+        OKULARCORE_EXPORT const QPixmap *transformedPixmap( DocumentObserver *observer, quint64 key ) const;
+
+        /**
+         * Stores @p pixmap, owned by the page from now on, as the pixmap of
+         * @p observer with its colors transformed by the transformation
+         * identified by @p key.
+         *
+         * Its memory is accounted together with the one of the pixmap it
+         * derives from, and it is deleted when that one is replaced or deleted.
+         */
+        OKULARCORE_EXPORT void setTransformedPixmap( DocumentObserver *observer, quint64 key, QPixmap *pixmap );
+
+        /**
+         * Deletes all the transformed pixmaps of the page.
+         */
+        void deleteTransformedPixmaps();
+
+        /**
+         * Returns the pixmap of @p observer rescaled to @p width x @p height
+         * from the pixmap with cache key @p sourceKey, if setScaledPixmap()
+         * stored it, otherwise returns nullptr.
+         */
+        OKULARCORE_EXPORT const QPixmap *scaledPixmap( DocumentObserver *observer, qint64 sourceKey, int width, int height ) const;
+
+        /**
+         * Stores @p pixmap, owned by the page from now on, as the pixmap of
+         * @p observer rescaled from the pixmap with cache key @p sourceKey,
+         * replacing the one of any other size.
+         *
+         * Like the transformed pixmap, its memory is accounted together with
+         * the one of the pixmap it derives from, and it is deleted with it.
+         */
+        OKULARCORE_EXPORT void setScaledPixmap( DocumentObserver *observer, qint64 sourceKey, QPixmap *pixmap );
+
+        /**
+         * Returns the index of the object rects of the page, building it
+         * if the rects changed since the last call.
+         */
+        const ObjectRectIndex *objectRectIndex();
+
+        /**
+         * Drops the index of the object rects, to be called whenever they
+         * are added, removed or transformed.
+         */
+        void invalidateObjectRectIndex();
+
         class PixmapObject
         {
             public:
                 QPixmap *m_pixmap = nullptr;
                 Rotation m_rotation;
+                // m_pixmap with transformed colors, see setTransformedPixmap()
+                QPixmap *m_transformedPixmap = nullptr;
+                quint64 m_transformKey = 0;
+                // m_pixmap or m_transformedPixmap rescaled, see setScaledPixmap()
+                QPixmap *m_scaledPixmap = nullptr;
+                qint64 m_scaledSourceKey = 0;
         };
+        void deleteTransformedPixmap( DocumentObserver *observer, PixmapObject &object );
+        void deleteScaledPixmap( DocumentObserver *observer, PixmapObject &object );
         QMap< DocumentObserver*, PixmapObject > m_pixmaps;
         QMap< const DocumentObserver*, TilesManager *> m_tilesManagers;
 
@@ -161,6 +234,7 @@ class PagePrivate
         TextPage * m_text;
         PageTransition * m_transition;
         HighlightAreaRect *m_textSelections;
+        ObjectRectIndex *m_objectRectIndex;
         QLinkedList< FormField * > formfields;
         Action * m_openingAction;
         Action * m_closingAction;
@@ -168,6 +242,8 @@ class PagePrivate
         QString m_label;
 
         bool m_isBoundingBoxKnown : 1;
+        // not a bit field, it is read by the render threads
+        bool m_detailsLoaded;
         QDomDocument restoredLocalAnnotationList; // <annotationList>...</annotationList>
         QDomDocument restoredFormFieldList; // <forms>...</forms>
 };
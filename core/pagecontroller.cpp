@@ -12,6 +12,7 @@
 // local includes
 #include "page_p.h"
 #include "rotationjob_p.h"
+#include "textsearchjob_p.h"
 
 #include <threadweaver/queueing.h>
 
@@ -44,3 +45,17 @@ void PageController::imageRotationDone(const ThreadWeaver::JobPointer &j)
         emit rotationFinished( job->page()->m_number, job->page()->m_page );
     }
 }
+
+void PageController::addTextSearchJob(TextSearchJob *job)
+{
+    connect( job, SIGNAL(done(ThreadWeaver::JobPointer)),
+             this, SLOT(textSearchDone(ThreadWeaver::JobPointer)) );
+    ThreadWeaver::enqueue(&m_weaver, job);
+}
+
+void PageController::textSearchDone(const ThreadWeaver::JobPointer &j)
+{
+    TextSearchJob *job = static_cast< TextSearchJob * >( j.data() );
+
+    emit textSearchFinished( job );
+}
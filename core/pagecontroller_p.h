@@ -18,9 +18,10 @@ namespace Okular {
 
 class Page;
 class RotationJob;
+class TextSearchJob;
 
 /* There is one PageController per document. It receives notifications of
- * completed RotationJobs */
+ * completed RotationJobs and TextSearchJobs */
 class PageController : public QObject
 {
     Q_OBJECT
@@ -30,12 +31,15 @@ class PageController : public QObject
         ~PageController() override;
 
         void addRotationJob( RotationJob *job );
+        void addTextSearchJob( TextSearchJob *job );
 
     Q_SIGNALS:
         void rotationFinished( int page, Okular::Page *okularPage );
+        void textSearchFinished( Okular::TextSearchJob *job );
 
     private Q_SLOTS:
         void imageRotationDone(const ThreadWeaver::JobPointer &job);
+        void textSearchDone(const ThreadWeaver::JobPointer &job);
 
     private:
         ThreadWeaver::Queue m_weaver;
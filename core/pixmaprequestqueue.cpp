@@ -0,0 +1,180 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "pixmaprequestqueue_p.h"
+
+// local includes
+#include "generator.h"
+
+using namespace Okular;
+
+PixmapRequestQueue::PixmapRequestQueue()
+    : m_pushed( 0 )
+{
+}
+
+PixmapRequestQueue::~PixmapRequestQueue()
+{
+}
+
+bool PixmapRequestQueue::isEmpty() const
+{
+    return m_heap.isEmpty();
+}
+
+int PixmapRequestQueue::count() const
+{
+    return m_heap.count();
+}
+
+bool PixmapRequestQueue::goesBefore( const Entry &a, const Entry &b )
+{
+    if ( a.priority != b.priority )
+        return a.priority < b.priority;
+    return a.order < b.order;
+}
+
+void PixmapRequestQueue::place( int position, const Entry &entry )
+{
+    m_heap[ position ] = entry;
+    m_positions[ entry.request ] = position;
+}
+
+void PixmapRequestQueue::siftUp( int position )
+{
+    const Entry entry = m_heap.at( position );
+    while ( position > 0 )
+    {
+        const int parent = ( position - 1 ) / 2;
+        if ( !goesBefore( entry, m_heap.at( parent ) ) )
+            break;
+        place( position, m_heap.at( parent ) );
+        position = parent;
+    }
+    place( position, entry );
+}
+
+void PixmapRequestQueue::siftDown( int position )
+{
+    const Entry entry = m_heap.at( position );
+    const int size = m_heap.count();
+    while ( true )
+    {
+        int child = 2 * position + 1;
+        if ( child >= size )
+            break;
+        if ( child + 1 < size && goesBefore( m_heap.at( child + 1 ), m_heap.at( child ) ) )
+            ++child;
+        if ( !goesBefore( m_heap.at( child ), entry ) )
+            break;
+        place( position, m_heap.at( child ) );
+        position = child;
+    }
+    place( position, entry );
+}
+
+void PixmapRequestQueue::push( PixmapRequest *request )
+{
+    Q_ASSERT( !m_positions.contains( request ) );
+
+    // priority 0 requests are stacked, the others are queued
+    ++m_pushed;
+    const Entry entry = { request, request->priority(), request->priority() == 0 ? -m_pushed : m_pushed };
+    m_heap.append( entry );
+    m_positions.insert( request, m_heap.count() - 1 );
+    m_observerRequests[ request->observer() ].insert( request->pageNumber(), request );
+    siftUp( m_heap.count() - 1 );
+}
+
+PixmapRequest *PixmapRequestQueue::top() const
+{
+    return m_heap.isEmpty() ? nullptr : m_heap.first().request;
+}
+
+PixmapRequest *PixmapRequestQueue::pop()
+{
+    if ( m_heap.isEmpty() )
+        return nullptr;
+
+    PixmapRequest *request = m_heap.first().request;
+    removeAt( 0 );
+    return request;
+}
+
+void PixmapRequestQueue::removeAt( int position )
+{
+    PixmapRequest *request = m_heap.at( position ).request;
+    m_positions.remove( request );
+
+    QHash< DocumentObserver *, QMultiHash< int, PixmapRequest * > >::iterator oIt = m_observerRequests.find( request->observer() );
+    if ( oIt != m_observerRequests.end() )
+    {
+        oIt->remove( request->pageNumber(), request );
+        if ( oIt->isEmpty() )
+            m_observerRequests.erase( oIt );
+    }
+
+    // move the last entry in the hole and restore the heap from there
+    const Entry last = m_heap.takeLast();
+    if ( position < m_heap.count() )
+    {
+        place( position, last );
+        if ( position > 0 && goesBefore( last, m_heap.at( ( position - 1 ) / 2 ) ) )
+            siftUp( position );
+        else
+            siftDown( position );
+    }
+}
+
+void PixmapRequestQueue::remove( PixmapRequest *request )
+{
+    const QHash< PixmapRequest *, int >::const_iterator it = m_positions.constFind( request );
+    if ( it != m_positions.constEnd() )
+        removeAt( it.value() );
+}
+
+QList< PixmapRequest * > PixmapRequestQueue::take( DocumentObserver *observer, const QSet< int > &pages )
+{
+    QList< PixmapRequest * > taken;
+    const QHash< DocumentObserver *, QMultiHash< int, PixmapRequest * > >::const_iterator oIt = m_observerRequests.constFind( observer );
+    if ( oIt == m_observerRequests.constEnd() )
+        return taken;
+
+    for ( int page : pages )
+    {
+        QMultiHash< int, PixmapRequest * >::const_iterator it = oIt->constFind( page );
+        for ( ; it != oIt->constEnd() && it.key() == page; ++it )
+            taken.append( it.value() );
+    }
+    for ( PixmapRequest *request : qAsConst( taken ) )
+        remove( request );
+    return taken;
+}
+
+QList< PixmapRequest * > PixmapRequestQueue::take( DocumentObserver *observer )
+{
+    const QList< PixmapRequest * > taken = m_observerRequests.value( observer ).values();
+    for ( PixmapRequest *request : taken )
+        remove( request );
+    return taken;
+}
+
+QList< PixmapRequest * > PixmapRequestQueue::takeAll()
+{
+    QList< PixmapRequest * > taken;
+    taken.reserve( m_heap.count() );
+    for ( const Entry &entry : qAsConst( m_heap ) )
+        taken.append( entry.request );
+    m_heap.clear();
+    m_positions.clear();
+    m_observerRequests.clear();
+    return taken;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_PIXMAPREQUESTQUEUE_P_H_
+#define _OKULAR_PIXMAPREQUESTQUEUE_P_H_
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QVector>
+
+namespace Okular {
+
+class DocumentObserver;
+class PixmapRequest;
+
+/* The pending pixmap requests, ordered for the generator. The requests
+ * with the lowest priority value go first. Among those with the same
+ * priority the oldest goes first, except for priority 0 (synchronous or
+ * visible pages) where the newest one does.
+ *
+ * The requests are kept in a binary heap and indexed by observer and page,
+ * so adding, cancelling and taking the next one are O(log n) instead of
+ * walking all the pending requests. The queue does not own the requests. */
+class PixmapRequestQueue
+{
+    public:
+        PixmapRequestQueue();
+        ~PixmapRequestQueue();
+
+        bool isEmpty() const;
+        int count() const;
+
+        /* Adds @p request to the queue, its priority must not change while queued */
+        void push( PixmapRequest *request );
+
+        /* Returns the request to process next, or NULL if the queue is empty */
+        PixmapRequest *top() const;
+
+        /* Removes the request returned by top() from the queue and returns it */
+        PixmapRequest *pop();
+
+        /* Removes @p request from the queue, if it is queued */
+        void remove( PixmapRequest *request );
+
+        /* Removes and returns the requests of @p observer for @p pages */
+        QList< PixmapRequest * > take( DocumentObserver *observer, const QSet< int > &pages );
+
+        /* Removes and returns all the requests of @p observer */
+        QList< PixmapRequest * > take( DocumentObserver *observer );
+
+        /* Removes and returns all the requests */
+        QList< PixmapRequest * > takeAll();
+
+    private:
+        Q_DISABLE_COPY( PixmapRequestQueue )
+
+        struct Entry
+        {
+            PixmapRequest *request;
+            int priority;
+            qint64 order;
+        };
+
+        static bool goesBefore( const Entry &a, const Entry &b );
+        void place( int position, const Entry &entry );
+        void siftUp( int position );
+        void siftDown( int position );
+        void removeAt( int position );
+
+        QVector< Entry > m_heap;
+        QHash< PixmapRequest *, int > m_positions;
+        QHash< DocumentObserver *, QMultiHash< int, PixmapRequest * > > m_observerRequests;
+        qint64 m_pushed;
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -13,6 +13,7 @@
 #include <QFile>
 
 #include "debug_p.h"
+#include "document_p.h"
 #include "script/executor_kjs_p.h"
 
 using namespace Okular;
@@ -78,6 +79,8 @@ void Scripter::execute( ScriptType type, const QString &script )
             {
                 d->m_kjs.reset(new ExecutorKJS( d->m_doc ));
             }
+            // scripts can access the fields of every page
+            d->m_doc->loadAllPageDetails();
             d->m_kjs->execute( builtInScript + script, d->m_event );
         }
 #endif
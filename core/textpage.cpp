@@ -18,8 +18,6 @@
 #include "page.h"
 #include "page_p.h"
 
-#include <cstring>
-
 #include <QtAlgorithms>
 #include <QVarLengthArray>
 
@@ -29,23 +27,23 @@ class SearchPoint
 {
     public:
         SearchPoint()
-            : offset_begin( -1 ), offset_end( -1 )
+            : it_begin( -1 ), it_end( -1 ), offset_begin( -1 ), offset_end( -1 )
         {
         }
 
-        /** The TinyTextEntity containing the first character of the match. */
-        TextList::ConstIterator it_begin;
+        /** The index of the entity containing the first character of the match. */
+        int it_begin;
 
-        /** The TinyTextEntity containing the last character of the match. */
-        TextList::ConstIterator it_end;
+        /** The index of the entity containing the last character of the match. */
+        int it_end;
 
-        /** The index of the first character of the match in (*it_begin)->text().
-         *  Satisfies 0 <= offset_begin < (*it_begin)->text().length().
+        /** The index of the first character of the match in the text of it_begin.
+         *  Satisfies 0 <= offset_begin < length of the text of it_begin.
          */
         int offset_begin;
 
-        /** One plus the index of the last character of the match in (*it_end)->text().
-         *  Satisfies 0 < offset_end <= (*it_end)->text().length().
+        /** One plus the index of the last character of the match in the text of it_end.
+         *  Satisfies 0 < offset_end <= length of the text of it_end.
          */
         int offset_end;
 };
@@ -105,84 +103,36 @@ static bool doesConsumeY(const NormalizedRect& first, const NormalizedRect& seco
 }
 
 
-/*
-  Rationale behind TinyTextEntity:
-
-  instead of storing directly a QString for the text of an entity,
-  we store the UTF-16 data and their length. This way, we save about
-  4 int's wrt a QString, and we can create a new string from that
-  raw data (that's the only penalty of that).
-  Even better, if the string we need to store has at most
-  MaxStaticChars characters, then we store those in place of the QChar*
-  that would be used (with new[] + free[]) for the data.
- */
-class TinyTextEntity
+void PackedTextList::clear()
 {
-    static const int MaxStaticChars = sizeof( void* ) / sizeof( QChar );
-
-    public:
-        TinyTextEntity( const QString &text, const NormalizedRect &rect )
-            : area( rect )
-        {
-            Q_ASSERT_X( !text.isEmpty(), "TinyTextEntity", "empty string" );
-            Q_ASSERT_X( sizeof( d ) == sizeof( void * ), "TinyTextEntity",
-                        "internal storage is wider than QChar*, fix it!" );
-            length = text.length();
-            switch ( length )
-            {
-#if QT_POINTER_SIZE >= 8
-                case 4:
-                    d.qc[3] = text.at( 3 ).unicode();
-                    // fall through
-                case 3:
-                    d.qc[2] = text.at( 2 ).unicode();
-#endif
-                    // fall through
-                case 2:
-                    d.qc[1] = text.at( 1 ).unicode();
-                    // fall through
-                case 1:
-                    d.qc[0] = text.at( 0 ).unicode();
-                    break;
-                default:
-                    d.data = new QChar[ length ];
-                    std::memcpy( d.data, text.constData(), length * sizeof( QChar ) );
-            }
-        }
-
-        ~TinyTextEntity()
-        {
-            if ( length > MaxStaticChars )
-            {
-                delete [] d.data;
-            }
-        }
-
-        inline QString text() const
-        {
-            return length <= MaxStaticChars ? QString::fromRawData( ( const QChar * )&d.qc[0], length )
-                                            : QString::fromRawData( d.data, length );
-        }
-
-        inline NormalizedRect transformedArea( const QTransform &matrix ) const
-        {
-            NormalizedRect transformed_area = area;
-            transformed_area.transform( matrix );
-            return transformed_area;
-        }
-
-        NormalizedRect area;
+    m_text.clear();
+    m_ends.clear();
+    m_left.clear();
+    m_top.clear();
+    m_right.clear();
+    m_bottom.clear();
+}
 
-    private:
-        Q_DISABLE_COPY( TinyTextEntity )
+void PackedTextList::reserve( int entities, int characters )
+{
+    m_text.reserve( characters );
+    m_ends.reserve( entities );
+    m_left.reserve( entities );
+    m_top.reserve( entities );
+    m_right.reserve( entities );
+    m_bottom.reserve( entities );
+}
 
-        union
-        {
-            QChar *data;
-            ushort qc[MaxStaticChars];
-        } d;
-        int length;
-};
+void PackedTextList::append( const QString &text, const NormalizedRect &area )
+{
+    Q_ASSERT_X( !text.isEmpty(), "PackedTextList", "empty string" );
+    m_text.append( text );
+    m_ends.append( m_text.length() );
+    m_left.append( area.left );
+    m_top.append( area.top );
+    m_right.append( area.right );
+    m_bottom.append( area.bottom );
+}
 
 
 TextEntity::TextEntity( const QString &text, NormalizedRect *area )
@@ -221,7 +171,6 @@ TextPagePrivate::TextPagePrivate()
 TextPagePrivate::~TextPagePrivate()
 {
     qDeleteAll( m_searchPoints );
-    qDeleteAll( m_words );
 }
 
 
@@ -238,7 +187,7 @@ TextPage::TextPage( const TextEntity::List &words )
     {
         TextEntity *e = *it;
         if ( !e->text().isEmpty() )
-            d->m_words.append( new TinyTextEntity( e->text(), *e->area() ) );
+            d->m_words.append( e->text(), *e->area() );
         delete e;
     }
 }
@@ -251,29 +200,35 @@ TextPage::~TextPage()
 void TextPage::append( const QString &text, NormalizedRect *area )
 {
     if ( !text.isEmpty() )
-        d->m_words.append( new TinyTextEntity( text.normalized(QString::NormalizationForm_KC), *area ) );
+        d->m_words.append( text.normalized(QString::NormalizationForm_KC), *area );
     delete area;
 }
 
+/**
+ * A word made while the text order is corrected, with the indexes in
+ * TextPagePrivate::m_words of the characters it was made of. The spaces
+ * added in between the words have no characters.
+ */
 struct WordWithCharacters
 {
-    WordWithCharacters(TinyTextEntity *w, const TextList &c)
-     : word(w), characters(c)
+    WordWithCharacters(const QString &w, const NormalizedRect &a, const QVector<int> &c)
+     : word(w), wordArea(a), characters(c)
     {
     }
     
     inline QString text() const
     {
-        return word->text();
+        return word;
     }
     
     inline const NormalizedRect &area() const
     {
-      return word->area;
+      return wordArea;
     }
     
-    TinyTextEntity *word;
-    TextList characters;
+    QString word;
+    NormalizedRect wordArea;
+    QVector<int> characters;
 };
 typedef QList<WordWithCharacters> WordsWithCharacters;
 
@@ -378,7 +333,7 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
         const int count = d->m_words.count();
         for ( it = 0; it < count; it++ )
         {
-            tmp = *d->m_words[ it ]->area();
+            tmp = d->m_words.area( it );
             if ( tmp.contains( startCx, startCy )
                  || ( tmp.top <= startCy && tmp.bottom >= startCy && tmp.left >= startCx )
                  || ( tmp.top >= startCy))
@@ -405,7 +360,7 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
 #endif
         for ( it = d->m_words.count() - 1; it >= itB; it-- )
         {
-            tmp = *d->m_words[ it ]->area();
+            tmp = d->m_words.area( it );
             if ( tmp.contains( endCx, endCy )
                  || ( tmp.top <= endCy && tmp.bottom >= endCy && tmp.right <= endCx )
                  || ( tmp.bottom <= endCy ) )
@@ -429,8 +384,8 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
 
     if ( sel->itB() != -1 && sel->itE() != -1 )
     {
-        start = *d->m_words[ sel->itB() ]->area();
-        end = *d->m_words[ sel->itE() ]->area();
+        start = d->m_words.area( sel->itB() );
+        end = d->m_words.area( sel->itE() );
 
         NormalizedRect first, second, third;
         /// finding out if there is more than one baseline between them is a hard and discussable task
@@ -445,9 +400,9 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
         int selMax = qMax( sel->itB(), sel->itE() );
         for ( it = qMin( sel->itB(), sel->itE() ); it <= selMax; ++it )
         {
-            tmp = *d->m_words[ it ]->area();
+            tmp = d->m_words.area( it );
             if ( tmp.intersects( &first ) || tmp.intersects( &second ) || tmp.intersects( &third ) )
-                ret->appendShape( d->m_words.at( it )->transformedArea( matrix ) );
+                ret->appendShape( d->m_words.transformedArea( it, matrix ) );
         }
     }
 #else
@@ -533,19 +488,19 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
         if(endC.y * scaleY < minY) endC.y = minY/scaleY;
     }
 
-    TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
-    TextList::ConstIterator start = it, end = itEnd, tmpIt = it; //, tmpItEnd = itEnd;
+    const int count = d->m_words.count();
+    int it = 0, itEnd = count;
+    int start = it, end = itEnd, tmpIt = it; //, tmpItEnd = itEnd;
     const MergeSide side = d->m_page ? (MergeSide)d->m_page->totalOrientation() : MergeRight;
 
     NormalizedRect tmp;
     //case 2(a)
     for ( ; it != itEnd; ++it )
     {
-        tmp = (*it)->area;
-        if(tmp.contains(startC.x,startC.y)){
+        if(d->m_words.areaContains(it, startC.x, startC.y)){
             start = it;
         }
-        if(tmp.contains(endC.x,endC.y)){
+        if(d->m_words.areaContains(it, endC.x, endC.y)){
             end = it;
         }
     }
@@ -557,7 +512,7 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
         for ( ; it != itEnd; ++it )
         {
             // is there any text rectangle within the start_end rect
-            tmp = (*it)->area;
+            tmp = d->m_words.area(it);
             if(start_end.intersects(tmp))
                 break;
         }
@@ -583,7 +538,7 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
         {
             for ( ; it != itEnd; ++it )
             {
-                rect= (*it)->area;
+                rect= d->m_words.area(it);
                 rect.isBottom(startC) ? flagV = false: flagV = true;
 
                 if(flagV && rect.isRight(startC))
@@ -603,7 +558,7 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
 
             for ( ; it != itEnd; ++it )
             {
-                rect= (*it)->area;
+                rect= d->m_words.area(it);
 
                 if(rect.isBottomOrLevel(startC) && rect.isRight(startC))
                 {
@@ -640,7 +595,7 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
         {
             for ( ; itEnd >= it; itEnd-- )
             {
-                rect= (*itEnd)->area;
+                rect= d->m_words.area(itEnd);
                 rect.isTop(endC) ? flagV = false: flagV = true;
 
                 if(flagV && rect.isLeft(endC))
@@ -656,7 +611,7 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
             int distance = scaleX + scaleY + 100;
             for ( ; itEnd >= it; itEnd-- )
             {
-                rect= (*itEnd)->area;
+                rect= d->m_words.area(itEnd);
 
                 if(rect.isTopOrLevel(endC) && rect.isLeft(endC))
                 {
@@ -701,11 +656,11 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
     }
 
     // removes the possibility of crash, in case none of 1 to 3 is true
-    if(end == d->m_words.constEnd()) end--;
+    if(end == count) end--;
 
     for( ;start <= end ; start++)
     {
-        ret->appendShape( (*start)->transformedArea( matrix ), side );
+        ret->appendShape( d->m_words.transformedArea( start, matrix ), side );
      }
 
 #endif
@@ -721,9 +676,9 @@ RegularAreaRect* TextPage::findText( int searchID, const QString &query, SearchD
     // invalid search request
     if ( d->m_words.isEmpty() || query.isEmpty() || ( area && area->isNull() ) )
         return nullptr;
-    TextList::ConstIterator start;
+    int start;
     int start_offset = 0;
-    TextList::ConstIterator end;
+    int end;
     const QMap< int, SearchPoint* >::const_iterator sIt = d->m_searchPoints.constFind( searchID );
     if ( sIt == d->m_searchPoints.constEnd() )
     {
@@ -738,25 +693,25 @@ RegularAreaRect* TextPage::findText( int searchID, const QString &query, SearchD
     switch ( dir )
     {
         case FromTop:
-            start = d->m_words.constBegin();
+            start = 0;
             start_offset = 0;
-            end = d->m_words.constEnd();
+            end = d->m_words.count();
             break;
         case FromBottom:
-            start = d->m_words.constEnd();
+            start = d->m_words.count();
             start_offset = 0;
-            end = d->m_words.constBegin();
+            end = 0;
             forward = false;
             break;
         case NextResult:
             start = (*sIt)->it_end;
             start_offset = (*sIt)->offset_end;
-            end = d->m_words.constEnd();
+            end = d->m_words.count();
             break;
         case PreviousResult:
             start = (*sIt)->it_begin;
             start_offset = (*sIt)->offset_begin;
-            end = d->m_words.constBegin();
+            end = 0;
             forward = false;
             break;
     };
@@ -778,8 +733,9 @@ RegularAreaRect* TextPage::findText( int searchID, const QString &query, SearchD
 // we have a '-' just followed by a '\n' character
 // check if the string contains a '-' character
 // if the '-' is the last entry
-static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::ConstIterator &it, const TextList::ConstIterator &textListEnd)
+static int stringLengthAdaptedWithHyphen(const PackedTextList &words, int it)
 {
+    const QStringRef str = words.text(it);
     int len = str.length();
     
     // hyphenated '-' must be at the end of a word, so hyphenation means
@@ -789,10 +745,10 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
     if ( str.endsWith( QLatin1Char('-') ) )
     {
         // validity chek of it + 1
-        if ( ( it + 1 ) != textListEnd )
+        if ( ( it + 1 ) != words.count() )
         {
             // 1. if the next character is '\n'
-            const QString &lookahedStr = (*(it+1))->text();
+            const QStringRef lookahedStr = words.text(it + 1);
             if (lookahedStr.startsWith(QLatin1Char('\n')))
             {
                 len -= 1;
@@ -800,8 +756,8 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
             else
             {
                 // 2. if the next word is in a different line or not
-                const NormalizedRect& hyphenArea = (*it)->area;
-                const NormalizedRect& lookaheadArea = (*(it + 1))->area;
+                const NormalizedRect hyphenArea = words.area(it);
+                const NormalizedRect lookaheadArea = words.area(it + 1);
 
                 // lookahead to check whether both the '-' rect and next character rect overlap
                 if( !doesConsumeY( hyphenArea, lookaheadArea, 70 ) )
@@ -826,10 +782,9 @@ RegularAreaRect* TextPagePrivate::searchPointToArea(const SearchPoint* sp)
     const QTransform matrix = pagePrivate ? pagePrivate->rotationMatrix() : QTransform();
     RegularAreaRect* ret=new RegularAreaRect;
 
-    for (TextList::ConstIterator it = sp->it_begin; ; it++)
+    for (int it = sp->it_begin; ; it++)
     {
-        const TinyTextEntity* curEntity = *it;
-        ret->append( curEntity->transformedArea( matrix ) );
+        ret->append( m_words.transformedArea( it, matrix ) );
 
         if (it == sp->it_end) {
             break;
@@ -842,9 +797,9 @@ RegularAreaRect* TextPagePrivate::searchPointToArea(const SearchPoint* sp)
 
 RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const QString &_query,
                                                              TextComparisonFunction comparer,
-                                                             const TextList::ConstIterator &start,
+                                                             int start,
                                                              int start_offset,
-                                                             const TextList::ConstIterator &end)
+                                                             int end)
 {
     // normalize query search all unicode (including glyphs)
     const QString query = _query.normalized(QString::NormalizationForm_KC);
@@ -854,17 +809,16 @@ RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const Q
     // queryLeft is the length of the query we have left
     int j=0, queryLeft=query.length();
 
-    TextList::ConstIterator it = start;
+    int it = start;
     int offset = start_offset;
 
-    TextList::ConstIterator it_begin = TextList::ConstIterator();
+    int it_begin = -1;
     int offset_begin = 0; //dummy initial value to suppress compiler warnings
 
     while ( it != end )
     {
-        const TinyTextEntity* curEntity = *it;
-        const QString& str = curEntity->text();
-        int len = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd());
+        const QStringRef str = m_words.text(it);
+        int len = stringLengthAdaptedWithHyphen(m_words, it);
 
         if (offset >= len)
         {
@@ -873,7 +827,7 @@ RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const Q
             continue;
         }
 
-        if ( it_begin == TextList::ConstIterator() )
+        if ( it_begin == -1 )
         {
             it_begin = it;
             offset_begin = offset;
@@ -882,12 +836,12 @@ RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const Q
         int min=qMin(queryLeft,len-offset);
         {
 #ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << str.midRef(offset, min) << ":" << _query.midRef(j, min);
+            qCDebug(OkularCoreDebug) << str.mid(offset, min) << ":" << _query.midRef(j, min);
 #endif
             // we have equal (or less than) area of the query left as the length of the current 
             // entity
 
-            if ( !comparer( str.midRef( offset, min ), query.midRef( j, min ) ) )
+            if ( !comparer( str.mid( offset, min ), query.midRef( j, min ) ) )
             {
                     // we have not matched
                     // this means we do not have a complete match
@@ -900,7 +854,7 @@ RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const Q
                     queryLeft=query.length();
                     it = it_begin;
                     offset = offset_begin+1;
-                    it_begin = TextList::ConstIterator();
+                    it_begin = -1;
             }
             else
             {
@@ -951,9 +905,9 @@ RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const Q
 
 RegularAreaRect* TextPagePrivate::findTextInternalBackward( int searchID, const QString &_query,
                                                             TextComparisonFunction comparer,
-                                                            const TextList::ConstIterator &start,
+                                                            int start,
                                                             int start_offset,
-                                                            const TextList::ConstIterator &end)
+                                                            int end)
 {
     // normalize query to search all unicode (including glyphs)
     const QString query = _query.normalized(QString::NormalizationForm_KC);
@@ -963,10 +917,10 @@ RegularAreaRect* TextPagePrivate::findTextInternalBackward( int searchID, const
     // queryLeft is the length of the query we have left
     int j=query.length(), queryLeft=query.length();
 
-    TextList::ConstIterator it = start;
+    int it = start;
     int offset = start_offset;
 
-    TextList::ConstIterator it_begin = TextList::ConstIterator();
+    int it_begin = -1;
     int offset_begin = 0; //dummy initial value to suppress compiler warnings
 
     while ( true )
@@ -980,16 +934,15 @@ RegularAreaRect* TextPagePrivate::findTextInternalBackward( int searchID, const
             it--;
         }
 
-        const TinyTextEntity* curEntity = *it;
-        const QString& str = curEntity->text();
-        int len = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd());
+        const QStringRef str = m_words.text(it);
+        int len = stringLengthAdaptedWithHyphen(m_words, it);
 
         if (offset <= 0)
         {
             offset = len;
         }
 
-        if ( it_begin == TextList::ConstIterator() )
+        if ( it_begin == -1 )
         {
             it_begin = it;
             offset_begin = offset;
@@ -998,13 +951,13 @@ RegularAreaRect* TextPagePrivate::findTextInternalBackward( int searchID, const
         int min=qMin(queryLeft,offset);
         {
 #ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << str.midRef(offset-min, min) << " : " << _query.midRef(j-min, min);
+            qCDebug(OkularCoreDebug) << str.mid(offset-min, min) << " : " << _query.midRef(j-min, min);
 #endif
             // we have equal (or less than) area of the query left as the length of the current 
             // entity
 
             // Note len is not str.length() so we can't use rightRef here
-            if ( !comparer( str.midRef(offset-min, min ), query.midRef( j - min, min ) ) )
+            if ( !comparer( str.mid(offset-min, min ), query.midRef( j - min, min ) ) )
             {
                     // we have not matched
                     // this means we do not have a complete match
@@ -1018,7 +971,7 @@ RegularAreaRect* TextPagePrivate::findTextInternalBackward( int searchID, const
                     queryLeft = query.length();
                     it = it_begin;
                     offset = offset_begin-1;
-                    it_begin = TextList::ConstIterator();
+                    it_begin = -1;
             }
             else
             {
@@ -1078,33 +1031,33 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
     if ( area && area->isNull() )
         return QString();
 
-    TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
     QString ret;
     if ( area )
     {
-        for ( ; it != itEnd; ++it )
+        const int count = d->m_words.count();
+        for ( int it = 0; it < count; ++it )
         {
+            const NormalizedRect entityArea = d->m_words.area( it );
             if (b == AnyPixelTextAreaInclusionBehaviour)
             {
-                if ( area->intersects( (*it)->area ) )
+                if ( area->intersects( entityArea ) )
                 {
-                    ret += (*it)->text();
+                    ret += d->m_words.text( it );
                 }
             }
             else
             {
-                NormalizedPoint center = (*it)->area.center();
+                NormalizedPoint center = entityArea.center();
                 if ( area->contains( center.x, center.y ) )
                 {
-                    ret += (*it)->text();
+                    ret += d->m_words.text( it );
                 }
             }
         }
     }
     else
     {
-        for ( ; it != itEnd; ++it )
-            ret += (*it)->text();
+        ret = d->m_words.allText();
     }
     return ret;
 }
@@ -1126,50 +1079,33 @@ static bool compareTinyTextEntityY(const WordWithCharacters &first, const WordWi
 }
 
 /**
- * Sets a new world list. Deleting the contents of the old one
- */
-void TextPagePrivate::setWordList(const TextList &list)
-{
-    qDeleteAll(m_words);
-    m_words = list;
-}
-
-/**
- * Remove all the spaces in between texts. It will make all the generators
- * same, whether they save spaces(like pdf) or not(like djvu).
+ * Returns the indexes of all the entities but the spaces in between texts. It
+ * will make all the generators same, whether they save spaces(like pdf) or not(like djvu).
  */
-static void removeSpace(TextList *words)
+static QVector<int> indexesWithoutSpaces(const PackedTextList &words)
 {
-    TextList::Iterator it = words->begin();
-    const QString str(QLatin1Char(' '));
-
-    while ( it != words->end() )
+    QVector<int> indexes;
+    indexes.reserve(words.count());
+    for (int i = 0; i < words.count(); ++i)
     {
-        if((*it)->text() == str)
-        {
-            it = words->erase(it);
-        }
-        else
-        {
-            ++it;
-        }
+        if (words.text(i) != QLatin1String(" "))
+            indexes.append(i);
     }
+    return indexes;
 }
 
 /**
- * We will read the TinyTextEntity from characters and try to create words from there.
+ * We will read the entities of words at the indexes in characters and try to create words from there.
  * Note: characters might be already characters for some generators, but we will keep
- * the nomenclature characters for the generator produced data. The resulting
- * WordsWithCharacters memory has to be managed by the caller, both the 
- * WordWithCharacters::word and WordWithCharacters::characters contents
+ * the nomenclature characters for the generator produced data.
  */
-static WordsWithCharacters makeWordFromCharacters(const TextList &characters, int pageWidth, int pageHeight)
+static WordsWithCharacters makeWordFromCharacters(const PackedTextList &words, const QVector<int> &characters, int pageWidth, int pageHeight)
 {
     /**
-     * We will traverse characters and try to create words from the TinyTextEntities in it.
-     * We will search TinyTextEntity blocks and merge them until we get a
-     * space between two consecutive TinyTextEntities. When we get a space
-     * we can take it as a end of word. Then we store the word as a TinyTextEntity
+     * We will traverse characters and try to create words from the entities in it.
+     * We will search entity blocks and merge them until we get a
+     * space between two consecutive entities. When we get a space
+     * we can take it as a end of word. Then we store the word
      * and keep it in newList.
 
      * We create a RegionText named regionWord that contains the word and the characters associated with it and
@@ -1178,17 +1114,16 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
      */
     WordsWithCharacters wordsWithCharacters;
 
-    TextList::ConstIterator it = characters.begin(), itEnd = characters.end(), tmpIt;
+    QVector<int>::ConstIterator it = characters.begin(), itEnd = characters.end();
     int newLeft,newRight,newTop,newBottom;
     int index = 0;
 
     for( ; it != itEnd ; it++)
     {
-        QString textString = (*it)->text();
+        QString textString = words.text(*it).toString();
         QString newString;
-        QRect lineArea = (*it)->area.roundedGeometry(pageWidth,pageHeight),elementArea;
-        TextList wordCharacters;
-        tmpIt = it;
+        QRect lineArea = words.area(*it).roundedGeometry(pageWidth,pageHeight),elementArea;
+        QVector<int> wordCharacters;
         int space = 0;
 
         while (!space)
@@ -1196,20 +1131,8 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
             if (textString.length())
             {
                 newString.append(textString);
-
-                // when textString is the start of the word
-                if (tmpIt == it)
-                {
-                    NormalizedRect newRect(lineArea,pageWidth,pageHeight);
-                    wordCharacters.append(new TinyTextEntity(textString.normalized
-                                                   (QString::NormalizationForm_KC), newRect));
-                }
-                else
-                {
-                    NormalizedRect newRect(elementArea,pageWidth,pageHeight);
-                    wordCharacters.append(new TinyTextEntity(textString.normalized
-                                                   (QString::NormalizationForm_KC), newRect));
-                }
+                // the character is packed again from words once the order is correct
+                wordCharacters.append(*it);
             }
 
             ++it;
@@ -1219,7 +1142,7 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
              otherwise the last character can be missed
              */
             if (it == itEnd) break;
-            elementArea = (*it)->area.roundedGeometry(pageWidth,pageHeight);
+            elementArea = words.area(*it).roundedGeometry(pageWidth,pageHeight);
             if (!doesConsumeY(elementArea, lineArea, 60))
             {
                 --it;
@@ -1252,15 +1175,14 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
             lineArea.setWidth( newRight - newLeft );
             lineArea.setHeight( newBottom - newTop );
 
-            textString = (*it)->text();
+            textString = words.text(*it).toString();
         }
 
         // if newString is not empty, save it
         if (!newString.isEmpty())
         {
             const NormalizedRect newRect(lineArea, pageWidth, pageHeight);
-            TinyTextEntity *word = new TinyTextEntity(newString.normalized(QString::NormalizationForm_KC), newRect);
-            wordsWithCharacters.append(WordWithCharacters(word, wordCharacters));
+            wordsWithCharacters.append(WordWithCharacters(newString.normalized(QString::NormalizationForm_KC), newRect, wordCharacters));
 
             index++;
         }
@@ -1290,8 +1212,7 @@ QList< QPair<WordsWithCharacters, QRect> > makeAndSortLines(const WordsWithChara
     QList< QPair<WordsWithCharacters, QRect> > lines;
 
     /*
-     Make a new copy of the TextList in the words, so that the wordsTmp and lines do
-     not contain same pointers for all the TinyTextEntity.
+     Make a copy of the words to sort, wordsTmp keeps its order.
      */
     QList<WordWithCharacters> words = wordsTmp;
 
@@ -1539,8 +1460,7 @@ static void calculateStatisticalInformation(const QList<WordWithCharacters> &wor
 
 /**
  * Implements the XY Cut algorithm for textpage segmentation
- * The resulting RegionTextList will contain RegionText whose WordsWithCharacters::word and
- * WordsWithCharacters::characters are reused from wordsWithCharacters (i.e. no new nor delete happens in this function)
+ * The resulting RegionTextList will contain RegionText whose words are copies of the ones in wordsWithCharacters
  */
 static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wordsWithCharacters, const NormalizedRect &boundingBox, int pageWidth, int pageHeight)
 {
@@ -1588,8 +1508,7 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
         // for every text in the region
         for(int j = 0 ; j < list.length() ; ++j )
         {
-            TinyTextEntity *ent = list.at(j).word;
-            const QRect entRect = ent->area.geometry(pageWidth, pageHeight);
+            const QRect entRect = list.at(j).area().geometry(pageWidth, pageHeight);
 
             // calculate vertical projection profile proj_on_xaxis1
             for(int k = entRect.left() ; k <= entRect.left() + entRect.width() ; ++k)
@@ -1835,7 +1754,7 @@ WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pa
 
                 if(space != 0)
                 {
-                    // Make a TinyTextEntity of string space and push it between it and it+1
+                    // Make a word of string space and push it between it and it+1
                     const int left = area1.right();
                     const int right = area2.left();
                     const int top = area2.top() < area1.top() ? area2.top() : area1.top();
@@ -1844,9 +1763,7 @@ WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pa
                     const QString spaceStr(QStringLiteral(" "));
                     const QRect rect(QPoint(left,top),QPoint(right,bottom));
                     const NormalizedRect entRect(rect,pageWidth,pageHeight);
-                    TinyTextEntity *ent1 = new TinyTextEntity(spaceStr, entRect);
-                    TinyTextEntity *ent2 = new TinyTextEntity(spaceStr, entRect);
-                    WordWithCharacters word(ent1, QList<TinyTextEntity*>() << ent2);
+                    WordWithCharacters word(spaceStr, entRect, QVector<int>());
 
                     list.insert(k+1, word);
 
@@ -1886,17 +1803,15 @@ void TextPagePrivate::correctTextOrder()
     const int pageWidth  = (int) (scalingFactor * m_page->width() );
     const int pageHeight = (int) (scalingFactor * m_page->height());
 
-    TextList characters = m_words;
-
     /**
      * Remove spaces from the text
      */
-    removeSpace(&characters);
+    const QVector<int> characters = indexesWithoutSpaces(m_words);
 
     /**
      * Construct words from characters
      */
-    const QList<WordWithCharacters> wordsWithCharacters = makeWordFromCharacters(characters, pageWidth, pageHeight);
+    const QList<WordWithCharacters> wordsWithCharacters = makeWordFromCharacters(m_words, characters, pageWidth, pageHeight);
 
     /**
      * Make a XY Cut tree for segmentation of the texts
@@ -1909,15 +1824,30 @@ void TextPagePrivate::correctTextOrder()
     const WordsWithCharacters listWithWordsAndSpaces = addNecessarySpace(tree, pageWidth, pageHeight);
 
     /**
-     * Break the words into characters
+     * Break the words into characters, packed in the new order
      */
-    TextList listOfCharacters;
+    int entities = 0;
+    for (const WordWithCharacters &word : listWithWordsAndSpaces)
+        entities += qMax(1, word.characters.count());
+
+    PackedTextList orderedWords;
+    orderedWords.reserve(entities, m_words.allText().length() + entities - characters.count());
     for (const WordWithCharacters &word : listWithWordsAndSpaces)
     {
-        delete word.word;
-        listOfCharacters.append(word.characters);
+        // the added spaces are their own character
+        if (word.characters.isEmpty())
+        {
+            orderedWords.append(word.text(), word.area());
+            continue;
+        }
+
+        for (int i : word.characters)
+        {
+            const NormalizedRect charArea(m_words.area(i).roundedGeometry(pageWidth, pageHeight), pageWidth, pageHeight);
+            orderedWords.append(m_words.text(i).toString().normalized(QString::NormalizationForm_KC), charArea);
+        }
     }
-    setWordList(listOfCharacters);
+    m_words = orderedWords;
 }
 
 TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionBehaviour b) const
@@ -1926,32 +1856,34 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
         return TextEntity::List();
 
     TextEntity::List ret;
+    const int count = d->m_words.count();
     if ( area )
     {
-        for (const TinyTextEntity *te : qAsConst(d->m_words))
+        for ( int i = 0; i < count; ++i )
         {
+            const NormalizedRect entityArea = d->m_words.area( i );
             if (b == AnyPixelTextAreaInclusionBehaviour)
             {
-                if ( area->intersects( te->area ) )
+                if ( area->intersects( entityArea ) )
                 {
-                    ret.append( new TextEntity( te->text(), new Okular::NormalizedRect( te->area) ) );
+                    ret.append( new TextEntity( d->m_words.text( i ).toString(), new Okular::NormalizedRect( entityArea ) ) );
                 }
             }
             else
             {
-                const NormalizedPoint center = te->area.center();
+                const NormalizedPoint center = entityArea.center();
                 if ( area->contains( center.x, center.y ) )
                 {
-                    ret.append( new TextEntity( te->text(), new Okular::NormalizedRect( te->area) ) );
+                    ret.append( new TextEntity( d->m_words.text( i ).toString(), new Okular::NormalizedRect( entityArea ) ) );
                 }
             }
         }
     }
     else
     {
-        for (const TinyTextEntity *te : qAsConst(d->m_words))
+        for ( int i = 0; i < count; ++i )
         {
-            ret.append( new TextEntity( te->text(), new Okular::NormalizedRect( te->area) ) );
+            ret.append( new TextEntity( d->m_words.text( i ).toString(), new Okular::NormalizedRect( d->m_words.area( i ) ) ) );
         }
     }
     return ret;
@@ -1959,12 +1891,12 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
 
 RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) const
 {
-    TextList::ConstIterator itBegin = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
-    TextList::ConstIterator it = itBegin;
-    TextList::ConstIterator posIt = itEnd;
+    const int itBegin = 0, itEnd = d->m_words.count();
+    int it = itBegin;
+    int posIt = itEnd;
     for ( ; it != itEnd; ++it )
     {
-        if ( (*it)->area.contains( p.x, p.y ) )
+        if ( d->m_words.areaContains( it, p.x, p.y ) )
         {
             posIt = it;
             break;
@@ -1973,15 +1905,15 @@ RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) co
     QString text;
     if ( posIt != itEnd )
     {
-        if ( (*posIt)->text().simplified().isEmpty() )
+        if ( d->m_words.text( posIt ).toString().simplified().isEmpty() )
         {
             return nullptr;
         }
-        // Find the first TinyTextEntity of the word
+        // Find the first entity of the word
         while ( posIt != itBegin )
         {
             --posIt;
-            const QString itText = (*posIt)->text();
+            const QStringRef itText = d->m_words.text( posIt );
             if ( itText.right(1).at(0).isSpace() )
             {
                 if (itText.endsWith(QLatin1String("-\n")))
@@ -1994,7 +1926,7 @@ RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) co
                 if (itText == QLatin1String("\n") && posIt != itBegin )
                 {
                     --posIt;
-                    if ((*posIt)->text().endsWith(QLatin1String("-"))) {
+                    if (d->m_words.text( posIt ).endsWith(QLatin1String("-"))) {
                         // Is an hyphenated word
                         // continue searching the start of the word back
                         continue;
@@ -2009,14 +1941,14 @@ RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) co
         RegularAreaRect *ret = new RegularAreaRect();
         for ( ; posIt != itEnd; ++posIt )
         {
-            const QString itText = (*posIt)->text();
-            if ( itText.simplified().isEmpty() )
+            const QStringRef itText = d->m_words.text( posIt );
+            if ( itText.toString().simplified().isEmpty() )
             {
                 break;
             }
             
-            ret->appendShape( (*posIt)->area );
-            text += (*posIt)->text();
+            ret->appendShape( d->m_words.area( posIt ) );
+            text += itText;
             if (itText.right(1).at(0).isSpace())
             {
                 if (!text.endsWith(QLatin1String("-\n")))
@@ -14,26 +14,99 @@
 #include <QList>
 #include <QMap>
 #include <QPair>
+#include <QString>
 #include <QTransform>
+#include <QVector>
 
-class SearchPoint;
+#include "area.h"
 
-/**
- * Memory-optimized storage of a TextEntity. Stores a string and its bounding box.
- *
- * When a generator adds a TextEntity to a TextPage, it is internally stored as TinyTextEntity.
- * TinyTextEntity is also internally used to get the geometry of text selections and highlight areas.
- *
- * @see TextEntity
- */
-class TinyTextEntity;
+class SearchPoint;
 class RegionText;
 
 namespace Okular
 {
 
 class PagePrivate;
-typedef QList< TinyTextEntity* > TextList;
+
+/**
+ * The text entities of a TextPage. The text of all of them is stored in a
+ * single UTF-16 buffer and their bounding boxes in parallel arrays of floats,
+ * so a page doesn't need an allocation per entity and searching it or finding
+ * the selected entities walks contiguous memory.
+ *
+ * A float keeps about 7 significant digits, well below a pixel at any zoom,
+ * so the hit tests accept points that far out of the stored boxes.
+ */
+class PackedTextList
+{
+    public:
+        int count() const
+        {
+            return m_ends.count();
+        }
+
+        bool isEmpty() const
+        {
+            return m_ends.isEmpty();
+        }
+
+        void clear();
+        void reserve( int entities, int characters );
+
+        /**
+         * Appends an entity, @p text must not be empty
+         */
+        void append( const QString &text, const NormalizedRect &area );
+
+        /**
+         * The text of the entity @p i, valid while the list is not modified
+         */
+        QStringRef text( int i ) const
+        {
+            const int begin = i > 0 ? m_ends.at( i - 1 ) : 0;
+            return QStringRef( &m_text, begin, m_ends.at( i ) - begin );
+        }
+
+        /**
+         * The text of all the entities
+         */
+        const QString &allText() const
+        {
+            return m_text;
+        }
+
+        NormalizedRect area( int i ) const
+        {
+            return NormalizedRect( m_left.at( i ), m_top.at( i ), m_right.at( i ), m_bottom.at( i ) );
+        }
+
+        NormalizedRect transformedArea( int i, const QTransform &matrix ) const
+        {
+            NormalizedRect transformed_area = area( i );
+            transformed_area.transform( matrix );
+            return transformed_area;
+        }
+
+        bool areaContains( int i, double x, double y ) const
+        {
+            return x >= m_left.at( i ) - EdgeTolerance && y >= m_top.at( i ) - EdgeTolerance &&
+                   x <= m_right.at( i ) + EdgeTolerance && y <= m_bottom.at( i ) + EdgeTolerance;
+        }
+
+        /**
+         * How far out of its stored box a point may be to be in an entity
+         */
+        static constexpr double EdgeTolerance = 1e-6;
+
+    private:
+        QString m_text;
+        // the end of the text of each entity in m_text
+        QVector< int > m_ends;
+        QVector< float > m_left;
+        QVector< float > m_top;
+        QVector< float > m_right;
+        QVector< float > m_bottom;
+};
 
 /**
  * Returns whether the two strings match.
@@ -42,7 +115,7 @@ typedef QList< TinyTextEntity* > TextList;
 typedef bool ( *TextComparisonFunction )( const QStringRef & from, const QStringRef & to );
 
 /**
- * A list of RegionText. It keeps a bunch of TextList with their bounding rectangles
+ * A list of RegionText. It keeps a bunch of words with their bounding rectangles
  */
 typedef QList<RegionText> RegionTextList;
 
@@ -54,28 +127,23 @@ class TextPagePrivate
 
         RegularAreaRect * findTextInternalForward( int searchID, const QString &query,
                                                    TextComparisonFunction comparer,
-                                                   const TextList::ConstIterator &start,
+                                                   int start,
                                                    int start_offset,
-                                                   const TextList::ConstIterator &end);
+                                                   int end);
         RegularAreaRect * findTextInternalBackward( int searchID, const QString &query,
                                                     TextComparisonFunction comparer,
-                                                    const TextList::ConstIterator &start,
+                                                    int start,
                                                     int start_offset,
-                                                    const TextList::ConstIterator &end );
-
-        /**
-         * Copy a TextList to m_words, the pointers of list are adopted
-         */
-        void setWordList(const TextList &list);
+                                                    int end );
 
         /**
-         * Make necessary modifications in the TextList to make the text order correct, so
+         * Make necessary modifications in m_words to make the text order correct, so
          * that textselection works fine
          */
         void correctTextOrder();
 
         // variables those can be accessed directly from TextPage
-        TextList m_words;
+        PackedTextList m_words;
         QMap< int, SearchPoint* > m_searchPoints;
         Page *m_page;
 
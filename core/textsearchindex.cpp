@@ -0,0 +1,201 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "textsearchindex_p.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+
+using namespace Okular;
+
+static const quint32 TextSearchIndexMagic = 0x4f4b5449; // "OKTI"
+static const quint32 TextSearchIndexVersion = 1;
+
+// case folds and drops the hyphens, so that words broken at the end of a line
+// are found whether TextPage joins them back or not
+static QString normalizedText( const QString &text )
+{
+    QString ret = text.toCaseFolded();
+    ret.remove( QLatin1Char( '-' ) );
+    return ret;
+}
+
+static QStringList splitWords( const QString &text )
+{
+    QStringList words;
+    int wordStart = -1;
+    for ( int i = 0; i <= text.length(); ++i )
+    {
+        if ( i == text.length() || text.at( i ).isSpace() )
+        {
+            if ( wordStart != -1 )
+                words << text.mid( wordStart, i - wordStart );
+            wordStart = -1;
+        }
+        else if ( wordStart == -1 )
+        {
+            wordStart = i;
+        }
+    }
+    return words;
+}
+
+TextSearchIndex::TextSearchIndex()
+    : m_indexedPageCount( 0 )
+{
+}
+
+void TextSearchIndex::reset( int pageCount )
+{
+    m_wordPages.clear();
+    m_indexedPages = QBitArray( pageCount );
+    m_indexedPageCount = 0;
+}
+
+int TextSearchIndex::pageCount() const
+{
+    return m_indexedPages.size();
+}
+
+bool TextSearchIndex::isPageIndexed( int page ) const
+{
+    return page >= 0 && page < m_indexedPages.size() && m_indexedPages.testBit( page );
+}
+
+bool TextSearchIndex::isComplete() const
+{
+    return m_indexedPageCount > 0 && m_indexedPageCount == m_indexedPages.size();
+}
+
+void TextSearchIndex::addPage( int page, const QString &text )
+{
+    if ( page < 0 || page >= m_indexedPages.size() || m_indexedPages.testBit( page ) )
+        return;
+
+    // index the words both as they are and with the line ending hyphenations
+    // joined, TextPage::findText() may read them either way
+    QString joinedText = text;
+    joinedText.remove( QStringLiteral( "-\n" ) );
+
+    QSet< QString > words;
+    for ( const QString &word : splitWords( normalizedText( text ) ) )
+        words.insert( word );
+    for ( const QString &word : splitWords( normalizedText( joinedText ) ) )
+        words.insert( word );
+
+    for ( const QString &word : qAsConst( words ) )
+        m_wordPages[ word ].append( page );
+
+    m_indexedPages.setBit( page );
+    ++m_indexedPageCount;
+}
+
+QBitArray TextSearchIndex::pagesMatching( const QString &query ) const
+{
+    if ( !isComplete() )
+        return QBitArray( m_indexedPages.size(), true );
+
+    const QStringList queryWords = splitWords( normalizedText( query.normalized( QString::NormalizationForm_KC ) ) );
+    QBitArray pages( m_indexedPages.size(), true );
+
+    // a match can start and end in the middle of a word of the page, but the
+    // query words in between have to be whole words
+    for ( int w = 0; w < queryWords.count(); ++w )
+    {
+        const QString &queryWord = queryWords.at( w );
+        const bool first = w == 0;
+        const bool last = w == queryWords.count() - 1;
+        QBitArray wordPages( m_indexedPages.size() );
+
+        if ( !first && !last )
+        {
+            for ( const int page : m_wordPages.value( queryWord ) )
+                wordPages.setBit( page );
+        }
+        else
+        {
+            QHash< QString, QVector< int > >::const_iterator it = m_wordPages.constBegin(), itEnd = m_wordPages.constEnd();
+            for ( ; it != itEnd; ++it )
+            {
+                bool matches;
+                if ( first && last )
+                    matches = it.key().contains( queryWord );
+                else if ( first )
+                    matches = it.key().endsWith( queryWord );
+                else
+                    matches = it.key().startsWith( queryWord );
+
+                if ( matches )
+                {
+                    for ( const int page : it.value() )
+                        wordPages.setBit( page );
+                }
+            }
+        }
+
+        pages &= wordPages;
+    }
+
+    return pages;
+}
+
+bool TextSearchIndex::load( const QString &fileName, const QString &key, int pageCount )
+{
+    reset( pageCount );
+
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_5_0 );
+
+    quint32 magic, version;
+    QString storedKey;
+    qint32 storedPageCount;
+    stream >> magic >> version;
+    if ( magic != TextSearchIndexMagic || version != TextSearchIndexVersion )
+        return false;
+
+    stream >> storedKey >> storedPageCount;
+    if ( storedKey != key || storedPageCount != pageCount )
+        return false;
+
+    QHash< QString, QVector< int > > wordPages;
+    stream >> wordPages;
+    if ( stream.status() != QDataStream::Ok )
+        return false;
+
+    m_wordPages = wordPages;
+    m_indexedPages.fill( true );
+    m_indexedPageCount = pageCount;
+    return true;
+}
+
+bool TextSearchIndex::save( const QString &fileName, const QString &key ) const
+{
+    if ( !isComplete() )
+        return false;
+
+    QSaveFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly ) )
+        return false;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_5_0 );
+    stream << TextSearchIndexMagic << TextSearchIndexVersion;
+    stream << key << qint32( m_indexedPages.size() );
+    stream << m_wordPages;
+
+    return file.commit();
+}
+
+/* kate: replace-tabs on; indent-width 4; */
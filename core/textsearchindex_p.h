@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_TEXTSEARCHINDEX_P_H_
+#define _OKULAR_TEXTSEARCHINDEX_P_H_
+
+#include <QBitArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+namespace Okular {
+
+/* An inverted index of the words of a document to the pages they appear in,
+ * filled page by page as their text is extracted and stored on disk once
+ * every page is in. It only narrows down the pages a search has to look at:
+ * the words are case folded and stripped of hyphens, so the pages it returns
+ * are a superset of the ones TextPage::findText() finds the query in. */
+class TextSearchIndex
+{
+    public:
+        TextSearchIndex();
+
+        /* Empties the index for a document of @p pageCount pages */
+        void reset( int pageCount );
+
+        int pageCount() const;
+        bool isPageIndexed( int page ) const;
+        bool isComplete() const;
+
+        /* Indexes the words of @p text, the text of the whole @p page */
+        void addPage( int page, const QString &text );
+
+        /* Returns the pages that may contain @p query, all of them if the
+         * index is not complete */
+        QBitArray pagesMatching( const QString &query ) const;
+
+        /* Loads a complete index from @p fileName, if it was saved with the
+         * same @p key and number of pages. Resets the index otherwise */
+        bool load( const QString &fileName, const QString &key, int pageCount );
+        bool save( const QString &fileName, const QString &key ) const;
+
+    private:
+        QHash< QString, QVector< int > > m_wordPages;
+        QBitArray m_indexedPages;
+        int m_indexedPageCount;
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
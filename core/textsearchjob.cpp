@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "textsearchjob_p.h"
+
+// local includes
+#include "area.h"
+#include "generator_p.h"
+#include "page.h"
+#include "page_p.h"
+#include "textpage.h"
+
+using namespace Okular;
+
+TextSearchJob::TextSearchJob( Generator *generator, Page *page, int searchID, const QStringList &words, Qt::CaseSensitivity caseSensitivity )
+    : ThreadWeaver::QObjectDecorator( new TextSearchJobInternal( generator, page, searchID, words, caseSensitivity ) )
+{
+}
+
+TextSearchJobInternal *TextSearchJob::internalJob() const
+{
+    return static_cast< TextSearchJobInternal * >( const_cast< ThreadWeaver::JobInterface * >( job() ) );
+}
+
+Page *TextSearchJob::page() const
+{
+    return internalJob()->mPage;
+}
+
+int TextSearchJob::searchID() const
+{
+    return internalJob()->mSearchID;
+}
+
+void TextSearchJob::abort()
+{
+    TextSearchJobInternal *internal = internalJob();
+    internal->mAborted = 1;
+    TextRequestPrivate::get( &internal->mTextRequest )->mShouldAbortExtraction = 1;
+}
+
+TextPage *TextSearchJob::takeTextPage()
+{
+    TextSearchJobInternal *internal = internalJob();
+    TextPage *textPage = internal->mTextPage;
+    internal->mTextPage = nullptr;
+    return textPage;
+}
+
+TextSearchMatches TextSearchJob::takeMatches()
+{
+    TextSearchJobInternal *internal = internalJob();
+    TextSearchMatches matches = internal->mMatches;
+    internal->mMatches.clear();
+    return matches;
+}
+
+TextSearchMatches TextSearchJob::findMatches( TextPage *textPage, int searchID, const QStringList &words, Qt::CaseSensitivity caseSensitivity )
+{
+    TextSearchMatches matches( words.count() );
+    if ( !textPage )
+        return matches;
+
+    for ( int w = 0; w < words.count(); ++w )
+    {
+        if ( words[ w ].isEmpty() )
+            continue;
+
+        // loop on the page adding all the found items
+        RegularAreaRect * lastMatch = nullptr;
+        while ( true )
+        {
+            if ( lastMatch )
+                lastMatch = textPage->findText( searchID, words[ w ], NextResult, caseSensitivity, lastMatch );
+            else
+                lastMatch = textPage->findText( searchID, words[ w ], FromTop, caseSensitivity );
+
+            if ( !lastMatch )
+                break;
+
+            matches[ w ].append( lastMatch );
+        }
+    }
+
+    return matches;
+}
+
+TextSearchJobInternal::TextSearchJobInternal( Generator *generator, Page *page, int searchID, const QStringList &words, Qt::CaseSensitivity caseSensitivity )
+    : mGenerator( generator ), mPage( page ), mTextRequest( page ), mSearchID( searchID ), mWords( words ),
+      mCaseSensitivity( caseSensitivity ), mAborted( 0 ), mTextPage( nullptr )
+{
+}
+
+TextSearchJobInternal::~TextSearchJobInternal()
+{
+    delete mTextPage;
+    for ( const QVector< RegularAreaRect * > &wordMatches : qAsConst( mMatches ) )
+        qDeleteAll( wordMatches );
+}
+
+void TextSearchJobInternal::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread)
+{
+    Q_UNUSED(self);
+    Q_UNUSED(thread);
+
+    if ( mAborted )
+        return;
+
+    mTextPage = mGenerator->textPage( &mTextRequest );
+    if ( !mTextPage )
+        return;
+
+    if ( mTextRequest.shouldAbortExtraction() || mAborted )
+    {
+        delete mTextPage;
+        mTextPage = nullptr;
+        return;
+    }
+
+    PagePrivate::get( mPage )->prepareTextPage( mTextPage );
+    mMatches = TextSearchJob::findMatches( mTextPage, mSearchID, mWords, mCaseSensitivity );
+}
+
+#include "moc_textsearchjob_p.cpp"
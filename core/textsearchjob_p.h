@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_TEXTSEARCHJOB_P_H_
+#define _OKULAR_TEXTSEARCHJOB_P_H_
+
+#include <QAtomicInt>
+#include <QStringList>
+#include <QVector>
+
+#include <threadweaver/qobjectdecorator.h>
+#include <threadweaver/job.h>
+
+#include "core/generator.h"
+
+namespace Okular {
+
+class Page;
+class RegularAreaRect;
+class TextPage;
+
+/* The matches of each one of the searched words in a page */
+typedef QVector< QVector< RegularAreaRect * > > TextSearchMatches;
+
+class TextSearchJobInternal : public ThreadWeaver::Job
+{
+    friend class TextSearchJob;
+
+    public:
+        ~TextSearchJobInternal() override;
+
+    protected:
+        void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
+
+    private:
+        TextSearchJobInternal( Generator *generator, Page *page, int searchID, const QStringList &words, Qt::CaseSensitivity caseSensitivity );
+
+        Generator *mGenerator;
+        Page *mPage;
+        TextRequest mTextRequest;
+        const int mSearchID;
+        const QStringList mWords;
+        const Qt::CaseSensitivity mCaseSensitivity;
+        QAtomicInt mAborted;
+        TextPage *mTextPage;
+        TextSearchMatches mMatches;
+};
+
+/* Extracts the text of a page that doesn't have a TextPage yet and searches
+ * it for a list of words, out of the GUI thread. The extracted TextPage is
+ * only bound to the page, it is up to the caller to set it */
+class TextSearchJob : public ThreadWeaver::QObjectDecorator
+{
+    Q_OBJECT
+    public:
+        TextSearchJob( Generator *generator, Page *page, int searchID, const QStringList &words, Qt::CaseSensitivity caseSensitivity );
+
+        Page *page() const;
+        int searchID() const;
+
+        void abort();
+
+        TextPage *takeTextPage();
+        TextSearchMatches takeMatches();
+
+        /* Returns all the matches of every word in @p textPage, from top to bottom */
+        static TextSearchMatches findMatches( TextPage *textPage, int searchID, const QStringList &words, Qt::CaseSensitivity caseSensitivity );
+
+    private:
+        TextSearchJobInternal *internalJob() const;
+};
+
+}
+
+#endif
@@ -22,6 +22,14 @@
 #include <QWindow>
 #include <QScreen>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OKULAR_UTILS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#define OKULAR_UTILS_NEON
+#include <arm_neon.h>
+#endif
+
 
 
 using namespace Okular;
@@ -77,51 +85,167 @@ inline static bool isPaperColor( QRgb argb, QRgb paperColor ) {
     return ( argb & 0xFFFFFF ) == ( paperColor & 0xFFFFFF); // ignore alpha
 }
 
+namespace
+{
+
+// Finds the non paper colored pixels of the scanlines of a 32 bit image,
+// comparing several pixels at once when the CPU allows it
+class PaperScanner
+{
+    public:
+        PaperScanner( const QImage &image, QRgb paperColor )
+            : m_image( image ), m_paperColor( paperColor ),
+              m_premultiplied( image.format() == QImage::Format_ARGB32_Premultiplied )
+        {
+            // QImage::pixel() unpremultiplies the colors, so for those images a block
+            // is only skipped at once when it is all opaque paper, else checked pixel by pixel
+            m_blockMask = m_premultiplied ? 0xFFFFFFFF : 0x00FFFFFF;
+            m_blockPaper = ( paperColor | 0xFF000000 ) & m_blockMask;
+        }
+
+        // the first non paper pixel of row 'y' in [from, to), or -1
+        int first( int y, int from, int to ) const
+        {
+            const QRgb *line = reinterpret_cast<const QRgb *>( m_image.constScanLine( y ) );
+            int x = from;
+            for ( ; x + 4 <= to; x += 4 )
+            {
+                if ( !isPaperBlock( line + x ) )
+                    break;
+            }
+            for ( ; x < to; ++x )
+            {
+                if ( !isPaper( line[x] ) )
+                    return x;
+            }
+            return -1;
+        }
+
+        // the last non paper pixel of row 'y' in [from, to), or -1
+        int last( int y, int from, int to ) const
+        {
+            const QRgb *line = reinterpret_cast<const QRgb *>( m_image.constScanLine( y ) );
+            int x = to;
+            for ( ; x - 4 >= from; x -= 4 )
+            {
+                if ( !isPaperBlock( line + x - 4 ) )
+                    break;
+            }
+            for ( --x; x >= from; --x )
+            {
+                if ( !isPaper( line[x] ) )
+                    return x;
+            }
+            return -1;
+        }
+
+    private:
+        bool isPaper( QRgb pixel ) const
+        {
+            return isPaperColor( m_premultiplied ? qUnpremultiply( pixel ) : pixel, m_paperColor );
+        }
+
+        bool isPaperBlock( const QRgb *pixels ) const
+        {
+#if defined(OKULAR_UTILS_SSE2)
+            const __m128i block = _mm_and_si128( _mm_loadu_si128( reinterpret_cast<const __m128i *>( pixels ) ), _mm_set1_epi32( m_blockMask ) );
+            return _mm_movemask_epi8( _mm_cmpeq_epi32( block, _mm_set1_epi32( m_blockPaper ) ) ) == 0xFFFF;
+#elif defined(OKULAR_UTILS_NEON)
+            const uint32x4_t block = vandq_u32( vld1q_u32( pixels ), vdupq_n_u32( m_blockMask ) );
+            const uint64x2_t equal = vreinterpretq_u64_u32( vceqq_u32( block, vdupq_n_u32( m_blockPaper ) ) );
+            return ( vgetq_lane_u64( equal, 0 ) & vgetq_lane_u64( equal, 1 ) ) == ~quint64( 0 );
+#else
+            return ( ( pixels[0] & m_blockMask ) == m_blockPaper ) && ( ( pixels[1] & m_blockMask ) == m_blockPaper )
+                && ( ( pixels[2] & m_blockMask ) == m_blockPaper ) && ( ( pixels[3] & m_blockMask ) == m_blockPaper );
+#endif
+        }
+
+        const QImage &m_image;
+        const QRgb m_paperColor;
+        const bool m_premultiplied;
+        QRgb m_blockMask;
+        QRgb m_blockPaper;
+};
+
+}
+
 NormalizedRect Utils::imageBoundingBox( const QImage * image )
 {
     if ( !image )
         return NormalizedRect();
 
+    // work on the scanlines, most generators already give us 32 bit images
+    QImage converted;
+    if ( image->format() != QImage::Format_RGB32 && image->format() != QImage::Format_ARGB32 && image->format() != QImage::Format_ARGB32_Premultiplied )
+    {
+        converted = image->convertToFormat( QImage::Format_ARGB32 );
+        image = &converted;
+    }
+
     const int width = image->width();
     const int height = image->height();
-    const QRgb paperColor = SettingsCore::paperColor().rgb();
-    int left, top, bottom, right, x, y;
+    const PaperScanner scanner( *image, SettingsCore::paperColor().rgb() );
 
 #ifdef BBOX_DEBUG
     QTime time;
     time.start();
 #endif
 
-    // Scan pixels for top non-white
-    for ( top = 0; top < height; ++top )
-        for ( x = 0; x < width; ++x )
-            if ( !isPaperColor( image->pixel( x, top ), paperColor ) )
-                goto got_top;
-    return NormalizedRect( 0, 0, 0, 0 ); // the image is blank
-got_top:
-    left = right = x;
-
-    // Scan pixels for bottom non-white
-    for ( bottom = height-1; bottom >= top; --bottom )
-        for ( x = width-1; x >= 0; --x )
-            if ( !isPaperColor( image->pixel( x, bottom ), paperColor ) )
-                goto got_bottom;
-    Q_ASSERT( 0 ); // image changed?!
-got_bottom:
-    if ( x < left )
-        left = x;
-    if ( x > right )
-        right = x;
-
-    // Scan for leftmost and rightmost (we already found some bounds on these):
-    for ( y = top; y <= bottom && ( left > 0 || right < width-1 ); ++y )
+    // First pass on a subset of the rows: it gives a box that is inside the
+    // real one, so that the second pass only has to look at the margins
+    const int step = height >= 512 ? 8 : 1;
+    int top = height, bottom = -1, left = width, right = -1;
+    for ( int y = 0; y < height; y += step )
+    {
+        const int x = scanner.first( y, 0, width );
+        if ( x == -1 )
+            continue;
+        if ( top == height )
+            top = y;
+        bottom = y;
+        left = qMin( left, x );
+        right = qMax( right, scanner.last( y, qMax( x, right + 1 ), width ) );
+    }
+
+    // Refine top and bottom on the rows the first pass skipped
+    const int sampledTop = top;
+    for ( int y = 0; y < sampledTop; ++y )
+    {
+        if ( y % step != 0 && scanner.first( y, 0, width ) != -1 )
+        {
+            top = y;
+            break;
+        }
+    }
+    if ( top == height )
+        return NormalizedRect( 0, 0, 0, 0 ); // the image is blank
+    for ( int y = height - 1; y > qMax( bottom, top ); --y )
+    {
+        if ( y % step != 0 && scanner.first( y, 0, width ) != -1 )
+        {
+            bottom = y;
+            break;
+        }
+    }
+    bottom = qMax( bottom, top );
+
+    // Refine left and right, only the margins outside the current bounds need a look
+    for ( int y = top; y <= bottom && ( left > 0 || right < width - 1 ); ++y )
     {
-        for ( x = 0; x < left; ++x )
-            if ( !isPaperColor( image->pixel( x, y ), paperColor ) )
+        if ( y % step == 0 && y != top && y != bottom )
+            continue;
+        if ( left > 0 )
+        {
+            const int x = scanner.first( y, 0, left );
+            if ( x != -1 )
                 left = x;
-        for ( x = width-1; x > right+1; --x )
-            if ( !isPaperColor( image->pixel( x, y ), paperColor ) )
+        }
+        if ( right < width - 1 )
+        {
+            const int x = scanner.last( y, right + 1, width );
+            if ( x != -1 )
                 right = x;
+        }
     }
 
     NormalizedRect bbox( QRect( left, top, ( right - left + 1), ( bottom - top + 1 ) ),
@@ -14,6 +14,9 @@
 #include "settings_core.h"
 #include "core/textpage.h"
 
+#include "ebook.h"
+#include "ebook_search.h"
+
 
 class ChmGeneratorTest
 : public QObject
@@ -23,21 +26,46 @@ class ChmGeneratorTest
     private slots:
         void initTestCase();
         void testDocumentStructure();
+        void testSearch_data();
+        void testSearch();
+        void testSearchIndex_data();
+        void testSearchIndex();
         void testDocumentContent();
         void cleanupTestCase();
 
     private:
         Okular::Document *m_document;
+        EBookSearch *m_search;
 };
 
 void ChmGeneratorTest::initTestCase()
 {
+    QStandardPaths::setTestModeEnabled( true );
     Okular::SettingsCore::instance( QStringLiteral("ChmGeneratorTest") );
     m_document = new Okular::Document( 0 );
     const QString testFile = QStringLiteral(KDESRCDIR "autotests/data/test.chm");
     QMimeDatabase db;
     const QMimeType mime = db.mimeTypeForFile( testFile );
     QCOMPARE( m_document->openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess );
+
+    // the first search loads the index of the generator, the next ones use it
+    int finished = 0;
+    const QMetaObject::Connection connection = connect( m_document, &Okular::Document::searchFinished, this, [&finished] { ++finished; } );
+    m_document->searchText( 1, QStringLiteral( "example" ), true, Qt::CaseInsensitive, Okular::Document::AllDocument, false, Qt::yellow );
+    QTRY_COMPARE( finished, 1 );
+    disconnect( connection );
+    m_document->resetSearch( 1 );
+    QTRY_VERIFY_WITH_TIMEOUT( m_document->metaData( QStringLiteral("SearchIndexLoaded") ).toBool(), 30000 );
+
+    // the index the generator builds in the background
+    EBook *file = EBook::loadFile( testFile );
+    QVERIFY( file );
+    QByteArray data;
+    QDataStream stream( &data, QIODevice::WriteOnly );
+    m_search = new EBookSearch();
+    const bool generated = m_search->generateIndex( file, stream );
+    delete file;
+    QVERIFY( generated );
 }
 
 
@@ -45,6 +73,7 @@ void ChmGeneratorTest::cleanupTestCase()
 {
     m_document->closeDocument();
     delete m_document;
+    delete m_search;
 }
 
 void ChmGeneratorTest::testDocumentStructure()
@@ -70,6 +99,83 @@ void ChmGeneratorTest::testDocumentStructure()
     QCOMPARE( heading2.tagName(), QStringLiteral("Heading 2") );
 }
 
+void ChmGeneratorTest::testSearch_data()
+{
+    QTest::addColumn<QString>( "text" );
+    QTest::addColumn<int>( "type" );
+    QTest::addColumn<int>( "expectedStatus" );
+
+    // the pages ruled out by the search index of the file are not searched,
+    // while parts of words and text across words must still be found
+    QTest::newRow( "whole word" ) << QStringLiteral( "example" ) << (int)Okular::Document::AllDocument << (int)Okular::Document::MatchFound;
+    QTest::newRow( "part of word" ) << QStringLiteral( "xampl" ) << (int)Okular::Document::AllDocument << (int)Okular::Document::MatchFound;
+    QTest::newRow( "across words" ) << QStringLiteral( "ample Te" ) << (int)Okular::Document::AllDocument << (int)Okular::Document::MatchFound;
+    QTest::newRow( "missing" ) << QStringLiteral( "nowhere" ) << (int)Okular::Document::AllDocument << (int)Okular::Document::NoMatchFound;
+    QTest::newRow( "next match" ) << QStringLiteral( "html title" ) << (int)Okular::Document::NextMatch << (int)Okular::Document::MatchFound;
+    QTest::newRow( "next match missing" ) << QStringLiteral( "nowhere" ) << (int)Okular::Document::NextMatch << (int)Okular::Document::NoMatchFound;
+}
+
+void ChmGeneratorTest::testSearch()
+{
+    QFETCH( QString, text );
+    QFETCH( int, type );
+    QFETCH( int, expectedStatus );
+
+    // the pages are filtered by the index
+    QVERIFY( m_document->metaData( QStringLiteral("SearchIndexLoaded") ).toBool() );
+
+    int finished = 0;
+    Okular::Document::SearchStatus status = Okular::Document::SearchCancelled;
+    const QMetaObject::Connection connection = connect( m_document, &Okular::Document::searchFinished, this, [&]( int, Okular::Document::SearchStatus s ) {
+        status = s;
+        ++finished;
+    } );
+
+    m_document->searchText( 1, text, true, Qt::CaseInsensitive, (Okular::Document::SearchType)type, false, Qt::yellow );
+    QTRY_COMPARE( finished, 1 );
+    QCOMPARE( (int)status, expectedStatus );
+
+    disconnect( connection );
+    m_document->resetSearch( 1 );
+}
+
+void ChmGeneratorTest::testSearchIndex_data()
+{
+    QTest::addColumn<QString>( "text" );
+
+    QTest::newRow( "whole word" ) << QStringLiteral( "example" );
+    QTest::newRow( "part of word" ) << QStringLiteral( "xampl" );
+    QTest::newRow( "across words" ) << QStringLiteral( "ample te" );
+    QTest::newRow( "some pages" ) << QStringLiteral( "html title" );
+    QTest::newRow( "across elements" ) << QStringLiteral( "1this" );
+    QTest::newRow( "missing" ) << QStringLiteral( "nowhere" );
+}
+
+void ChmGeneratorTest::testSearchIndex()
+{
+    QFETCH( QString, text );
+
+    QList< QUrl > documents;
+    QVERIFY( m_search->documentsContaining( text, &documents ) );
+
+    // the index must find the pages showing the text, and only them
+    const QList< QUrl > allDocuments = m_search->documents();
+    int pages = 0;
+    for ( const QUrl &url : allDocuments )
+    {
+        const Okular::DocumentViewport viewport( m_document->metaData( QStringLiteral("NamedViewport"), url.toString() ).toString() );
+        if ( !viewport.isValid() )
+            continue;
+
+        const Okular::Page *page = m_document->page( viewport.pageNumber );
+        m_document->requestTextPage( page->number() );
+        QVERIFY( page->hasTextPage() );
+        QCOMPARE( documents.contains( url ), page->text().contains( text, Qt::CaseInsensitive ) );
+        ++pages;
+    }
+    QCOMPARE( pages, (int)m_document->pages() );
+}
+
 void ChmGeneratorTest::testDocumentContent()
 {
     const Okular::Page *page0 = m_document->page(0);
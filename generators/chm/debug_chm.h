@@ -0,0 +1,17 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef OKULAR_DEBUG_CHM_H
+#define OKULAR_DEBUG_CHM_H
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(OkularChmDebug)
+
+#endif
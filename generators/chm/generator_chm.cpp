@@ -10,10 +10,17 @@
 
 #include "generator_chm.h"
 
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
 #include <QEventLoop>
+#include <QFileInfo>
 #include <QMutex>
 #include <QPainter>
 #include <QDomElement>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
 
 #include <KAboutData>
 #include <khtml_part.h>
@@ -29,8 +36,16 @@
 #include <core/textpage.h>
 #include <core/utils.h>
 
+#include "lib/ebook_search.h"
+#include "debug_chm.h"
+
 OKULAR_EXPORT_PLUGIN(CHMGenerator, "libokularGenerator_chmlib.json")
 
+// how long to wait before measuring the next page when the part is busy
+static const int measureRetryDelay = 30;
+// the version of the cached search indexes, changed with the way they read the pages
+static const int searchIndexVersion = 2;
+
 static QString absolutePath( const QString &baseUrl, const QString &path )
 {
     QString absPath;
@@ -48,6 +63,93 @@ static QString absolutePath( const QString &baseUrl, const QString &path )
     return absPath;
 }
 
+/**
+ * Loads the search index of a file in the thread of the search index pool,
+ * from the cache or building it.
+ */
+class SearchIndexLoader : public QRunnable
+{
+    public:
+        SearchIndexLoader( CHMGenerator *generator, const QString &fileName, int generation, const QAtomicInt *cancelled )
+            : m_generator( generator ), m_fileName( fileName ), m_generation( generation ), m_cancelled( cancelled )
+        {
+        }
+
+        void run() override
+        {
+            // keyed on the path, checked against the size and modification time
+            const QFileInfo info( m_fileName );
+            const QString key = QString::number( searchIndexVersion ) + QLatin1Char( '/' )
+                + info.lastModified().toString( Qt::ISODate ) + QLatin1Char( '/' ) + QString::number( info.size() );
+            const QString dir = QStandardPaths::writableLocation( QStandardPaths::GenericCacheLocation ) + QStringLiteral( "/okular/chmsearch" );
+            const QString fileName = dir + QLatin1Char( '/' )
+                + QString::fromLatin1( QCryptographicHash::hash( info.absoluteFilePath().toUtf8(), QCryptographicHash::Md5 ).toHex() ) + QStringLiteral( ".index" );
+
+            EBookSearch *search = new EBookSearch();
+            bool loaded = false;
+            QFile file( fileName );
+            if ( file.open( QIODevice::ReadOnly ) )
+            {
+                QDataStream stream( &file );
+                QString fileKey;
+                stream >> fileKey;
+                loaded = fileKey == key && search->loadIndex( stream );
+            }
+
+            if ( !loaded && !build( search, key, dir, fileName ) )
+            {
+                delete search;
+                return;
+            }
+
+            // the index numbers its documents on 16 bits
+            if ( search->documents().count() > 32767 )
+            {
+                delete search;
+                return;
+            }
+
+            search->moveToThread( m_generator->thread() );
+            m_generator->setLoadedSearchIndex( m_generation, search );
+        }
+
+    private:
+        bool build( EBookSearch *search, const QString &key, const QString &dir, const QString &fileName )
+        {
+            // the file of the generator is used by the main thread
+            EBook *ebook = EBook::loadFile( m_fileName );
+            if ( !ebook )
+                return false;
+
+            // stop soon when the document is closed
+            const QMetaObject::Connection connection = QObject::connect( search, &EBookSearch::progressStep, [this, search] {
+                if ( m_cancelled->loadAcquire() && search->hasIndex() )
+                    search->cancelIndexGeneration();
+            } );
+
+            QByteArray data;
+            QDataStream stream( &data, QIODevice::WriteOnly );
+            stream << key;
+            const bool built = search->generateIndex( ebook, stream );
+            QObject::disconnect( connection );
+            delete ebook;
+            if ( !built )
+                return false;
+
+            // a failure to save only means building it again next time
+            QSaveFile saveFile( fileName );
+            if ( !QDir().mkpath( dir ) || !saveFile.open( QIODevice::WriteOnly ) || saveFile.write( data ) != data.size() || !saveFile.commit() )
+                qCWarning(OkularChmDebug) << "Failed to save the CHM search index" << fileName;
+
+            return true;
+        }
+
+        CHMGenerator *m_generator;
+        QString m_fileName;
+        int m_generation;
+        const QAtomicInt *m_cancelled;
+};
+
 CHMGenerator::CHMGenerator( QObject *parent, const QVariantList &args )
     : Okular::Generator( parent, args )
 {
@@ -56,10 +158,22 @@ CHMGenerator::CHMGenerator( QObject *parent, const QVariantList &args )
     m_syncGen=0;
     m_file=0;
     m_request = 0;
+    m_measuringPage = -1;
+    m_search = 0;
+    m_searchIndexStarted = false;
+    m_searchIndexGeneration = 0;
+    m_loadedSearch = 0;
+
+    m_measureTimer = new QTimer( this );
+    m_measureTimer->setSingleShot( true );
+    connect( m_measureTimer, &QTimer::timeout, this, &CHMGenerator::measureNextPage );
+
+    connect( this, &CHMGenerator::searchIndexLoaded, this, &CHMGenerator::searchIndexLoadingFinished, Qt::QueuedConnection );
 }
 
 CHMGenerator::~CHMGenerator()
 {
+    stopSearchIndexLoading();
     delete m_syncGen;
 }
 
@@ -143,16 +257,28 @@ bool CHMGenerator::loadDocument( const QString & fileName, QVector< Okular::Page
     }
     disconnect( m_syncGen, 0, this, 0 );
 
+    // laying out every topic takes ages on big files, so only measure the
+    // first one now and give its size to the others until they are measured
+    int width = 0;
+    int height = 0;
+    if (!m_pageUrl.isEmpty())
+    {
+        preparePageForSyncOperation(m_pageUrl.at(0));
+        width = m_syncGen->view()->contentsWidth();
+        height = m_syncGen->view()->contentsHeight();
+    }
     for (int i = 0; i < m_pageUrl.count(); ++i)
     {
-        preparePageForSyncOperation(m_pageUrl.at(i));
-        pagesVector[ i ] = new Okular::Page (i, m_syncGen->view()->contentsWidth(),
-            m_syncGen->view()->contentsHeight(), Okular::Rotation0 );
+        pagesVector[ i ] = new Okular::Page (i, width, height, Okular::Rotation0 );
+        if (i > 0)
+            m_pagesToMeasure.append(i);
     }
 
     connect( m_syncGen, SIGNAL(completed()), this, SLOT(slotCompleted()) );
     connect( m_syncGen, &KParts::ReadOnlyPart::canceled, this, &CHMGenerator::slotCompleted );
 
+    m_measureTimer->start( 0 );
+
     return true;
 }
 
@@ -166,6 +292,10 @@ bool CHMGenerator::doCloseDocument()
     m_urlPage.clear();
     m_pageUrl.clear();
     m_docSyn.clear();
+    stopSearchIndexLoading();
+    stopPageMeasuring();
+    m_pagesToMeasure.clear();
+    m_measureTimer->stop();
     if (m_syncGen)
     {
         m_syncGen->closeUrl();
@@ -190,8 +320,63 @@ void CHMGenerator::preparePageForSyncOperation(const QString & url)
     loop.exec( QEventLoop::ExcludeUserInputEvents );
 }
 
+void CHMGenerator::measureNextPage()
+{
+    if ( m_measuringPage != -1 || m_pagesToMeasure.isEmpty() || !m_file )
+        return;
+
+    // rendering and text extraction go first
+    if ( !userMutex()->tryLock() ) {
+        m_measureTimer->start( measureRetryDelay );
+        return;
+    }
+    userMutex()->unlock();
+
+    // the size is read when the part completes loading, see pageMeasured()
+    m_measuringPage = m_pagesToMeasure.takeFirst();
+    m_chmUrl = m_pageUrl.at( m_measuringPage );
+    m_syncGen->openUrl( QUrl( QStringLiteral("ms-its:") + m_fileName + QStringLiteral("::") + m_file->urlToPath( QUrl( m_chmUrl ) ) ) );
+}
+
+void CHMGenerator::pageMeasured()
+{
+    m_syncGen->view()->layout();
+    const QSizeF size( m_syncGen->view()->contentsWidth(), m_syncGen->view()->contentsHeight() );
+    if ( !size.isEmpty() ) {
+        // the document relayouts the pages measured close together at once
+        QMap<int, QSizeF> sizes;
+        sizes.insert( m_measuringPage, size );
+        updatePageSizes( sizes );
+    }
+
+    // closing may emit canceled(), that must not land here again
+    m_measuringPage = -1;
+    m_syncGen->closeUrl();
+    m_chmUrl = QString();
+
+    m_measureTimer->start( 0 );
+}
+
+void CHMGenerator::stopPageMeasuring()
+{
+    if ( m_measuringPage == -1 )
+        return;
+
+    m_pagesToMeasure.prepend( m_measuringPage );
+    m_measuringPage = -1;
+    m_syncGen->closeUrl();
+    m_chmUrl = QString();
+
+    m_measureTimer->start( measureRetryDelay );
+}
+
 void CHMGenerator::slotCompleted()
 {
+    if ( m_measuringPage != -1 ) {
+        pageMeasured();
+        return;
+    }
+
     if ( !m_request )
         return;
 
@@ -256,6 +441,11 @@ void CHMGenerator::generatePixmap( Okular::PixmapRequest * request )
     int requestWidth = request->width();
     int requestHeight = request->height();
 
+    // the part is needed for rendering, a page not measured yet gets measured next
+    stopPageMeasuring();
+    if ( m_pagesToMeasure.removeOne( request->pageNumber() ) )
+        m_pagesToMeasure.prepend( request->pageNumber() );
+
     userMutex()->lock();
     QString url= m_pageUrl[request->pageNumber()];
 
@@ -410,6 +600,7 @@ void CHMGenerator::additionalRequestData()
 
 Okular::TextPage* CHMGenerator::textPage( Okular::TextRequest * request )
 {
+    stopPageMeasuring();
     userMutex()->lock();
 
     const Okular::Page *page = request->page();
@@ -422,6 +613,110 @@ Okular::TextPage* CHMGenerator::textPage( Okular::TextRequest * request )
     return tp;
 }
 
+void CHMGenerator::startSearchIndexLoading()
+{
+    // a failed load is not tried again
+    if ( m_searchIndexStarted )
+        return;
+    m_searchIndexStarted = true;
+
+    m_searchIndexCancelled.storeRelease( 0 );
+    m_searchIndexPool.start( new SearchIndexLoader( this, m_fileName, m_searchIndexGeneration, &m_searchIndexCancelled ) );
+}
+
+void CHMGenerator::stopSearchIndexLoading()
+{
+    m_searchIndexCancelled.storeRelease( 1 );
+    m_searchIndexPool.clear();
+    m_searchIndexPool.waitForDone();
+
+    // the index the thread may have handed over is not for the next document
+    m_searchIndexMutex.lock();
+    ++m_searchIndexGeneration;
+    delete m_loadedSearch;
+    m_loadedSearch = 0;
+    m_searchIndexMutex.unlock();
+
+    m_searchIndexStarted = false;
+    delete m_search;
+    m_search = 0;
+    m_indexedPages.clear();
+}
+
+void CHMGenerator::setLoadedSearchIndex( int generation, EBookSearch *search )
+{
+    QMutexLocker locker( &m_searchIndexMutex );
+    if ( generation != m_searchIndexGeneration || m_loadedSearch )
+    {
+        delete search;
+        return;
+    }
+
+    m_loadedSearch = search;
+    emit searchIndexLoaded();
+}
+
+void CHMGenerator::searchIndexLoadingFinished()
+{
+    m_searchIndexMutex.lock();
+    EBookSearch *search = m_loadedSearch;
+    m_loadedSearch = 0;
+    m_searchIndexMutex.unlock();
+
+    if ( !search || m_search )
+    {
+        delete search;
+        return;
+    }
+
+    m_indexedPages.fill( false, m_pageUrl.count() );
+    const QList< QUrl > documents = search->documents();
+    for ( const QUrl &url : documents )
+    {
+        const int page = m_urlPage.value( url.toString(), -1 );
+        if ( page != -1 )
+            m_indexedPages.setBit( page );
+    }
+
+    m_search = search;
+}
+
+QBitArray CHMGenerator::pagesMatchingText( const QString &text )
+{
+    if ( !m_file )
+        return QBitArray();
+
+    // all the pages are searched until the index is there
+    if ( !m_search )
+    {
+        startSearchIndexLoading();
+        return QBitArray();
+    }
+
+    // the index decodes the pages on its own, so it only surely reads the
+    // ASCII text like the rendered pages show it
+    const QString normalized = text.normalized( QString::NormalizationForm_KC );
+    for ( const QChar c : normalized )
+    {
+        if ( c.unicode() > 127 )
+            return QBitArray();
+    }
+
+    QList< QUrl > documents;
+    if ( !m_search->documentsContaining( normalized, &documents ) )
+        return QBitArray();
+
+    // the pages that the index does not know about may always contain it
+    QBitArray pages = ~m_indexedPages;
+    for ( const QUrl &url : qAsConst( documents ) )
+    {
+        const int page = m_urlPage.value( url.toString(), -1 );
+        if ( page != -1 )
+            pages.setBit( page );
+    }
+    return pages;
+}
+
 QVariant CHMGenerator::metaData( const QString &key, const QVariant &option ) const
 {
     if ( key == QLatin1String("NamedViewport") && !option.toString().isEmpty() )
@@ -441,9 +736,15 @@ QVariant CHMGenerator::metaData( const QString &key, const QVariant &option ) co
     {
         return m_file->title();
     }
+    else if ( key == QLatin1String("SearchIndexLoaded") )
+    {
+        return m_search != 0;
+    }
     return QVariant();
 }
 
+Q_LOGGING_CATEGORY(OkularChmDebug, "org.kde.okular.generators.chm", QtWarningMsg)
+
 /* kate: replace-tabs on; tab-width 4; */
 
 #include "generator_chm.moc"
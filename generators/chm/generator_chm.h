@@ -17,8 +17,13 @@
 #include "lib/ebook_chm.h"
 
 #include <qbitarray.h>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThreadPool>
 
+class EBookSearch;
 class KHTMLPart;
+class QTimer;
 
 namespace Okular {
 class TextPage;
@@ -45,9 +50,15 @@ class CHMGenerator : public Okular::Generator
 
         QVariant metaData( const QString & key, const QVariant & option ) const override;
 
+        QBitArray pagesMatchingText( const QString &text ) override;
+
     public Q_SLOTS:
         void slotCompleted();
 
+    Q_SIGNALS:
+        // emitted from the search index thread when the index is in m_loadedSearch
+        void searchIndexLoaded();
+
     protected:
         bool doCloseDocument() override;
         Okular::TextPage* textPage( Okular::TextRequest *request ) override;
@@ -56,6 +67,13 @@ class CHMGenerator : public Okular::Generator
         void additionalRequestData();
         void recursiveExploreNodes( DOM::Node node, Okular::TextPage *tp );
         void preparePageForSyncOperation( const QString &url );
+        void measureNextPage();
+        void pageMeasured();
+        void stopPageMeasuring();
+        void startSearchIndexLoading();
+        void stopSearchIndexLoading();
+        void setLoadedSearchIndex( int generation, EBookSearch *search );
+        void searchIndexLoadingFinished();
         QMap<QString, int> m_urlPage;
         QVector<QString> m_pageUrl;
         Okular::DocumentSynopsis m_docSyn;
@@ -66,6 +84,24 @@ class CHMGenerator : public Okular::Generator
         Okular::PixmapRequest* m_request;
         QBitArray m_textpageAddedList;
         QBitArray m_rectsGenerated;
+        // pages with the estimated size, measured one by one when idle
+        QList<int> m_pagesToMeasure;
+        int m_measuringPage;
+        QTimer *m_measureTimer;
+        // the search index of the file, built once and kept on disk,
+        // loaded in the background the first time a search runs
+        EBookSearch *m_search;
+        QBitArray m_indexedPages;
+        bool m_searchIndexStarted;
+        QThreadPool m_searchIndexPool;
+        QAtomicInt m_searchIndexCancelled;
+        int m_searchIndexGeneration;
+        // the index loaded by the thread, taken by the main thread, both
+        // under m_searchIndexMutex so that it is deleted if never taken
+        EBookSearch *m_loadedSearch;
+        QMutex m_searchIndexMutex;
+
+        friend class SearchIndexLoader;
 };
 
 #endif
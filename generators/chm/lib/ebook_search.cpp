@@ -219,6 +219,56 @@ bool EBookSearch::searchQuery(const QString & query, QList< QUrl > * results, EB
 	return true;
 }
 
+bool EBookSearch::documentsContaining( const QString & text, QList< QUrl > * results )
+{
+	if ( !m_Index )
+		return false;
+
+	QString splitChars = m_Index->getCharsSplit();
+	QString partOfWordChars = m_Index->getCharsPartOfWord();
+
+	// Split the text into the words the same way the index generator does
+	QStringList words;
+	QString word;
+
+	for ( int i = 0; i < text.length(); i++ )
+	{
+		QChar ch = text[i].toLower();
+
+		// the index generator keeps quotes as apostrophes
+		if ( ch == '"' )
+			ch = '\'';
+
+		if ( ch.isLetterOrNumber() || partOfWordChars.indexOf( ch ) != -1 )
+		{
+			word.append( ch );
+			continue;
+		}
+
+		if ( !word.isEmpty() )
+			words.push_back( word );
+
+		word = QString();
+
+		// split chars are words of their own
+		if ( splitChars.indexOf( ch ) != -1 )
+			words.push_back( ch );
+	}
+
+	if ( !word.isEmpty() )
+		words.push_back( word );
+
+	if ( words.isEmpty() )
+		return false;
+
+	return m_Index->documentsContaining( words, results );
+}
+
+QList< QUrl > EBookSearch::documents() const
+{
+	return m_Index ? m_Index->documents() : QList< QUrl >();
+}
+
 bool EBookSearch::hasIndex() const
 {
 	return m_Index != 0;
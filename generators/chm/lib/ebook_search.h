@@ -62,6 +62,15 @@ class EBookSearch : public QObject
 		//! not merging search results, make sure it's empty.
 		bool	searchQuery ( const QString& query, QList< QUrl > * results, EBook * ebookFile, unsigned int limit = 100 );
 		
+		//! Finds the documents which may contain the piece of text \param text, ignoring the case, and
+		//! stores them into \param results. Unlike searchQuery(), the first and last words of \param text
+		//! may be parts of the document words, and there are no phrases. The return value is false if
+		//! the index is not generated, or \param text has no word to look up or one too long to look up.
+		bool	documentsContaining( const QString& text, QList< QUrl > * results );
+
+		//! Returns all the documents in the search index
+		QList< QUrl > documents() const;
+
 		//! Returns true if a valid search index is present, and therefore search could be executed
 		bool	hasIndex() const;
 		
@@ -207,15 +207,21 @@ QString HelperEntityDecoder::decode( const QString &entity ) const
 	else if ( entity[0] == '#' )
 	{
 		bool valid;
-		unsigned int ascode = entity.mid(1).toUInt( &valid );
+		uint ascode;
 
-		if ( !valid )
+		// The code may be hexadecimal too, like &#x3c;
+		if ( entity.length() > 1 && ( entity[1] == 'x' || entity[1] == 'X' ) )
+			ascode = entity.mid(2).toUInt( &valid, 16 );
+		else
+			ascode = entity.mid(1).toUInt( &valid );
+
+		if ( !valid || ascode > 0x10FFFF )
 		{
 			qWarning ( "HelperEntityDecoder::decode: could not decode HTML entity '%s'", qPrintable( entity ) );
 			return QString();
 		}
 
-		return (QString) (QChar( ascode ));
+		return QString::fromUcs4( &ascode, 1 );
 	}
 	else
 	{
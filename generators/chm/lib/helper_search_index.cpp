@@ -17,6 +17,7 @@
  */
 
 #include <QApplication>
+#include <QSet>
 #include <QTextCodec>
 
 #include "ebook.h"
@@ -35,6 +36,14 @@ static const char SPLIT_CHARACTERS[] = "!()*&^%#@[]{}':;,.?/|/?<>\\-+=~`";
 // Those characters are parts of word - for example, '_' is here, and search for _debug will find only _debug.
 static const char WORD_CHARACTERS[] = "$_";
 
+// The words glued by the tags are indexed as long as those between the first and the last one
+// are up to that length, so the longer words of a query can't be looked up.
+static const int GLUED_WORDS_LENGTH = 32;
+
+// The token of the documents with content which is not in their text, like scripts. It has a space,
+// so that no word of a query is this token.
+static const char DYNAMIC_CONTENT_TOKEN[] = "<dynamic content>";
+
 
 struct Term
 {
@@ -98,12 +107,15 @@ bool Index::makeIndex(const QList< QUrl >& docs, EBook *chmFile )
 			return false;
 
 		QUrl filename = *it;
-		QStringList terms;
+		QStringList terms, altterms;
 		
-		if ( parseDocumentToStringlist( chmFile, filename, terms ) )
+		if ( parseDocumentToStringlist( chmFile, filename, terms, &altterms ) )
 		{
 			for ( QStringList::ConstIterator tit = terms.constBegin(); tit != terms.constEnd(); ++tit )
 				insertInDict( *tit, i );
+
+			for ( QStringList::ConstIterator tit = altterms.constBegin(); tit != altterms.constEnd(); ++tit )
+				insertInDict( *tit, i );
 		}
 		
 		if ( i%steps == 0 )
@@ -139,9 +151,16 @@ void Index::insertInDict( const QString &str, int docNum )
 }
 
 
-bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStringList& tokenlist )
+// The tags with content the rendered page may show, which is not in the document text
+static bool isDynamicContentTag( const QString& tagname )
+{
+	return tagname == "script" || tagname == "iframe" || tagname == "frame"
+		|| tagname == "object" || tagname == "embed" || tagname == "applet";
+}
+
+bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStringList& tokenlist, QStringList *alttokens )
 {
-	QString parsedbuf, parseentity, text;
+	QString parsedbuf, parseentity, text, tagname;
 	
 	if ( !chmFile->getFileContentAsString( text, filename )
 	|| text.isEmpty() )
@@ -154,6 +173,9 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStr
 	m_charsword = WORD_CHARACTERS;
 	
 	tokenlist.clear();
+
+	if ( alttokens )
+		alttokens->clear();
 	
 	// State machine states
 	enum state_t
@@ -166,6 +188,112 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStr
 	
 	state_t state = STATE_OUTSIDE_TAGS;
 	QChar QuoteChar; // used in STATE_IN_QUOTES
+	bool readtagname = false; // used in STATE_IN_HTML_TAG
+	bool dynamic = false;
+
+	// The rendered page puts the text of the elements one after the other, so the words
+	// only separated by tags and spaces may be shown glued together. The last ones are kept
+	// while the words between the first and the last one fit GLUED_WORDS_LENGTH.
+	QStringList gluedwords;
+	bool gluenext = false;
+
+	// Adds the pieces of the word in the NFKC form, which the text is searched in
+	auto addNormalized = [&]( const QString& word )
+	{
+		const QString normalized = word.normalized( QString::NormalizationForm_KC );
+
+		if ( normalized == word )
+			return;
+
+		QString piece;
+
+		for ( int i = 0; i < normalized.length(); i++ )
+		{
+			QChar ch = normalized[i];
+
+			if ( ch == '"' )
+				ch = '\'';
+
+			if ( ch.isLetterOrNumber() || m_charsword.indexOf( ch ) != -1 )
+			{
+				piece.append( ch );
+				continue;
+			}
+
+			if ( !piece.isEmpty() )
+				alttokens->push_back( piece.toLower() );
+
+			piece = QString();
+
+			if ( m_charssplit.indexOf( ch ) != -1 )
+				alttokens->push_back( ch.toLower() );
+		}
+
+		if ( !piece.isEmpty() )
+			alttokens->push_back( piece.toLower() );
+	};
+
+	// Adds the word in the buffer to the dictionary
+	auto tokenizeBuf = [&]()
+	{
+		if ( parsedbuf.isEmpty() )
+			return;
+
+		tokenlist.push_back( parsedbuf.toLower() );
+
+		if ( alttokens )
+		{
+			addNormalized( parsedbuf );
+
+			if ( !gluenext )
+				gluedwords.clear();
+
+			gluedwords.push_back( parsedbuf );
+
+			while ( gluedwords.size() > 2 && gluedwords.join( QString() ).length()
+					- gluedwords.first().length() - gluedwords.last().length() > GLUED_WORDS_LENGTH )
+				gluedwords.pop_front();
+
+			// Every run of words ending with this one
+			for ( int i = gluedwords.size() - 2; i >= 0; i-- )
+			{
+				const QString glued = gluedwords.mid( i ).join( QString() );
+				alttokens->push_back( glued.toLower() );
+				addNormalized( glued );
+			}
+		}
+
+		parsedbuf = QString();
+		gluenext = false;
+	};
+
+	// Adds a character of the text, either written or decoded from an entity
+	auto parseTextChar = [&]( QChar ch )
+	{
+		// Replace quote by ' - quotes are used in search window to set the phrase
+		if ( ch == '"' )
+			ch = '\'';
+
+		// If it is char or letter, add it and continue
+		if ( ch.isLetterOrNumber() || m_charsword.indexOf( ch ) != -1 )
+		{
+			parsedbuf.append( ch );
+			return;
+		}
+
+		tokenizeBuf();
+
+		// A space keeps the words around it glued if there is a tag too
+		if ( ch.isSpace() )
+			return;
+
+		gluedwords.clear();
+		gluenext = false;
+
+		// If it is a split char, add the char itself after the word.
+		if ( m_charssplit.indexOf( ch ) != -1 )
+			tokenlist.push_back( ch.toLower() );
+	};
 	
 	for ( int j = 0; j < text.length(); j++ )
 	{
@@ -177,6 +305,24 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStr
 		if ( state == STATE_IN_HTML_TAG )
 		{
 			// We are inside HTML tag.
+			// Read its name to find the content which is not in the text
+			if ( readtagname )
+			{
+				if ( ch.isLetterOrNumber() )
+				{
+					tagname.append( ch.toLower() );
+					continue;
+				}
+
+				readtagname = false;
+
+				if ( alttokens && !dynamic && isDynamicContentTag( tagname ) )
+				{
+					alttokens->push_back( DYNAMIC_CONTENT_TOKEN );
+					dynamic = true;
+				}
+			}
+
 			// Ignore everything until we see '>' (end of HTML tag) or quote char (quote start)
 			if ( ch == '"' || ch == '\'' )
 			{
@@ -199,9 +345,9 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStr
 		}
 		else if ( state == STATE_IN_HTML_ENTITY )
 		{
-			// We are inside encoded HTML entity (like &nbsp;).
-			// Collect to parsedbuf everything until we see ;
-			if ( ch.isLetterOrNumber() )
+			// We are inside encoded HTML entity (like &nbsp; or &#160;).
+			// Collect to parseentity everything until we see ;
+			if ( ch.isLetterOrNumber() || ( ch == '#' && parseentity.isEmpty() ) )
 			{
 				// get next character of this entity
 				parseentity.append( ch );
@@ -210,39 +356,26 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStr
 				
 			// The entity ended
 			state = STATE_OUTSIDE_TAGS;
-			
-			// Some shitty HTML does not terminate entities correctly. Screw it.			
-			if ( ch != ';' && ch != '<' )
-			{
-				if ( parseentity.isEmpty() )
-				{
-					// straight '&' symbol. Add and continue.
-					parsedbuf += "&";
-				}
-				else
-					qWarning( "Index::parseDocument: incorrectly terminated HTML entity '&%s%c', ignoring", qPrintable( parseentity ), ch.toLatin1() );
-				
-				j--; // parse this character again, but in different state
-				continue;
-			}
-			
-			// Don't we have a space?
-			if ( parseentity.toLower() != "nbsp" )
+
+			QString entity;
+
+			if ( ch == ';' && !parseentity.isEmpty() )
+				entity = entityDecoder.decode( parseentity );
+
+			// Some shitty HTML does not terminate entities correctly, or uses unknown ones.
+			// The page shows them as they are written, so parse them again as text.
+			if ( entity.isEmpty() )
 			{
-				QString entity = entityDecoder.decode( parseentity );
-			
-				if ( entity.isNull() )
-				{
-					// decodeEntity() already printed error message
-					//qWarning( "Index::parseDocument: failed to decode entity &%s;", parsedbuf.ascii() );
-					continue;
-				}
-			
-				parsedbuf += entity;
+				parseTextChar( '&' );
+				j -= parseentity.length() + 1;
 				continue;
 			}
-			else
-				ch = ' '; // We got a space, so treat it like it, and not add it to parsebuf
+
+			// The decoded characters are text too, &nbsp; being a space
+			for ( int i = 0; i < entity.length(); i++ )
+				parseTextChar( entity[i] );
+
+			continue;
 		}
 		
 		// 
@@ -252,8 +385,12 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStr
 		// Check for start of HTML tag, and switch to STATE_IN_HTML_TAG if it is
 		if ( ch == '<' )
 		{
+			tokenizeBuf();
 			state = STATE_IN_HTML_TAG;
-			goto tokenize_buf;
+			readtagname = true;
+			tagname = QString();
+			gluenext = true;
+			continue;
 		}
 		
 		// Check for start of HTML entity
@@ -264,41 +401,11 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl& filename, QStr
 			continue;
 		}
 		
-		// Replace quote by ' - quotes are used in search window to set the phrase
-		if ( ch == '"' )
-			ch = '\'';
-		
-		// Ok, we have a valid character outside HTML tags, and probably some in buffer already.
-		// If it is char or letter, add it and continue
-		if ( ch.isLetterOrNumber() || m_charsword.indexOf( ch ) != -1 )
-		{
-			parsedbuf.append( ch );
-			continue;
-		}
-		
-		// If it is a split char, add the word to the dictionary, and then add the char itself.
-		if ( m_charssplit.indexOf( ch ) != -1 )
-		{
-			if ( !parsedbuf.isEmpty() )
-				tokenlist.push_back( parsedbuf.toLower() );
-			
-			tokenlist.push_back( ch.toLower() );
-			parsedbuf = QString();
-			continue;
-		}
-		
-tokenize_buf:		
-		// Just add the word; it is most likely a space or terminated by tokenizer.
-		if ( !parsedbuf.isEmpty() )
-		{
-			tokenlist.push_back( parsedbuf.toLower() );
-			parsedbuf = QString();
-		}
+		parseTextChar( ch );
 	}
 	
 	// Add the last word if still here - for broken htmls.
-	if ( !parsedbuf.isEmpty() )
-		tokenlist.push_back( parsedbuf.toLower() );
+	tokenizeBuf();
 	
 	return true;
 }
@@ -421,6 +528,87 @@ QList< QUrl > Index::query(const QStringList &terms, const QStringList &termSeq,
 }
 
 
+// Unlike query(), the first word may be the end of a document word and the last one the start
+// of a document word, as when looking for a piece of text in the document. The documents with
+// content which is not in their text may show any word.
+bool Index::documentsContaining( const QStringList &words, QList< QUrl > *results ) const
+{
+	// The longer words may be glued by tags in a way the dictionary does not have
+	for ( int w = 0; w < words.count(); ++w )
+	{
+		if ( words[w].length() > GLUED_WORDS_LENGTH )
+			return false;
+	}
+
+	QSet<int> docs;
+
+	for ( int w = 0; w < words.count(); ++w )
+	{
+		const QString& word = words[w];
+		const bool first = w == 0;
+		const bool last = w == words.count() - 1;
+		QSet<int> wordDocs;
+
+		if ( !first && !last )
+		{
+			const Entry *e = dict.value( word );
+
+			if ( e )
+			{
+				for ( QVector<Document>::ConstIterator it = e->documents.constBegin(); it != e->documents.constEnd(); ++it )
+					wordDocs.insert( (*it).docNumber );
+			}
+		}
+		else
+		{
+			for ( QHash<QString, Entry *>::ConstIterator it = dict.constBegin(); it != dict.constEnd(); ++it )
+			{
+				bool matches;
+
+				if ( first && last )
+					matches = it.key().contains( word );
+				else if ( first )
+					matches = it.key().endsWith( word );
+				else
+					matches = it.key().startsWith( word );
+
+				if ( !matches )
+					continue;
+
+				for ( QVector<Document>::ConstIterator doc_it = it.value()->documents.constBegin(); doc_it != it.value()->documents.constEnd(); ++doc_it )
+					wordDocs.insert( (*doc_it).docNumber );
+			}
+		}
+
+		if ( first )
+			docs = wordDocs;
+		else
+			docs.intersect( wordDocs );
+
+		if ( docs.isEmpty() )
+			break;
+	}
+
+	const Entry *dynamic = dict.value( DYNAMIC_CONTENT_TOKEN );
+
+	if ( dynamic )
+	{
+		for ( QVector<Document>::ConstIterator it = dynamic->documents.constBegin(); it != dynamic->documents.constEnd(); ++it )
+			docs.insert( (*it).docNumber );
+	}
+
+	results->clear();
+	for ( QSet<int>::ConstIterator it = docs.constBegin(); it != docs.constEnd(); ++it )
+	{
+		// the document numbers are 16 bit
+		if ( *it >= 0 && *it < docList.count() )
+			*results << docList.at( *it );
+	}
+
+	return true;
+}
+
+
 bool Index::searchForPhrases( const QStringList &phrases, const QStringList &words, const QUrl &filename, EBook * chmFile )
 {
 	QStringList parsed_document;
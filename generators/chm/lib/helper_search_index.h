@@ -76,6 +76,8 @@ class Index : public QObject
 		bool 		readDict( QDataStream& stream );
 		bool 		makeIndex(const QList<QUrl> &docs, EBook * chmFile );
 		QList<QUrl>	query( const QStringList&, const QStringList&, const QStringList&, EBook * chmFile );
+		bool		documentsContaining( const QStringList& words, QList<QUrl> * results ) const;
+		const QList<QUrl>& documents() const { return docList; }
 		QString 	getCharsSplit() const { return m_charssplit; }
 		QString 	getCharsPartOfWord() const { return m_charsword; }
 
@@ -99,7 +101,8 @@ class Index : public QObject
 			QList<uint> positions;
 		};
 		
-		bool	parseDocumentToStringlist( EBook * chmFile, const QUrl& filename, QStringList& tokenlist );
+		// Also adds the other spellings the rendered page may show the words with to alttokens, if given
+		bool	parseDocumentToStringlist( EBook * chmFile, const QUrl& filename, QStringList& tokenlist, QStringList *alttokens = 0 );
 		void	insertInDict( const QString&, int );
 		
 		QStringList				getWildcardTerms( const QString& );
@@ -9,9 +9,11 @@
 
 #include "document.h"
 
+#include <QBuffer>
 #include <QScopedPointer>
 #include <QImage>
 #include <QImageReader>
+#include <QMutexLocker>
 
 #include <KLocalizedString>
 #include <QMimeType>
@@ -33,6 +35,30 @@
 
 using namespace ComicBook;
 
+// the memory for compressed entries and decoded images, in bytes
+static const int entryCacheBudget = 32 * 1024 * 1024;
+static const int imageCacheBudget = 128 * 1024 * 1024;
+
+// whether 'file' has the extension of an image format that can be read
+static bool hasImageExtension( const QString &file )
+{
+    static const QList<QByteArray> formats = QImageReader::supportedImageFormats();
+    const int dot = file.lastIndexOf( QLatin1Char( '.' ) );
+    return dot != -1 && formats.contains( file.mid( dot + 1 ).toLower().toLatin1() );
+}
+
+// drops the least recently used items of 'cache' to free up to 'bytes'
+template <typename T>
+static qulonglong shrinkCache( QCache<int, T> *cache, qulonglong bytes )
+{
+    const int before = cache->totalCost();
+    const int maxCost = cache->maxCost();
+    // lowering the maximum cost trims the cache
+    cache->setMaxCost( bytes >= qulonglong( before ) ? 0 : before - int( bytes ) );
+    cache->setMaxCost( maxCost );
+    return before - cache->totalCost();
+}
+
 static void imagesInArchive( const QString &prefix, const KArchiveDirectory* dir, QStringList *entries )
 {
     const QStringList entryList =  dir->entries();
@@ -48,7 +74,8 @@ static void imagesInArchive( const QString &prefix, const KArchiveDirectory* dir
 
 
 Document::Document()
-    : mDirectory( nullptr ), mUnrar( nullptr ), mArchive( nullptr )
+    : mDirectory( nullptr ), mUnrar( nullptr ), mArchive( nullptr ),
+      mEntryCache( entryCacheBudget ), mImageCache( imageCacheBudget )
 {
 }
 
@@ -140,6 +167,12 @@ void Document::close()
 {
     mLastErrorString.clear();
 
+    {
+        QMutexLocker locker( &mCacheMutex );
+        mEntryCache.clear();
+        mImageCache.clear();
+    }
+
     if ( !( mArchive || mUnrar || mDirectory ) )
         return;
 
@@ -151,6 +184,7 @@ void Document::close()
     mUnrar = nullptr;
     mPageMap.clear();
     mEntries.clear();
+    mProvisionalPages.clear();
 }
 
 bool Document::processArchive() {
@@ -179,45 +213,75 @@ bool Document::processArchive() {
 void Document::pages( QVector<Okular::Page*> * pagesVector )
 {
     std::sort(mEntries.begin(), mEntries.end(), caseSensitiveNaturalOrderLessThen);
-    QScopedPointer< QIODevice > dev;
 
     int count = 0;
     pagesVector->clear();
     pagesVector->resize( mEntries.size() );
-    QImageReader reader;
+    mProvisionalPages.clear();
+    QSize provisionalSize;
     for (const QString &file : qAsConst(mEntries)) {
-        if ( mArchive ) {
-            const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
-            if ( entry ) {
-                dev.reset( entry->createDevice() );
-            }
-        } else if ( mDirectory ) {
-            dev.reset( mDirectory->createDevice( file ) );
-        } else {
-            dev.reset( mUnrar->createDevice( file ) );
+        // reading the size of each image may mean decompressing most of the
+        // archive, the pages that surely are images get the size of the
+        // first one for now
+        const bool provisional = provisionalSize.isValid() && hasImageExtension( file );
+        const QSize pageSize = provisional ? provisionalSize : entrySize( file );
+        if ( pageSize.isValid() ) {
+            pagesVector->replace( count, new Okular::Page( count, pageSize.width(), pageSize.height(), Okular::Rotation0 ) );
+            mPageMap.append(file);
+            if ( provisional )
+                mProvisionalPages.append( count );
+            else if ( !provisionalSize.isValid() )
+                provisionalSize = pageSize;
+            count++;
         }
+    }
+    pagesVector->resize( count );
+}
 
-        if ( ! dev.isNull() ) {
-            reader.setDevice( dev.data() );
-            if ( reader.canRead() )
-            {
-                QSize pageSize = reader.size();
-                if ( !pageSize.isValid() ) {
-                    const QImage i = reader.read();
-                    if ( !i.isNull() )
-                        pageSize = i.size();
-                }
-                if ( pageSize.isValid() ) {
-                    pagesVector->replace( count, new Okular::Page( count, pageSize.width(), pageSize.height(), Okular::Rotation0 ) );
-                    mPageMap.append(file);
-                    count++;
-                } else {
-                    qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image even if QImageReader::canRead returned true";
-                }
-            }
+QVector<int> Document::provisionalPages() const
+{
+    return mProvisionalPages;
+}
+
+QSize Document::pageSize( int page ) const
+{
+    return entrySize( mPageMap[ page ] );
+}
+
+QSize Document::entrySize( const QString &file ) const
+{
+    // archives can't be read from several threads at once
+    QMutexLocker locker( mArchive ? &mCacheMutex : nullptr );
+
+    QScopedPointer< QIODevice > dev;
+    if ( mArchive ) {
+        const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
+        if ( entry ) {
+            dev.reset( entry->createDevice() );
         }
+    } else if ( mDirectory ) {
+        dev.reset( mDirectory->createDevice( file ) );
+    } else {
+        dev.reset( mUnrar->createDevice( file ) );
     }
-    pagesVector->resize( count );
+
+    if ( dev.isNull() )
+        return QSize();
+
+    QImageReader reader( dev.data() );
+    if ( !reader.canRead() )
+        return QSize();
+
+    QSize pageSize = reader.size();
+    if ( !pageSize.isValid() ) {
+        const QImage i = reader.read();
+        if ( !i.isNull() )
+            pageSize = i.size();
+    }
+    if ( !pageSize.isValid() ) {
+        qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image even if QImageReader::canRead returned true";
+    }
+    return pageSize;
 }
 
 QStringList Document::pageTitles() const
@@ -225,19 +289,73 @@ QStringList Document::pageTitles() const
     return QStringList();
 }
 
-QImage Document::pageImage( int page ) const
+QImage Document::pageImage( int page, const QSize &size ) const
 {
-    if ( mArchive ) {
-        const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( mPageMap[ page ] ) );
-        if ( entry )
-            return QImage::fromData( entry->data() );
-    } else if ( mDirectory ) {
-        return QImage( mPageMap[ page ] );
+    QMutexLocker locker( &mCacheMutex );
+
+    // the thumbnails and the main view often want the same page at different sizes
+    if ( const CachedImage *cached = mImageCache.object( page ) ) {
+        if ( cached->fullSize || ( size.isValid() && cached->image.width() >= size.width() && cached->image.height() >= size.height() ) )
+            return cached->image;
+    }
+
+    QImageReader reader;
+    QBuffer buffer;
+    if ( mDirectory ) {
+        reader.setFileName( mPageMap[ page ] );
     } else {
-        return QImage::fromData( mUnrar->contentOf( mPageMap[ page ] ) );
+        QByteArray data;
+        if ( const QByteArray *cached = mEntryCache.object( page ) ) {
+            data = *cached;
+        } else {
+            if ( mArchive ) {
+                const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( mPageMap[ page ] ) );
+                if ( entry )
+                    data = entry->data();
+            } else {
+                data = mUnrar->contentOf( mPageMap[ page ] );
+            }
+            if ( data.isEmpty() )
+                return QImage();
+            mEntryCache.insert( page, new QByteArray( data ), data.size() );
+        }
+        buffer.setData( data );
+        buffer.open( QIODevice::ReadOnly );
+        reader.setDevice( &buffer );
     }
 
-    return QImage();
+    // formats like JPEG decode straight at a reduced size, the others are
+    // rescaled by QImageReader
+    const QSize pageSize = reader.size();
+    const bool fullSize = !size.isValid() || !pageSize.isValid() ||
+                          size.width() >= pageSize.width() || size.height() >= pageSize.height();
+    if ( !fullSize )
+        reader.setScaledSize( size );
+
+    CachedImage *decoded = new CachedImage;
+    decoded->image = reader.read();
+    decoded->fullSize = fullSize;
+    const QImage image = decoded->image;
+    if ( image.isNull() )
+        delete decoded;
+    else
+        mImageCache.insert( page, decoded, image.bytesPerLine() * image.height() );
+
+    return image;
+}
+
+qulonglong Document::freeCache( qulonglong bytes )
+{
+    // don't wait for a page being decoded
+    if ( !mCacheMutex.tryLock() )
+        return 0;
+
+    qulonglong freed = shrinkCache( &mImageCache, bytes );
+    if ( freed < bytes )
+        freed += shrinkCache( &mEntryCache, bytes - freed );
+
+    mCacheMutex.unlock();
+    return freed;
 }
 
 QString Document::lastErrorString() const
@@ -10,11 +10,13 @@
 #ifndef COMICBOOK_DOCUMENT_H
 #define COMICBOOK_DOCUMENT_H
 
+#include <QCache>
+#include <QImage>
+#include <QMutex>
 #include <QStringList>
 
 class KArchiveDirectory;
 class KArchive;
-class QImage;
 class Unrar;
 class Directory;
 
@@ -33,15 +35,44 @@ class Document
         bool open( const QString &fileName );
         void close();
 
+        /**
+         * Fills @p pagesVector with the pages of the document. Only the size
+         * of the first page, and of the entries that don't look like images,
+         * is read: the other pages have the size of the first one until
+         * pageSize() tells theirs, see provisionalPages().
+         */
         void pages( QVector<Okular::Page*> * pagesVector );
+
+        /**
+         * Returns the pages that pages() gave a provisional size.
+         */
+        QVector<int> provisionalPages() const;
+
+        /**
+         * Reads the size of @p page from its image, returns an invalid size on
+         * failure. It can be called from any thread.
+         */
+        QSize pageSize( int page ) const;
         QStringList pageTitles() const;
 
-        QImage pageImage( int page ) const;
+        /**
+         * Returns the image of @p page. If @p size is valid the image may be
+         * decoded at that size, when smaller than the page, which for some
+         * formats like JPEG is much faster than decoding it whole.
+         */
+        QImage pageImage( int page, const QSize &size = QSize() ) const;
+
+        /**
+         * Frees up to @p bytes of the cached entries and images, unless
+         * a page is being decoded, returns the freed bytes.
+         */
+        qulonglong freeCache( qulonglong bytes );
 
         QString lastErrorString() const;
 
     private:
         bool processArchive();
+        QSize entrySize( const QString &file ) const;
 
         QStringList mPageMap;
         Directory *mDirectory;
@@ -50,6 +81,23 @@ class Document
         const KArchiveDirectory *mArchiveDir;
         QString mLastErrorString;
         QStringList mEntries;
+        QVector<int> mProvisionalPages;
+
+        class CachedImage
+        {
+            public:
+                QImage image;
+                // whether the image was decoded at the page size
+                bool fullSize;
+        };
+
+        // guards the caches and the archive, the pages are decoded in a
+        // thread while printing or freeing memory happen in the main one
+        mutable QMutex mCacheMutex;
+        // the compressed data of the last read entries, by page
+        mutable QCache<int, QByteArray> mEntryCache;
+        // the biggest image lately decoded for each page
+        mutable QCache<int, CachedImage> mImageCache;
 };
 
 }
@@ -11,6 +11,7 @@
 
 #include <QPainter>
 #include <QPrinter>
+#include <QRunnable>
 
 #include <KAboutData>
 #include <KLocalizedString>
@@ -23,16 +24,62 @@
 
 OKULAR_EXPORT_PLUGIN(ComicBookGenerator, "libokularGenerator_comicbook.json")
 
+// how many pages a probing job reads the size of
+static const int pagesPerProbe = 16;
+
+/**
+ * Reads the size of some pages in a thread of the probing pool.
+ */
+class PageSizeProbe : public QRunnable
+{
+    public:
+        PageSizeProbe( ComicBookGenerator *generator, const ComicBook::Document *document, int generation,
+                       const QVector<int> &pages, const QAtomicInt *cancelled )
+            : mGenerator( generator ), mDocument( document ), mGeneration( generation ),
+              mPages( pages ), mCancelled( cancelled )
+        {
+        }
+
+        void run() override
+        {
+            for ( int page : qAsConst( mPages ) ) {
+                if ( mCancelled->loadAcquire() )
+                    return;
+
+                const QSize size = mDocument->pageSize( page );
+                if ( size.isValid() )
+                    emit mGenerator->pageSizeProbed( mGeneration, page, size );
+            }
+        }
+
+    private:
+        ComicBookGenerator *mGenerator;
+        const ComicBook::Document *mDocument;
+        int mGeneration;
+        QVector<int> mPages;
+        const QAtomicInt *mCancelled;
+};
+
 ComicBookGenerator::ComicBookGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args )
+    : Generator( parent, args ), mProbeGeneration( 0 )
 {
     setFeature( Threaded );
     setFeature( PrintNative );
     setFeature( PrintToFile );
+
+    // the document gathers the sizes and relayouts the pages in batches
+    connect( this, &ComicBookGenerator::pageSizeProbed, this, [this]( int generation, int page, const QSize &size ) {
+        if ( generation != mProbeGeneration )
+            return;
+        QMap<int, QSizeF> sizes;
+        sizes.insert( page, QSizeF( size ) );
+        updatePageSizes( sizes );
+    }, Qt::QueuedConnection );
 }
 
 ComicBookGenerator::~ComicBookGenerator()
 {
+    stopPageSizeProbing();
 }
 
 bool ComicBookGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*> & pagesVector )
@@ -46,24 +93,48 @@ bool ComicBookGenerator::loadDocument( const QString & fileName, QVector<Okular:
     }
 
     mDocument.pages( &pagesVector );
+    startPageSizeProbing();
     return true;
 }
 
 bool ComicBookGenerator::doCloseDocument()
 {
+    stopPageSizeProbing();
     mDocument.close();
 
     return true;
 }
 
+void ComicBookGenerator::startPageSizeProbing()
+{
+    const QVector<int> pages = mDocument.provisionalPages();
+    mProbeCancelled.storeRelease( 0 );
+    ++mProbeGeneration;
+    for ( int i = 0; i < pages.count(); i += pagesPerProbe )
+        mProbePool.start( new PageSizeProbe( this, &mDocument, mProbeGeneration, pages.mid( i, pagesPerProbe ), &mProbeCancelled ) );
+}
+
+void ComicBookGenerator::stopPageSizeProbing()
+{
+    mProbeCancelled.storeRelease( 1 );
+    mProbePool.clear();
+    mProbePool.waitForDone();
+}
+
 QImage ComicBookGenerator::image( Okular::PixmapRequest * request )
 {
-    int width = request->width();
-    int height = request->height();
+    const QSize size( request->width(), request->height() );
 
-    QImage image = mDocument.pageImage( request->pageNumber() );
+    QImage image = mDocument.pageImage( request->pageNumber(), size );
+    if ( image.size() != size )
+        image = image.scaled( size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
 
-    return image.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    return image;
+}
+
+qulonglong ComicBookGenerator::freeCachedMemory( qulonglong bytes )
+{
+    return mDocument.freeCache( bytes );
 }
 
 bool ComicBookGenerator::print( QPrinter& printer )
@@ -12,6 +12,9 @@
 
 #include <core/generator.h>
 
+#include <QAtomicInt>
+#include <QThreadPool>
+
 #include "document.h"
 
 class ComicBookGenerator : public Okular::Generator
@@ -29,12 +32,26 @@ class ComicBookGenerator : public Okular::Generator
         // [INHERITED] print document using already configured kprinter
         bool print( QPrinter& printer ) override;
 
+    Q_SIGNALS:
+        // emitted from the probing threads when the size of 'page' is read,
+        // 'generation' tells the document it belongs to
+        void pageSizeProbed( int generation, int page, const QSize &size );
+
     protected:
         bool doCloseDocument() override;
         QImage image( Okular::PixmapRequest * request ) override;
+        qulonglong freeCachedMemory( qulonglong bytes ) override;
 
     private:
-      ComicBook::Document mDocument;
+        void startPageSizeProbing();
+        void stopPageSizeProbing();
+
+        ComicBook::Document mDocument;
+
+        // reads the real size of the pages with a provisional one
+        QThreadPool mProbePool;
+        QAtomicInt mProbeCancelled;
+        int mProbeGeneration;
 };
 
 #endif
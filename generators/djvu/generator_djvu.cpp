@@ -18,6 +18,8 @@
 #include <core/utils.h>
 #include <core/fileprinter.h>
 
+#include "settings_core.h"
+
 #include <QDomDocument>
 #include <QMutex>
 #include <QPixmap>
@@ -74,6 +76,7 @@ DjVuGenerator::DjVuGenerator( QObject *parent, const QVariantList &args )
 {
     setFeature( TextExtraction );
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintPostscript );
     if ( Okular::FilePrinter::ps2pdfAvailable() )
         setFeature( PrintToFile );
@@ -87,9 +90,27 @@ DjVuGenerator::~DjVuGenerator()
     delete m_djvu;
 }
 
+// the decoded pages are kept in a share of memory that grows with the memory level
+static qulonglong cacheBudget()
+{
+    switch ( Okular::SettingsCore::memoryLevel() )
+    {
+        case Okular::SettingsCore::EnumMemoryLevel::Low:
+            return 16 * 1024 * 1024;
+        case Okular::SettingsCore::EnumMemoryLevel::Aggressive:
+            return 128 * 1024 * 1024;
+        case Okular::SettingsCore::EnumMemoryLevel::Greedy:
+            return 256 * 1024 * 1024;
+        case Okular::SettingsCore::EnumMemoryLevel::Normal:
+        default:
+            return 64 * 1024 * 1024;
+    }
+}
+
 bool DjVuGenerator::loadDocument( const QString & fileName, QVector< Okular::Page * > & pagesVector )
 {
     QMutexLocker locker( userMutex() );
+    m_djvu->setCacheBudget( cacheBudget() );
     if ( !m_djvu->openFile( fileName ) )
         return false;
 
@@ -112,10 +133,25 @@ bool DjVuGenerator::doCloseDocument()
     return true;
 }
 
+qulonglong DjVuGenerator::freeCachedMemory( qulonglong bytes )
+{
+    // the cache has its own lock, the pages being rendered are kept
+    return m_djvu->freeCache( bytes );
+}
+
 QImage DjVuGenerator::image( Okular::PixmapRequest *request )
 {
     userMutex()->lock();
-    QImage img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    QImage img;
+    if ( request->isTile() )
+    {
+        const QRect rect = request->normalizedRect().geometry( request->width(), request->height() );
+        img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation(), rect );
+    }
+    else
+    {
+        img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    }
     userMutex()->unlock();
     return img;
 }
@@ -44,6 +44,7 @@ class DjVuGenerator : public Okular::Generator
         // pixmap generation
         QImage image( Okular::PixmapRequest *request ) override;
         Okular::TextPage* textPage( Okular::TextRequest *request ) override;
+        qulonglong freeCachedMemory( qulonglong bytes ) override;
 
     private:
         void loadPages( QVector<Okular::Page*> & pagesVector, int rotation );
@@ -14,9 +14,12 @@
 #include <QFile>
 #include <QHash>
 #include <QList>
-#include <QPainter>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QQueue>
+#include <QRunnable>
 #include <QString>
+#include <QThreadPool>
 
 #include <QDebug>
 #include <KLocalizedString>
@@ -24,7 +27,10 @@
 #include <libdjvu/ddjvuapi.h>
 #include <libdjvu/miniexp.h>
 
+#include <algorithm>
+
 #include <stdio.h>
+#include <string.h>
 
 QDebug &operator<<( QDebug & s, const ddjvu_rect_t &r )
 {
@@ -143,18 +149,44 @@ static bool find_replace_or_add_second_in_pair( miniexp_t theexp, const char* wh
     return false;
 }
 
-// ImageCacheItem
+// CacheItem
+
+// the cache holds 64 MiB of decoded pages and rendered images by default
+static const qulonglong defaultCacheBudget = 64 * 1024 * 1024;
 
-class ImageCacheItem
+/**
+ * An entry of the KDjVu cache: either a decoded page (djvupage is set) or
+ * an image rendered from it.
+ */
+class CacheItem
 {
     public:
-        ImageCacheItem( int p, int w, int h, const QImage& i )
-          : page( p ), width( w ), height( h ), img( i ) { }
+        CacheItem( int p, ddjvu_page_t *dp )
+          : page( p ), djvupage( dp ), width( 0 ), height( 0 ), users( 0 )
+        {
+            // DjVuLibre doesn't tell the memory of a decoded page: its masks,
+            // shapes and background wavelets take about half a byte per pixel
+            bytes = qMax( (qulonglong)ddjvu_page_get_width( dp ) * ddjvu_page_get_height( dp ) / 2, (qulonglong)1 );
+        }
+
+        CacheItem( int p, int w, int h, const QImage& i )
+          : page( p ), djvupage( nullptr ), width( w ), height( h ), img( i ),
+            bytes( (qulonglong)i.bytesPerLine() * i.height() ), users( 0 ) { }
+
+        ~CacheItem()
+        {
+            if ( djvupage )
+                ddjvu_page_release( djvupage );
+        }
 
         int page;
+        ddjvu_page_t *djvupage;
         int width;
         int height;
         QImage img;
+        qulonglong bytes;
+        // the renders using djvupage, that can't be released meanwhile
+        int users;
 };
 
 
@@ -430,12 +462,28 @@ class KDjVu::Private
     public:
         Private()
           : m_djvu_cxt( nullptr ), m_djvu_document( nullptr ), m_format( nullptr ), m_docBookmarks( nullptr ),
-            m_cacheEnabled( true )
+            m_cacheBytes( 0 ), m_cacheBudget( defaultCacheBudget ), m_cacheEnabled( true )
         {
         }
 
-        QImage generateImageTile( ddjvu_page_t *djvupage, int& res,
-            int width, int row, int xdelta, int height, int col, int ydelta );
+        // the decoded 'page', decoding it if not cached; it stays in the cache
+        // at least until given back with releasePage()
+        CacheItem *acquirePage( int page );
+        void releasePage( CacheItem *item );
+
+        // caches an image of 'page', rendered at the given size
+        void insertImage( int page, int width, int height, const QImage &image );
+
+        // drops the least recently used entries not in use until the cache
+        // takes at most 'maximumBytes', returns the freed bytes; the cache
+        // mutex must be locked
+        qulonglong shrinkCache( qulonglong maximumBytes );
+
+        // drops all the entries, or only the images if 'imagesOnly'
+        void clearCache( bool imagesOnly );
+
+        // renders the 'rect' part of the page, rendered whole at width x height
+        QImage renderImage( ddjvu_page_t *djvupage, int& res, int width, int height, const QRect &rect );
 
         void readBookmarks();
         void fillBookmarksRecurse( QDomDocument& maindoc, QDomNode& curnode,
@@ -450,9 +498,16 @@ class KDjVu::Private
         ddjvu_format_t *m_format;
 
         QVector<KDjVu::Page*> m_pages;
-        QVector<ddjvu_page_t *> m_pages_cache;
 
-        QList<ImageCacheItem*> mImgCache;
+        // decoded pages and rendered images, most recently used first
+        QList<CacheItem*> m_cache;
+        qulonglong m_cacheBytes;
+        qulonglong m_cacheBudget;
+        // the cache can be shrunk from another thread than the rendering one
+        QMutex m_cacheMutex;
+
+        // renders the parts of big images
+        QThreadPool m_renderPool;
 
         QHash<QString, QVariant> m_metaData;
         QDomDocument * m_docBookmarks;
@@ -466,19 +521,70 @@ class KDjVu::Private
 
 unsigned int KDjVu::Private::s_formatmask[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
 
-QImage KDjVu::Private::generateImageTile( ddjvu_page_t *djvupage, int& res,
-    int width, int row, int xdelta, int height, int col, int ydelta )
+// renders 'part' of the page, as big as 'pagerect' when rendered whole, in
+// the 'bits' of an image whose rows are 'bytesPerLine' long and whose top
+// left corner is at 'origin' in the page; returns whether it succeeded
+static int renderPart( ddjvu_page_t *djvupage, ddjvu_format_t *format, const ddjvu_rect_t &pagerect,
+    const QRect &part, uchar *bits, int bytesPerLine, const QPoint &origin )
 {
     ddjvu_rect_t renderrect;
-    renderrect.x = row * xdelta;
-    renderrect.y = col * ydelta;
-    int realwidth = qMin( width - renderrect.x, xdelta );
-    int realheight = qMin( height - renderrect.y, ydelta );
-    renderrect.w = realwidth;
-    renderrect.h = realheight;
+    renderrect.x = part.x();
+    renderrect.y = part.y();
+    renderrect.w = part.width();
+    renderrect.h = part.height();
 #ifdef KDJVU_DEBUG
     qDebug() << "renderrect:" << renderrect;
 #endif
+    uchar *partBits = bits + ( part.y() - origin.y() ) * bytesPerLine + ( part.x() - origin.x() ) * 4;
+    const int res = ddjvu_page_render( djvupage, DDJVU_RENDER_COLOR,
+                  &pagerect, &renderrect, format, bytesPerLine, (char *)partBits );
+    if ( !res )
+    {
+        // white, without a QPainter as other parts may be rendering in the same image
+        for ( int y = 0; y < part.height(); ++y )
+            memset( partBits + y * bytesPerLine, 0xff, part.width() * 4 );
+    }
+#ifdef KDJVU_DEBUG
+    qDebug() << "rendering result:" << res;
+#endif
+    return res;
+}
+
+/**
+ * Renders a part of a page on a thread of the pool of KDjVu.
+ */
+class PartRenderer : public QRunnable
+{
+    public:
+        PartRenderer( ddjvu_page_t *djvupage, ddjvu_format_t *format, const ddjvu_rect_t &pagerect,
+            const QRect &part, uchar *bits, int bytesPerLine, const QPoint &origin, int *res )
+          : m_djvupage( djvupage ), m_format( format ), m_pagerect( pagerect ), m_part( part ),
+            m_bits( bits ), m_bytesPerLine( bytesPerLine ), m_origin( origin ), m_res( res )
+        {
+        }
+
+        void run() override
+        {
+            *m_res = renderPart( m_djvupage, m_format, m_pagerect, m_part, m_bits, m_bytesPerLine, m_origin );
+        }
+
+    private:
+        ddjvu_page_t *m_djvupage;
+        ddjvu_format_t *m_format;
+        ddjvu_rect_t m_pagerect;
+        QRect m_part;
+        uchar *m_bits;
+        int m_bytesPerLine;
+        QPoint m_origin;
+        int *m_res;
+};
+
+QImage KDjVu::Private::renderImage( ddjvu_page_t *djvupage, int& res, int width, int height, const QRect &rect )
+{
+    // big renders are done in parts, in parallel
+    static const int xdelta = 1500;
+    static const int ydelta = 1500;
+
     ddjvu_rect_t pagerect;
     pagerect.x = 0;
     pagerect.y = 0;
@@ -488,24 +594,153 @@ QImage KDjVu::Private::generateImageTile( ddjvu_page_t *djvupage, int& res,
     qDebug() << "pagerect:" << pagerect;
 #endif
     handle_ddjvu_messages( m_djvu_cxt, false );
-    QImage res_img( realwidth, realheight, QImage::Format_RGB32 );
     // the following line workarounds a rare crash in djvulibre;
     // it should be fixed with >= 3.5.21
     ddjvu_page_get_width( djvupage );
-    res = ddjvu_page_render( djvupage, DDJVU_RENDER_COLOR,
-                  &pagerect, &renderrect, m_format, res_img.bytesPerLine(), (char *)res_img.bits() );
-    if (!res)
+
+    QImage res_img( rect.size(), QImage::Format_RGB32 );
+    // the parts write straight into the image, get its bits only once
+    uchar *bits = res_img.bits();
+    const int bytesPerLine = res_img.bytesPerLine();
+
+    const int xparts = ( rect.width() + xdelta - 1 ) / xdelta;
+    const int yparts = ( rect.height() + ydelta - 1 ) / ydelta;
+    if ( xparts * yparts <= 1 )
     {
-        res_img.fill(Qt::white);
+        res = renderPart( djvupage, m_format, pagerect, rect, bits, bytesPerLine, rect.topLeft() );
+    }
+    else
+    {
+        QVector<int> results( xparts * yparts );
+        for ( int i = 0; i < results.count(); ++i )
+        {
+            const QRect part = QRect( rect.x() + ( i % xparts ) * xdelta, rect.y() + ( i / xparts ) * ydelta, xdelta, ydelta ).intersected( rect );
+            m_renderPool.start( new PartRenderer( djvupage, m_format, pagerect, part, bits, bytesPerLine, rect.topLeft(), &results[i] ) );
+        }
+        m_renderPool.waitForDone();
+        res = *std::min_element( results.constBegin(), results.constEnd() );
     }
-#ifdef KDJVU_DEBUG
-    qDebug() << "rendering result:" << res;
-#endif
     handle_ddjvu_messages( m_djvu_cxt, false );
 
     return res_img;
 }
 
+CacheItem *KDjVu::Private::acquirePage( int page )
+{
+    QMutexLocker locker( &m_cacheMutex );
+    for ( int i = 0; i < m_cache.count(); ++i )
+    {
+        CacheItem *cur = m_cache.at( i );
+        if ( cur->djvupage && cur->page == page )
+        {
+            m_cache.move( i, 0 );
+            ++cur->users;
+            return cur;
+        }
+    }
+    // decoding takes a while, don't hold the lock meanwhile
+    locker.unlock();
+
+    ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( m_djvu_document, page );
+    // wait for the new page to be loaded
+    ddjvu_status_t sts;
+    while ( ( sts = ddjvu_page_decoding_status( newpage ) ) < DDJVU_JOB_OK )
+        handle_ddjvu_messages( m_djvu_cxt, true );
+
+    locker.relock();
+    // another thread may have decoded the same page meanwhile
+    for ( int i = 0; i < m_cache.count(); ++i )
+    {
+        CacheItem *cur = m_cache.at( i );
+        if ( cur->djvupage && cur->page == page )
+        {
+            ddjvu_page_release( newpage );
+            m_cache.move( i, 0 );
+            ++cur->users;
+            return cur;
+        }
+    }
+
+    CacheItem *item = new CacheItem( page, newpage );
+    item->users = 1;
+    m_cache.prepend( item );
+    m_cacheBytes += item->bytes;
+    shrinkCache( m_cacheBudget );
+    return item;
+}
+
+void KDjVu::Private::releasePage( CacheItem *item )
+{
+    QMutexLocker locker( &m_cacheMutex );
+    --item->users;
+    shrinkCache( m_cacheBudget );
+}
+
+void KDjVu::Private::insertImage( int page, int width, int height, const QImage &image )
+{
+    QMutexLocker locker( &m_cacheMutex );
+
+    // delete all the cached pixmaps for the current page with a size that
+    // differs no more than 35% of the new pixmap size
+    int imgsize = image.width() * image.height();
+    if ( imgsize > 0 )
+    {
+        for( int i = 0; i < m_cache.count(); )
+        {
+            CacheItem* cur = m_cache.at(i);
+            if ( !cur->djvupage && ( cur->page == page ) &&
+                 ( abs( cur->img.width() * cur->img.height() - imgsize ) < imgsize * 0.35 ) )
+            {
+                m_cache.removeAt( i );
+                m_cacheBytes -= cur->bytes;
+                delete cur;
+            }
+            else
+                ++i;
+        }
+    }
+
+    CacheItem* ich = new CacheItem( page, width, height, image );
+    m_cache.prepend( ich );
+    m_cacheBytes += ich->bytes;
+    shrinkCache( m_cacheBudget );
+}
+
+qulonglong KDjVu::Private::shrinkCache( qulonglong maximumBytes )
+{
+    qulonglong freed = 0;
+    for ( int i = m_cache.count() - 1; i >= 0 && m_cacheBytes > maximumBytes; --i )
+    {
+        CacheItem *cur = m_cache.at( i );
+        if ( cur->users > 0 )
+            continue;
+
+        m_cache.removeAt( i );
+        m_cacheBytes -= cur->bytes;
+        freed += cur->bytes;
+        delete cur;
+    }
+    return freed;
+}
+
+void KDjVu::Private::clearCache( bool imagesOnly )
+{
+    QMutexLocker locker( &m_cacheMutex );
+    for ( int i = 0; i < m_cache.count(); )
+    {
+        CacheItem *cur = m_cache.at( i );
+        if ( imagesOnly && cur->djvupage )
+        {
+            ++i;
+            continue;
+        }
+
+        m_cache.removeAt( i );
+        m_cacheBytes -= cur->bytes;
+        delete cur;
+    }
+}
+
 void KDjVu::Private::readBookmarks()
 {
     if ( !m_djvu_document )
@@ -686,8 +921,6 @@ bool KDjVu::openFile( const QString & fileName )
     int numofpages = ddjvu_document_get_pagenum( d->m_djvu_document );
     d->m_pages.clear();
     d->m_pages.resize( numofpages );
-    d->m_pages_cache.clear();
-    d->m_pages_cache.resize( numofpages );
 
     // get the document type
     QString doctype;
@@ -757,14 +990,8 @@ void KDjVu::closeFile()
     // deleting the pages
     qDeleteAll( d->m_pages );
     d->m_pages.clear();
-    // releasing the djvu pages
-    QVector<ddjvu_page_t *>::Iterator it = d->m_pages_cache.begin(), itEnd = d->m_pages_cache.end();
-    for ( ; it != itEnd; ++it )
-        ddjvu_page_release( *it );
-    d->m_pages_cache.clear();
-    // clearing the image cache
-    qDeleteAll( d->mImgCache );
-    d->mImgCache.clear();
+    // releasing the djvu pages and clearing the image cache
+    d->clearCache( false );
     // clearing the old metadata
     d->m_metaData.clear();
     // cleaning the page names mapping
@@ -913,39 +1140,24 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
 {
     if ( d->m_cacheEnabled )
     {
-        bool found = false;
-        QList<ImageCacheItem*>::Iterator it = d->mImgCache.begin(), itEnd = d->mImgCache.end();
-        for ( ; ( it != itEnd ) && !found; ++it )
+        QMutexLocker locker( &d->m_cacheMutex );
+        for ( int i = 0; i < d->m_cache.count(); ++i )
         {
-            ImageCacheItem* cur = *it;
-            if ( ( cur->page == page ) &&
+            CacheItem* cur = d->m_cache.at( i );
+            if ( !cur->djvupage && ( cur->page == page ) &&
                 ( rotation % 2 == 0
                 ? cur->width == width && cur->height == height
                 : cur->width == height && cur->height == width ) )
-                found = true;
-        }
-        if ( found )
-        {
-            // taking the element and pushing to the top of the list
-            --it;
-            ImageCacheItem* cur2 = *it;
-            d->mImgCache.erase( it );
-            d->mImgCache.push_front( cur2 );
-
-            return cur2->img;
+            {
+                // pushing the element to the top of the list
+                d->m_cache.move( i, 0 );
+                return cur->img;
+            }
         }
     }
 
-    if ( !d->m_pages_cache.at( page ) )
-    {
-        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( d->m_djvu_document, page );
-        // wait for the new page to be loaded
-        ddjvu_status_t sts;
-        while ( ( sts = ddjvu_page_decoding_status( newpage ) ) < DDJVU_JOB_OK )
-            handle_ddjvu_messages( d->m_djvu_cxt, true );
-        d->m_pages_cache[page] = newpage;
-    }
-    ddjvu_page_t *djvupage = d->m_pages_cache[page];
+    CacheItem *pageItem = d->acquirePage( page );
+    ddjvu_page_t *djvupage = pageItem->djvupage;
 
 /*
     if ( ddjvu_page_get_rotation( djvupage ) != flipRotation( rotation ) )
@@ -956,79 +1168,28 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
     }
 */
 
-    static const int xdelta = 1500;
-    static const int ydelta = 1500;
-
-    int xparts = width / xdelta + 1;
-    int yparts = height / ydelta + 1;
-
-    QImage newimg;
+    int res = 0;
+    QImage newimg = d->renderImage( djvupage, res, width, height, QRect( 0, 0, width, height ) );
 
-    int res = 10000;
-    if ( ( xparts == 1 ) && ( yparts == 1 ) )
-    {
-         // only one part -- render at once with no need to auxiliary image
-         newimg = d->generateImageTile( djvupage, res,
-                 width, 0, xdelta, height, 0, ydelta );
-    }
-    else
-    {
-        // more than one part -- need to render piece-by-piece and to compose
-        // the results
-        newimg = QImage( width, height, QImage::Format_RGB32 );
-        QPainter p;
-        p.begin( &newimg );
-        int parts = xparts * yparts;
-        for ( int i = 0; i < parts; ++i )
-        {
-            int row = i % xparts;
-            int col = i / xparts;
-            int tmpres = 0;
-            QImage tempp = d->generateImageTile( djvupage, tmpres,
-                    width, row, xdelta, height, col, ydelta );
-            if ( tmpres )
-            {
-                p.drawImage( row * xdelta, col * ydelta, tempp );
-            }
-            res = qMin( tmpres, res );
-        }
-        p.end();
-    }
+    d->releasePage( pageItem );
 
     if ( res && d->m_cacheEnabled )
-    {
-        // delete all the cached pixmaps for the current page with a size that
-        // differs no more than 35% of the new pixmap size
-        int imgsize = newimg.width() * newimg.height();
-        if ( imgsize > 0 )
-        {
-            for( int i = 0; i < d->mImgCache.count(); )
-            {
-                ImageCacheItem* cur = d->mImgCache.at(i);
-                if ( ( cur->page == page ) &&
-                     ( abs( cur->img.width() * cur->img.height() - imgsize ) < imgsize * 0.35 ) )
-                {
-                    d->mImgCache.removeAt( i );
-                    delete cur;
-                }
-                else
-                    ++i;
-            }
-        }
-
-        // the image cache has too many elements, remove the last
-        if ( d->mImgCache.size() >= 10 )
-        {
-            delete d->mImgCache.last();
-            d->mImgCache.removeLast();
-        }
-        ImageCacheItem* ich = new ImageCacheItem( page, width, height, newimg );
-        d->mImgCache.push_front( ich );
-    }
+        d->insertImage( page, width, height, newimg );
 
     return newimg;
 }
 
+QImage KDjVu::image( int page, int width, int height, int rotation, const QRect &rect )
+{
+    Q_UNUSED( rotation );
+
+    CacheItem *pageItem = d->acquirePage( page );
+    int res = 0;
+    const QImage img = d->renderImage( pageItem->djvupage, res, width, height, rect.intersected( QRect( 0, 0, width, height ) ) );
+    d->releasePage( pageItem );
+    return img;
+}
+
 bool KDjVu::exportAsPostScript( const QString & fileName, const QList<int>& pageList ) const
 {
     if ( !d->m_djvu_document || fileName.trimmed().isEmpty() || pageList.isEmpty() )
@@ -1142,10 +1303,7 @@ void KDjVu::setCacheEnabled( bool enable )
 
     d->m_cacheEnabled = enable;
     if ( !d->m_cacheEnabled )
-    {
-        qDeleteAll( d->mImgCache );
-        d->mImgCache.clear();
-    }
+        d->clearCache( true );
 }
 
 bool KDjVu::isCacheEnabled() const
@@ -1153,6 +1311,24 @@ bool KDjVu::isCacheEnabled() const
     return d->m_cacheEnabled;
 }
 
+void KDjVu::setCacheBudget( qulonglong bytes )
+{
+    QMutexLocker locker( &d->m_cacheMutex );
+    d->m_cacheBudget = bytes;
+    d->shrinkCache( d->m_cacheBudget );
+}
+
+qulonglong KDjVu::cacheBudget() const
+{
+    return d->m_cacheBudget;
+}
+
+qulonglong KDjVu::freeCache( qulonglong bytes )
+{
+    QMutexLocker locker( &d->m_cacheMutex );
+    return d->shrinkCache( d->m_cacheBytes > bytes ? d->m_cacheBytes - bytes : 0 );
+}
+
 int KDjVu::pageNumber( const QString & name ) const
 {
     if ( !d->m_djvu_document )
@@ -260,6 +260,13 @@ class KDjVu
          */
         QImage image( int page, int width, int height, int rotation );
 
+        /**
+         * Render the \p rect part of the specified \p page, as if rendered
+         * whole with the specified \p width, \p height and \p rotation.
+         * The parts are not cached.
+         */
+        QImage image( int page, int width, int height, int rotation, const QRect &rect );
+
         /**
          * Export the currently open document as PostScript file \p fileName.
          * \returns whether the exporting was successful
@@ -287,6 +294,25 @@ class KDjVu
          */
         bool isCacheEnabled() const;
 
+        /**
+         * Set the most memory, in bytes, that the decoded pages and the
+         * rendered pages in cache can take; the least recently used ones
+         * are dropped when going over it.
+         */
+        void setCacheBudget( qulonglong bytes );
+        /**
+         * \returns the memory budget of the cache
+         */
+        qulonglong cacheBudget() const;
+
+        /**
+         * Drop the least recently used entries of the cache that are not
+         * being rendered until \p bytes are freed, or nothing else can be.
+         * It can be called from any thread.
+         * \returns the freed bytes
+         */
+        qulonglong freeCache( qulonglong bytes );
+
         /**
          * Return the page number of the page whose title is \p name.
          */
@@ -18,15 +18,18 @@
 
 #include <KLocalizedString>
 #include <kprocess.h>
-#include <qtemporaryfile.h>
 #include <QUrl>
 
 #include <QLoggingCategory>
 #include <QDir>
 #include <QPainter>
 #include <QPixmap>
+#include <QRunnable>
 #include <QTextStream>
 #include <QTimer>
+#include <QtEndian>
+
+#include <string.h>
 
 //#define DEBUG_PSGS
 
@@ -50,15 +53,22 @@ pageInfo::~pageInfo() {
 ghostscript_interface::ghostscript_interface() {
 
   PostScriptHeaderString = new QString();
+  renderedGeneration = 0;
 
   knownDevices.append(QStringLiteral("png16m"));
   knownDevices.append(QStringLiteral("jpeg"));
   knownDevices.append(QStringLiteral("pnn"));
   knownDevices.append(QStringLiteral("pnnraw"));
   gsDevice = knownDevices.begin();
+
+  // The cost is in KiB
+  renderedPages.setMaxCost(128 * 1024);
+  // One ghostscript process at a time in the background
+  prerenderPool.setMaxThreadCount(1);
 }
 
 ghostscript_interface::~ghostscript_interface() {
+  stopPrerendering();
   if (PostScriptHeaderString != nullptr)
     delete PostScriptHeaderString;
   qDeleteAll(pageList);
@@ -76,8 +86,20 @@ void ghostscript_interface::setPostScript(const PageNumber& page, const QString&
     if (pageList.count() > pageList.capacity() -2)
       pageList.reserve(pageList.capacity()*2);
     pageList.insert(page, info);
-  } else
+  } else {
     *(pageList.value(page)->PostScriptString) = PostScript;
+
+    // What was rendered of the page is outdated, and so is what is
+    // being rendered from the old PostScript
+    QMutexLocker locker(&renderedPagesMutex);
+    renderedGeneration++;
+    const QString prefix = QStringLiteral("%1 ").arg(page);
+    const QStringList keys = renderedPages.keys();
+    for (const QString &key : keys) {
+      if (key.startsWith(prefix))
+        renderedPages.remove(key);
+    }
+  }
 }
 
 
@@ -138,6 +160,8 @@ QColor ghostscript_interface::getBackgroundColor(const PageNumber& page) const {
 
 
 void ghostscript_interface::clear() {
+  stopPrerendering();
+
   PostScriptHeaderString->truncate(0);
 
   // Deletes all items, removes temporary files, etc.
@@ -146,150 +170,281 @@ void ghostscript_interface::clear() {
 }
 
 
-void ghostscript_interface::gs_generate_graphics_file(const PageNumber& page, const QString& filename, long magnification) {
+// Splits the output of ghostscript, the images of all the pages one
+// after the other, into the PNG images of the pages.
+static QList<QByteArray> splitPNGImages(const QByteArray &data) {
+  static const char signature[] = "\x89PNG\r\n\x1a\n";
+  QList<QByteArray> images;
+
+  qint64 start = 0;
+  while (start + 8 <= data.size() && memcmp(data.constData() + start, signature, 8) == 0) {
+    // Each chunk is its length, its type, its data and a CRC
+    qint64 pos = start + 8;
+    bool lastChunk = false;
+    while (!lastChunk && pos + 12 <= data.size()) {
+      const quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(data.constData() + pos));
+      lastChunk = (memcmp(data.constData() + pos + 4, "IEND", 4) == 0);
+      pos += 12 + qint64(length);
+    }
+    if (!lastChunk || pos > data.size())
+      break;
+
+    images.append(data.mid(start, pos - start));
+    start = pos;
+  }
+  return images;
+}
+
+
+class psPrerenderer : public QRunnable
+{
+public:
+  psPrerenderer(ghostscript_interface *_gs, const psRenderBatch &_batch)
+    : gs(_gs), batch(_batch) {}
+
+  void run() override {
+    const QList<QImage> images = gs->gs_render_pages(batch);
+
+    QMutexLocker locker(&gs->renderedPagesMutex);
+    const bool outdated = (batch.generation != gs->renderedGeneration);
+    for (int i = 0; i < batch.keys.count(); i++) {
+      const QImage image = images.value(i);
+      if (!image.isNull() && !outdated)
+        gs->renderedPages.insert(batch.keys[i], new QImage(image), qMax(1, image.bytesPerLine() * image.height() / 1024));
+      gs->prerenderingPages.remove(batch.keys[i]);
+    }
+    gs->pagePrerendered.wakeAll();
+  }
+
+private:
+  ghostscript_interface *gs;
+  const psRenderBatch batch;
+};
+
+
+QList<QImage> ghostscript_interface::gs_render_pages(const psRenderBatch& batch) {
 #ifdef DEBUG_PSGS
-  qCDebug(OkularDviDebug) << "ghostscript_interface::gs_generate_graphics_file( " << page << ", " << filename << " )";
+  qCDebug(OkularDviDebug) << "ghostscript_interface::gs_render_pages( " << batch.keys << " )";
 #endif
 
-  if (knownDevices.isEmpty()) {
-    qCCritical(OkularDviDebug) << "No known devices found" << endl;
-    return;
+  QString device;
+  {
+    QMutexLocker locker(&gsDeviceMutex);
+    if (knownDevices.isEmpty()) {
+      qCCritical(OkularDviDebug) << "No known devices found" << endl;
+      return QList<QImage>();
+    }
+    device = *gsDevice;
   }
 
-  pageInfo *info = pageList.value(page);
-
-  // Generate a PNG-file
-  // Step 1: Write the PostScriptString to a File
-  QTemporaryFile PSfile(QDir::tempPath() + QLatin1String("/okular_XXXXXX.ps"));
-  PSfile.setAutoRemove(false);
-  PSfile.open();
-  const QString PSfileName = PSfile.fileName();
+  // Only the PNG images can be told apart when ghostscript writes
+  // several of them one after the other, render the pages one by one
+  // with the other devices.
+  if (batch.keys.count() > 1 && device != QLatin1String("png16m")) {
+    QList<QImage> images;
+    for (int i = 0; i < batch.keys.count(); i++) {
+      psRenderBatch single = batch;
+      single.keys = QStringList(batch.keys[i]);
+      single.PostScript = QStringList(batch.PostScript[i]);
+      single.backgrounds = QList<QColor>() << batch.backgrounds[i];
+      images.append(gs_render_pages(single).value(0));
+    }
+    return images;
+  }
 
-  QTextStream os(&PSfile);
+  // Step 1: Write the PostScript of all the pages in a single document
+  QByteArray PostScript;
+  QTextStream os(&PostScript);
   os << "%!PS-Adobe-2.0\n"
      << "%%Creator: kdvi\n"
      << "%%Title: KDVI temporary PostScript\n"
-     << "%%Pages: 1\n"
+     << "%%Pages: " << batch.keys.count() << '\n'
      << "%%PageOrder: Ascend\n"
         // HSize and VSize in 1/72 inch
      << "%%BoundingBox: 0 0 "
-     << (qint32)(72*(pixel_page_w/resolution)) << ' '
-     << (qint32)(72*(pixel_page_h/resolution)) << '\n'
+     << (qint32)(72*(batch.pixel_page_w/batch.resolution)) << ' '
+     << (qint32)(72*(batch.pixel_page_h/batch.resolution)) << '\n'
      << "%%EndComments\n"
      << "%!\n"
      << psheader
      << "TeXDict begin "
         // HSize in (1/(65781.76*72))inch
-     << (qint32)(72*65781*(pixel_page_w/resolution)) << ' '
+     << (qint32)(72*65781*(batch.pixel_page_w/batch.resolution)) << ' '
         // VSize in (1/(65781.76*72))inch
-     << (qint32)(72*65781*(pixel_page_h/resolution)) << ' '
+     << (qint32)(72*65781*(batch.pixel_page_h/batch.resolution)) << ' '
         // Magnification
-     << (qint32)(magnification)
+     << (qint32)(batch.magnification)
         // dpi and vdpi
      << " 300 300"
         // Name
      << " (test.dvi)"
-     << " @start end\n"
-     << "TeXDict begin\n"
-        // Start page
-     << "1 0 bop 0 0 a \n";
-
-  if (!PostScriptHeaderString->toLatin1().isNull())
-    os << PostScriptHeaderString->toLatin1();
-
-  if (info->background != Qt::white) {
-    QString colorCommand = QStringLiteral("gsave %1 %2 %3 setrgbcolor clippath fill grestore\n").
-      arg(info->background.red()/255.0).
-      arg(info->background.green()/255.0).
-      arg(info->background.blue()/255.0);
-    os << colorCommand.toLatin1();
-  }
-
-  if (!info->PostScriptString->isNull())
-    os << *(info->PostScriptString);
+     << " @start end\n";
+
+  for (int i = 0; i < batch.keys.count(); i++) {
+    // Each page starts from the same state, whatever the previous one did
+    os << "/okularpagesave save def\n"
+       << "TeXDict begin\n"
+          // Start page
+       << "1 0 bop 0 0 a \n";
+
+    if (!batch.header.toLatin1().isNull())
+      os << batch.header.toLatin1();
+
+    const QColor &background = batch.backgrounds[i];
+    if (background != Qt::white) {
+      QString colorCommand = QStringLiteral("gsave %1 %2 %3 setrgbcolor clippath fill grestore\n").
+        arg(background.red()/255.0).
+        arg(background.green()/255.0).
+        arg(background.blue()/255.0);
+      os << colorCommand.toLatin1();
+    }
 
-  os << "end\n"
-     << "showpage \n";
+    if (!batch.PostScript[i].isNull())
+      os << batch.PostScript[i];
 
-  PSfile.close();
+    os << "end\n"
+       << "showpage \n"
+       << "okularpagesave restore\n";
+  }
+  os.flush();
 
-  // Step 2: Call GS with the File
-  QFile::remove(filename);
+  // Step 2: Call GS with the document on its standard input, and read
+  // the images from its standard output
   KProcess proc;
   proc.setOutputChannelMode(KProcess::SeparateChannels);
   QStringList argus;
   argus << QStringLiteral("gs");
   argus << QStringLiteral("-dSAFER") << QStringLiteral("-dPARANOIDSAFER") << QStringLiteral("-dDELAYSAFER") << QStringLiteral("-dNOPAUSE") << QStringLiteral("-dBATCH");
-  argus << QStringLiteral("-sDEVICE=%1").arg(*gsDevice);
-  argus << QStringLiteral("-sOutputFile=%1").arg(filename);
-  argus << QStringLiteral("-sExtraIncludePath=%1").arg(includePath);
-  argus << QStringLiteral("-g%1x%2").arg(pixel_page_w).arg(pixel_page_h); // page size in pixels
-  argus << QStringLiteral("-r%1").arg(resolution);                       // resolution in dpi
+  // Only the images go to the standard output
+  argus << QStringLiteral("-q") << QStringLiteral("-sstdout=%stderr");
+  argus << QStringLiteral("-sDEVICE=%1").arg(device);
+  argus << QStringLiteral("-sOutputFile=-");
+  argus << QStringLiteral("-sExtraIncludePath=%1").arg(batch.includePath);
+  argus << QStringLiteral("-g%1x%2").arg(batch.pixel_page_w).arg(batch.pixel_page_h); // page size in pixels
+  argus << QStringLiteral("-r%1").arg(batch.resolution);                             // resolution in dpi
   argus << QStringLiteral("-dTextAlphaBits=4 -dGraphicsAlphaBits=2"); // Antialiasing
   argus << QStringLiteral("-c") << QStringLiteral("<< /PermitFileReading [ ExtraIncludePath ] /PermitFileWriting [] /PermitFileControl [] >> setuserparams .locksafe");
-  argus << QStringLiteral("-f") << PSfileName;
+  argus << QStringLiteral("-f") << QStringLiteral("-");
 
 #ifdef DEBUG_PSGS
   qCDebug(OkularDviDebug) << argus.join(" ");
 #endif
- 
+
   proc << argus;
-  int res = proc.execute();
-  
-  if ( res ) {
-    // Starting ghostscript did not work. 
+  proc.start();
+  if (!proc.waitForStarted()) {
+    // Starting ghostscript did not work.
     // TODO: Issue error message, switch PS support off.
     qCCritical(OkularDviDebug) << "ghostview could not be started" << endl;
-  } 
-
-  PSfile.remove();
+    return QList<QImage>();
+  }
+  proc.write(PostScript);
+  proc.closeWriteChannel();
+  proc.waitForFinished(-1);
+
+  const QByteArray output = proc.readAllStandardOutput();
+  QList<QImage> images;
+  if (device == QLatin1String("png16m")) {
+    const QList<QByteArray> pngImages = splitPNGImages(output);
+    for (const QByteArray &pngImage : pngImages)
+      images.append(QImage::fromData(pngImage, "PNG"));
+  } else if (!output.isEmpty()) {
+    images.append(QImage::fromData(output));
+  }
 
- // Check if gs has indeed produced a file.
-  if (QFile::exists(filename) == false) {
+  // Check if gs has indeed produced the images.
+  if (images.isEmpty()) {
     qCCritical(OkularDviDebug) << "GS did not produce output." << endl;
 
     // No. Check is the reason is that the device is not compiled into
     // ghostscript. If so, try again with another device.
-    QString GSoutput;
-    proc.setReadChannel(QProcess::StandardOutput);
-    while(proc.canReadLine()) {
-      GSoutput = QString::fromLocal8Bit(proc.readLine());
-      if (GSoutput.contains(QStringLiteral("Unknown device"))) {
-    qCDebug(OkularDviDebug) << QString::fromLatin1("The version of ghostview installed on this computer does not support "
-                                     "the '%1' ghostview device driver.").arg(*gsDevice) << endl;
-	knownDevices.erase(gsDevice);
-	gsDevice = knownDevices.begin();
-	if (knownDevices.isEmpty())
-	  // TODO: show a requestor of some sort.
-	  emit error(i18n("The version of Ghostview that is installed on this computer does not contain "
-			  "any of the Ghostview device drivers that are known to Okular. PostScript "
-			  "support has therefore been turned off in Okular."), -1);
-#if 0
-				     i18n("<qt><p>The Ghostview program, which Okular uses internally to display the "
-					  "PostScript graphics that is included in this DVI file, is generally able to "
-					  "write its output in a variety of formats. The sub-programs that Ghostview uses "
-					  "for these tasks are called 'device drivers'; there is one device driver for "
-					  "each format that Ghostview is able to write. Different versions of Ghostview "
-					  "often have different sets of device drivers available. It seems that the "
-					  "version of Ghostview that is installed on this computer does not contain "
-					  "<strong>any</strong> of the device drivers that are known to Okular.</p>"
-					  "<p>It seems unlikely that a regular installation of Ghostview would not contain "
-					  "these drivers. This error may therefore point to a serious misconfiguration of "
-					  "the Ghostview installation on your computer.</p>"
-					  "<p>If you want to fix the problems with Ghostview, you can use the command "
-					  "<strong>gs --help</strong> to display the list of device drivers contained in "
-					  "Ghostview. Among others, Okular can use the 'png256', 'jpeg' and 'pnm' "
-					  "drivers. Note that Okular needs to be restarted to re-enable PostScript support."
-					  "</p></qt>"));
-#endif
-	else {
-      qCDebug(OkularDviDebug) << QStringLiteral("Okular will now try to use the '%1' device driver.").arg(*gsDevice);
-	  gs_generate_graphics_file(page, filename, magnification);
-	}
-	return;
+    const QString GSoutput = QString::fromLocal8Bit(proc.readAllStandardError());
+    if (GSoutput.contains(QStringLiteral("Unknown device"))) {
+      QMutexLocker locker(&gsDeviceMutex);
+      // Another thread may have given up on this device already
+      if (!knownDevices.isEmpty() && *gsDevice == device) {
+        qCDebug(OkularDviDebug) << QString::fromLatin1("The version of ghostview installed on this computer does not support "
+                                                        "the '%1' ghostview device driver.").arg(device) << endl;
+        knownDevices.erase(gsDevice);
+        gsDevice = knownDevices.begin();
+        if (knownDevices.isEmpty()) {
+          // TODO: show a requestor of some sort.
+          emit error(i18n("The version of Ghostview that is installed on this computer does not contain "
+                          "any of the Ghostview device drivers that are known to Okular. PostScript "
+                          "support has therefore been turned off in Okular."), -1);
+          return images;
+        }
+        qCDebug(OkularDviDebug) << QStringLiteral("Okular will now try to use the '%1' device driver.").arg(*gsDevice);
       }
+      locker.unlock();
+      return gs_render_pages(batch);
     }
   }
+  return images;
+}
+
+
+bool ghostscript_interface::addToBatch(psRenderBatch& batch, const PageNumber& page) const {
+  pageInfo *info = pageList.value(page);
+  if ((info == nullptr) || (info->PostScriptString->isEmpty()))
+    return false;
+
+  // The background is drawn by ghostscript, so it is part of the key
+  batch.keys.append(QStringLiteral("%1 %2 %3 %4x%5 %6").arg(page).arg(batch.resolution).arg(batch.magnification).
+                    arg(batch.pixel_page_w).arg(batch.pixel_page_h).arg(info->background.name()));
+  batch.PostScript.append(*(info->PostScriptString));
+  batch.backgrounds.append(info->background);
+  return true;
+}
+
+
+void ghostscript_interface::prerender(const PageNumber& page, double dpi, long magnification, int pixel_page_w, int pixel_page_h) {
+  // How many of the following pages get ready, and how far to look for them
+  const int prerenderedPages = 3;
+  const int prerenderedPagesRange = 10;
+
+  psRenderBatch batch;
+  // Read before the PostScript is copied, a change in between outdates the batch
+  renderedPagesMutex.lock();
+  batch.generation    = renderedGeneration;
+  renderedPagesMutex.unlock();
+  batch.header        = *PostScriptHeaderString;
+  batch.includePath   = includePath;
+  batch.resolution    = dpi;
+  batch.magnification = magnification;
+  batch.pixel_page_w  = pixel_page_w;
+  batch.pixel_page_h  = pixel_page_h;
+
+  psRenderBatch candidates = batch;
+  for (int i = 1; i <= prerenderedPagesRange && candidates.keys.count() < prerenderedPages; i++)
+    addToBatch(candidates, PageNumber(page + i));
+
+  QMutexLocker locker(&renderedPagesMutex);
+  for (int i = 0; i < candidates.keys.count(); i++) {
+    const QString &key = candidates.keys[i];
+    if (renderedPages.contains(key) || prerenderingPages.contains(key))
+      continue;
+    batch.keys.append(key);
+    batch.PostScript.append(candidates.PostScript[i]);
+    batch.backgrounds.append(candidates.backgrounds[i]);
+    prerenderingPages.insert(key);
+  }
+  locker.unlock();
+
+  if (!batch.keys.isEmpty())
+    prerenderPool.start(new psPrerenderer(this, batch));
+}
+
+
+void ghostscript_interface::stopPrerendering() {
+  prerenderPool.clear();
+  prerenderPool.waitForDone();
+
+  QMutexLocker locker(&renderedPagesMutex);
+  prerenderingPages.clear();
+  renderedPages.clear();
+  // The batches dropped from the pool never wake up who waits for them
+  pagePrerendered.wakeAll();
 }
 
 
@@ -303,32 +458,50 @@ void ghostscript_interface::graphics(const PageNumber& page, double dpi, long ma
     return;
   }
 
-  resolution   = dpi;
-
-  pixel_page_w = paint->viewport().width();
-  pixel_page_h = paint->viewport().height();
-
-  pageInfo *info = pageList.value(page);
+  psRenderBatch batch;
+  // As in prerender(), the generation of the PostScript about to be copied
+  renderedPagesMutex.lock();
+  batch.generation    = renderedGeneration;
+  renderedPagesMutex.unlock();
+  batch.header        = *PostScriptHeaderString;
+  batch.includePath   = includePath;
+  batch.resolution    = dpi;
+  batch.magnification = magnification;
+  batch.pixel_page_w  = paint->viewport().width();
+  batch.pixel_page_h  = paint->viewport().height();
 
   // No PostScript? Then return immediately.
-  if ((info == nullptr) || (info->PostScriptString->isEmpty())) {
+  if (!addToBatch(batch, page)) {
 #ifdef DEBUG_PSGS
     qCDebug(OkularDviDebug) << "No PostScript found. Not drawing anything.";
 #endif
     return;
   }
 
-  QTemporaryFile gfxFile;
-  gfxFile.open();
-  const QString gfxFileName = gfxFile.fileName();
-  // We are want the filename, not the file.
-  gfxFile.close();
+  // Get the following pages ready while this one is drawn
+  prerender(page, dpi, magnification, batch.pixel_page_w, batch.pixel_page_h);
 
-  gs_generate_graphics_file(page, gfxFileName, magnification);
-  
-  QImage MemoryCopy(gfxFileName);
+  const QString &key = batch.keys.first();
+  QMutexLocker locker(&renderedPagesMutex);
+  // The page may be on its way already
+  while (prerenderingPages.contains(key))
+    pagePrerendered.wait(&renderedPagesMutex);
+
+  if (const QImage *cached = renderedPages.object(key)) {
+    paint->drawImage(0, 0, *cached);
+    return;
+  }
+  locker.unlock();
+
+  const QImage MemoryCopy = gs_render_pages(batch).value(0);
+  if (MemoryCopy.isNull())
+    return;
   paint->drawImage(0, 0, MemoryCopy);
-  return;
+
+  locker.relock();
+  if (batch.generation != renderedGeneration)
+    return;
+  renderedPages.insert(key, new QImage(MemoryCopy), qMax(1, MemoryCopy.bytesPerLine() * MemoryCopy.height() / 1024));
 }
 
 
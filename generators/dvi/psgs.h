@@ -11,10 +11,16 @@
 #define _PSGS_H_
 
 #include <QApplication>
+#include <QCache>
 #include <QColor>
 #include <QEvent>
 #include <QHash>
+#include <QImage>
+#include <QMutex>
 #include <QObject>
+#include <QSet>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 class QUrl;
 class PageNumber;
@@ -36,6 +42,29 @@ public:
 };
 
 
+// Everything ghostscript needs to render a few pages in one go,
+// copied so that the rendering can happen in another thread.
+class psRenderBatch
+{
+public:
+  psRenderBatch() : resolution(0), magnification(0), pixel_page_w(0), pixel_page_h(0), generation(0) {}
+
+  QString   header;
+  QString   includePath;
+  double    resolution;   // in dots per inch
+  long      magnification;
+  int       pixel_page_w; // in pixels
+  int       pixel_page_h; // in pixels
+  // renderedGeneration when the PostScript was copied
+  int       generation;
+
+  // key in the cache, PostScript and background color of each page
+  QStringList   keys;
+  QStringList   PostScript;
+  QList<QColor> backgrounds;
+};
+
+
 class ghostscript_interface  : public QObject
 {
  Q_OBJECT
@@ -82,21 +111,48 @@ public:
   static  QString locateEPSfile(const QString &filename, const QUrl &base);
 
 private:
-  void                  gs_generate_graphics_file(const PageNumber& page, const QString& filename, long magnification);
-  QHash<quint16,pageInfo*>   pageList;
+  // Renders all the pages of the batch with a single ghostscript
+  // process, whose output is read from a pipe. Returns one image per
+  // page, null for the pages that could not be rendered.
+  QList<QImage>         gs_render_pages(const psRenderBatch& batch);
+
+  // Adds the page to the batch, if it has PostScript
+  bool                  addToBatch(psRenderBatch& batch, const PageNumber& page) const;
 
-  double                resolution;   // in dots per inch
-  int                   pixel_page_w; // in pixels
-  int                   pixel_page_h; // in pixels
+  // Renders the next few pages with PostScript in the background, so
+  // that they are in the cache once they are scrolled to
+  void                  prerender(const PageNumber& page, double dpi, long magnification, int pixel_page_w, int pixel_page_h);
+
+  void                  stopPrerendering();
+
+  QHash<quint16,pageInfo*>   pageList;
 
   QString               includePath;
 
+  // The rendered PostScript of the pages, by page, resolution,
+  // magnification, size and background color. The cost is in KiB.
+  QCache<QString, QImage> renderedPages;
+  // The keys of the pages being rendered in the background
+  QSet<QString>         prerenderingPages;
+  // Changed with the PostScript of any page, the images of batches
+  // copied before are outdated and not cached
+  int                   renderedGeneration;
+  QMutex                renderedPagesMutex;
+  QWaitCondition        pagePrerendered;
+
+  // Runs the ghostscript processes for the pages rendered in the background
+  QThreadPool           prerenderPool;
+
+  // Guards gsDevice and knownDevices, ghostscript being run from the
+  // render thread and from prerenderPool
+  QMutex                gsDeviceMutex;
+
   // Output device that ghostscript is supposed tp use. Default is
-  // "png256". If that does not work, gs_generate_graphics_file will
+  // "png16m". If that does not work, gs_render_pages will
   // automatically try other known device drivers. If no known output
   // device can be found, something is badly wrong. In that case,
   // "gsDevice" is set to an empty string, and
-  // gs_generate_graphics_file will return immediately.
+  // gs_render_pages will return immediately.
   QList<QString>::iterator gsDevice;
 
   // A list of known devices, set by the constructor. This includes
@@ -104,6 +160,8 @@ private:
   // removed from the list, and another device name is tried.
   QStringList           knownDevices;
 
+  friend class psPrerenderer;
+
 Q_SIGNALS:
   /** Passed through to the top-level kpart. */
   void error( const QString &message, int duration );
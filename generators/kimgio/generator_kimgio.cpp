@@ -40,6 +40,8 @@ KIMGIOGenerator::KIMGIOGenerator( QObject *parent, const QVariantList &args )
     setFeature( ReadRawData );
     setFeature( Threaded );
     setFeature( TiledRendering );
+    // image() only reads the decoded m_img, tiles can be rendered in parallel
+    setFeature( ParallelRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
     setFeature( SwapBackingFile );
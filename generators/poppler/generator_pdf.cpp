@@ -706,7 +706,8 @@ PDFGenerator::SwapBackingFileResult PDFGenerator::swapBackingFile( QString const
                 if (pp) {
                     page->setObjectRects(generateLinks(pp->links()));
                     rectsGenerated[i] = true;
-                    resolveMediaLinkReferences(page);
+                    if (page->detailsLoaded())
+                        resolveMediaLinkReferences(page);
                     delete pp;
                 }
             }
@@ -761,26 +762,12 @@ void PDFGenerator::loadPages(QVector<Okular::Page*> &pagesVector, int rotation,
             }
             if (rotation % 2 == 1)
             qSwap(w,h);
-            // init a Okular::page, add transition and annotation information
+            // init a Okular::page, the transition, annotations, actions and
+            // form fields are only read when needed, see loadPageDetails()
             page = new Okular::Page( i, w, h, orientation );
-            addTransition( p, page );
-            if ( true ) //TODO real check
-            addAnnotations( p, page );
-            Poppler::Link * tmplink = p->action( Poppler::Page::Opening );
-            if ( tmplink )
-            {
-                page->setPageAction( Okular::Page::Opening, createLinkFromPopplerLink( tmplink ) );
-            }
-            tmplink = p->action( Poppler::Page::Closing );
-            if ( tmplink )
-            {
-                page->setPageAction( Okular::Page::Closing, createLinkFromPopplerLink( tmplink ) );
-            }
             page->setDuration( p->duration() );
             page->setLabel( p->label() );
-
-            addFormFields( p, page );
-//        kWarning(PDFDebug).nospace() << page->width() << "x" << page->height();
+            page->setDetailsLoaded( false );
 
 #ifdef PDFGENERATOR_DEBUG
             qCDebug(OkularPdfDebug) << "load page" << i << "with rotation" << rotation << "and orientation" << orientation;
@@ -799,6 +786,37 @@ void PDFGenerator::loadPages(QVector<Okular::Page*> &pagesVector, int rotation,
     }
 }
 
+void PDFGenerator::loadPageDetails( Okular::Page *page )
+{
+    QMutexLocker ml( userMutex() );
+    if ( !pdfdoc )
+        return;
+
+    const int i = page->number();
+    Poppler::Page * p = pdfdoc->page( i );
+    if ( !p )
+        return;
+
+    addTransition( p, page );
+    addAnnotations( p, page );
+    Poppler::Link * tmplink = p->action( Poppler::Page::Opening );
+    if ( tmplink )
+    {
+        page->setPageAction( Okular::Page::Opening, createLinkFromPopplerLink( tmplink ) );
+    }
+    tmplink = p->action( Poppler::Page::Closing );
+    if ( tmplink )
+    {
+        page->setPageAction( Okular::Page::Closing, createLinkFromPopplerLink( tmplink ) );
+    }
+    addFormFields( p, page );
+    delete p;
+
+    // image() skipped them if it already generated the object rects
+    if ( rectsGenerated.at( i ) )
+        resolveMediaLinkReferences( page );
+}
+
 Okular::DocumentInfo PDFGenerator::generateDocumentInfo( const QSet<Okular::DocumentInfo::Key> &keys ) const
 {
     Okular::DocumentInfo docInfo;
@@ -1192,7 +1210,8 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
         page->setObjectRects( generateLinks(p->links()) );
         rectsGenerated[ request->page()->number() ] = true;
 
-        resolveMediaLinkReferences( page );
+        if ( page->detailsLoaded() )
+            resolveMediaLinkReferences( page );
     }
 
     // 3. UNLOCK [re-enables shared access]
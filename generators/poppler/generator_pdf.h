@@ -101,6 +101,7 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         SwapBackingFileResult swapBackingFile( QString const &newFileName, QVector<Okular::Page*> & newPagesVector ) override;
         bool doCloseDocument() override;
         Okular::TextPage* textPage( Okular::TextRequest *request ) override;
+        void loadPageDetails( Okular::Page *page ) override;
 
     protected Q_SLOTS:
         void requestFontData(const Okular::FontInfo &font, QByteArray *data);
@@ -15,7 +15,9 @@
 #include <qfileinfo.h>
 #include <qimage.h>
 #include <qlist.h>
+#include <qmath.h>
 #include <qpainter.h>
+#include <qvector.h>
 #include <QPrinter>
 
 #include <kaboutdata.h>
@@ -157,6 +159,142 @@ static Okular::Rotation readTiffRotation( TIFF *tiff )
     return ret;
 }
 
+// ABGR, as read by the TIFFReadRGBA* functions, to ARGB
+static inline QRgb abgrToRgb( uint32 pixel )
+{
+    return qRgb( TIFFGetR( pixel ), TIFFGetG( pixel ), TIFFGetB( pixel ) );
+}
+
+// Calls 'row' for the source rows from 'first' to 'last' included, top to
+// bottom, decoding only the strips or tiles they are in. Only one strip or
+// row of tiles is held in memory at a time. Needs ORIENTATION_TOPLEFT.
+template <typename RowFunction>
+static bool readTiffRows( TIFF *tiff, uint32 width, uint32 height, uint32 first, uint32 last, RowFunction row )
+{
+    if ( TIFFIsTiled( tiff ) )
+    {
+        uint32 tileWidth = 0;
+        uint32 tileHeight = 0;
+        if ( !TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tileWidth ) || !TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tileHeight )
+             || tileWidth == 0 || tileHeight == 0 )
+            return false;
+
+        QVector<uint32> tile( tileWidth * tileHeight );
+        QVector<uint32> band( width * tileHeight );
+        for ( uint32 top = first - first % tileHeight; top <= last; top += tileHeight )
+        {
+            const uint32 rows = qMin( tileHeight, height - top );
+            for ( uint32 left = 0; left < width; left += tileWidth )
+            {
+                if ( !TIFFReadRGBATile( tiff, left, top, tile.data() ) )
+                    return false;
+
+                // the tile rows are stored bottom to top, and the tiles
+                // on the edges keep the full tile size
+                const uint32 columns = qMin( tileWidth, width - left );
+                for ( uint32 y = 0; y < rows; ++y )
+                    memcpy( band.data() + y * width + left, tile.constData() + ( tileHeight - 1 - y ) * tileWidth, columns * sizeof( uint32 ) );
+            }
+            for ( uint32 y = qMax( top, first ); y < top + rows && y <= last; ++y )
+                row( y, band.constData() + ( y - top ) * width );
+        }
+    }
+    else
+    {
+        uint32 rowsPerStrip = 0;
+        if ( !TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip ) || rowsPerStrip == 0 )
+            return false;
+        rowsPerStrip = qMin( rowsPerStrip, height );
+
+        QVector<uint32> strip( width * rowsPerStrip );
+        for ( uint32 top = first - first % rowsPerStrip; top <= last; top += rowsPerStrip )
+        {
+            if ( !TIFFReadRGBAStrip( tiff, top, strip.data() ) )
+                return false;
+
+            // the strip rows are stored bottom to top
+            const uint32 rows = qMin( rowsPerStrip, height - top );
+            for ( uint32 y = qMax( top, first ); y < top + rows && y <= last; ++y )
+                row( y, strip.constData() + ( rows - 1 - ( y - top ) ) * width );
+        }
+    }
+    return true;
+}
+
+// Renders the 'rect' part of the image scaled to 'size', which must not be
+// bigger than the image, averaging the source pixels under each target pixel
+// while the rows are read.
+static bool readTiffDownscaled( TIFF *tiff, uint32 width, uint32 height, const QSize &size, const QRect &rect, QImage *target )
+{
+    // the first source column of each target column of 'rect', plus the end
+    QVector<uint32> columns( rect.width() + 1 );
+    for ( int x = 0; x <= rect.width(); ++x )
+        columns[x] = (quint64)( rect.x() + x ) * width / size.width();
+
+    const auto firstRow = [&]( int y ) { return (uint32)( (quint64)y * height / size.height() ); };
+
+    *target = QImage( rect.size(), QImage::Format_RGB32 );
+    QVector<quint64> sums( rect.width() * 3, 0 );
+    int targetRow = rect.top();
+    uint32 endRow = firstRow( targetRow + 1 );
+
+    return readTiffRows( tiff, width, height, firstRow( rect.top() ), firstRow( rect.bottom() + 1 ) - 1,
+                         [&]( uint32 y, const uint32 *pixels ) {
+        for ( int x = 0; x < rect.width(); ++x )
+        {
+            quint64 *sum = sums.data() + x * 3;
+            for ( uint32 sx = columns[x]; sx < columns[x + 1]; ++sx )
+            {
+                sum[0] += TIFFGetR( pixels[sx] );
+                sum[1] += TIFFGetG( pixels[sx] );
+                sum[2] += TIFFGetB( pixels[sx] );
+            }
+        }
+
+        if ( y + 1 < endRow )
+            return;
+
+        // last source row of this target row, write the averages out
+        const quint64 rows = endRow - firstRow( targetRow );
+        QRgb *line = reinterpret_cast<QRgb *>( target->scanLine( targetRow - rect.top() ) );
+        for ( int x = 0; x < rect.width(); ++x )
+        {
+            quint64 *sum = sums.data() + x * 3;
+            const quint64 count = rows * ( columns[x + 1] - columns[x] );
+            line[x] = qRgb( sum[0] / count, sum[1] / count, sum[2] / count );
+            sum[0] = sum[1] = sum[2] = 0;
+        }
+        ++targetRow;
+        endRow = firstRow( targetRow + 1 );
+    } );
+}
+
+// Renders the 'rect' part of the image scaled to 'size', reading only the
+// source pixels under it (plus a small margin for the smooth scaling).
+static bool readTiffUpscaled( TIFF *tiff, uint32 width, uint32 height, const QSize &size, const QRect &rect, QImage *target )
+{
+    const double scaleX = (double)size.width() / width;
+    const double scaleY = (double)size.height() / height;
+    const QRect source = QRect( QPoint( qFloor( rect.left() / scaleX ) - 1, qFloor( rect.top() / scaleY ) - 1 ),
+                                QPoint( qCeil( ( rect.right() + 1 ) / scaleX ), qCeil( ( rect.bottom() + 1 ) / scaleY ) ) )
+                         .intersected( QRect( 0, 0, width, height ) );
+
+    QImage crop( source.size(), QImage::Format_RGB32 );
+    const bool read = readTiffRows( tiff, width, height, source.top(), source.bottom(),
+                                    [&]( uint32 y, const uint32 *pixels ) {
+        QRgb *line = reinterpret_cast<QRgb *>( crop.scanLine( y - source.top() ) );
+        for ( int x = 0; x < source.width(); ++x )
+            line[x] = abgrToRgb( pixels[source.left() + x] );
+    } );
+    if ( !read )
+        return false;
+
+    const QSize scaledSize( qRound( source.width() * scaleX ), qRound( source.height() * scaleY ) );
+    const QPoint offset( qRound( rect.left() - source.left() * scaleX ), qRound( rect.top() - source.top() * scaleY ) );
+    *target = crop.scaled( scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation ).copy( QRect( offset, rect.size() ) );
+    return true;
+}
+
 OKULAR_EXPORT_PLUGIN(TIFFGenerator, "libokularGenerator_tiff.json")
 
 TIFFGenerator::TIFFGenerator( QObject *parent, const QVariantList &args )
@@ -164,6 +302,7 @@ TIFFGenerator::TIFFGenerator( QObject *parent, const QVariantList &args )
       d( new Private )
 {
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
     setFeature( ReadRawData );
@@ -238,9 +377,14 @@ QImage TIFFGenerator::image( Okular::PixmapRequest * request )
     bool generated = false;
     QImage img;
 
-    if ( TIFFSetDirectory( d->tiff, mapPage( request->page()->number() ) ) )
+    // the size of the whole page image, and the part of it to render
+    QSize size( request->width(), request->height() );
+    if ( !request->isTile() && request->page()->rotation() % 2 == 1 )
+        size.transpose();
+    const QRect rect = request->isTile() ? request->normalizedRect().geometry( size.width(), size.height() ) : QRect( QPoint( 0, 0 ), size );
+
+    if ( !rect.isEmpty() && TIFFSetDirectory( d->tiff, mapPage( request->page()->number() ) ) )
     {
-        int rotation = request->page()->rotation();
         uint32 width = 1;
         uint32 height = 1;
         uint32 orientation = 0;
@@ -250,34 +394,44 @@ QImage TIFFGenerator::image( Okular::PixmapRequest * request )
         if ( !TIFFGetField( d->tiff, TIFFTAG_ORIENTATION, &orientation ) )
             orientation = ORIENTATION_TOPLEFT;
 
-        QImage image( width, height, QImage::Format_RGB32 );
-        uint32 * data = (uint32 *)image.bits();
-
-        // read data
-        if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, orientation ) != 0 )
+        if ( orientation == ORIENTATION_TOPLEFT )
         {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
+            // decode strip by strip (or tile by tile) only the rows of the
+            // requested part, so that memory depends on the output size
+            if ( (uint32)size.width() <= width && (uint32)size.height() <= height )
+                generated = readTiffDownscaled( d->tiff, width, height, size, rect, &img );
+            else
+                generated = readTiffUpscaled( d->tiff, width, height, size, rect, &img );
+        }
+        else
+        {
+            // the strip and tile functions do not transpose the image, read it all
+            QImage image( width, height, QImage::Format_RGB32 );
+            uint32 * data = (uint32 *)image.bits();
+
+            if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, orientation ) != 0 )
             {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
+                // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
+                uint32 pixels = width * height;
+                for ( uint32 i = 0; i < pixels; ++i )
+                {
+                    uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
+                    uint32 blue = ( data[i] & 0x000000FF ) << 16;
+                    data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
+                }
+
+                img = image.scaled( size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+                if ( request->isTile() )
+                    img = img.copy( rect );
+
+                generated = true;
             }
-
-            int reqwidth = request->width();
-            int reqheight = request->height();
-            if ( rotation % 2 == 1 )
-                qSwap( reqwidth, reqheight );
-            img = image.scaled( reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
-
-            generated = true;
         }
     }
 
     if ( !generated )
     {
-        img = QImage( request->width(), request->height(), QImage::Format_RGB32 );
+        img = QImage( request->isTile() ? rect.size() : QSize( request->width(), request->height() ), QImage::Format_RGB32 );
         img.fill( qRgb( 255, 255, 255 ) );
     }
 
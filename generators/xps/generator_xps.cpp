@@ -725,7 +725,8 @@ static QString unicodeString( const QString &raw )
 
 XpsHandler::XpsHandler(XpsPage *page): m_page(page)
 {
-    m_painter = nullptr;
+    m_displayList = nullptr;
+    m_archive = nullptr;
 }
 
 XpsHandler::~XpsHandler()
@@ -789,7 +790,9 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
 
     QString att;
 
-    m_painter->save();
+    XpsDisplayItem item( XpsDisplayItem::Glyphs );
+    item.transform = m_state.transform;
+    item.opacity = m_state.opacity;
 
     // Get font (doesn't work well because qt doesn't allow to load font from file)
     // This works despite the fact that font size isn't specified in points as required by qt. It's because I set point size to be equal to drawing unit.
@@ -797,11 +800,10 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     // qCWarning(OkularXpsDebug) << "Font Rendering EmSize:" << fontSize;
     // a value of 0.0 means the text is not visible (see XPS specs, chapter 12, "Glyphs")
     if ( fontSize < 0.1 ) {
-        m_painter->restore();
         return;
     }
     const QString absoluteFileName = absolutePath( entryPath( m_page->fileName() ), node.attributes.value(QStringLiteral("FontUri")) );
-    QFont font = m_page->m_file->getFontByName( absoluteFileName, fontSize );
+    QFont font = m_page->m_file->getFontByName( m_archive, absoluteFileName, fontSize );
     att = node.attributes.value( QStringLiteral("StyleSimulations") );
     if  ( !att.isEmpty() ) {
         if ( att == QLatin1String( "ItalicSimulation" ) ) {
@@ -813,10 +815,10 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
             font.setBold( true );
         }
     }
-    m_painter->setFont(font);
+    item.font = font;
 
     //Origin
-    QPointF origin( node.attributes.value(QStringLiteral("OriginX")).toDouble(), node.attributes.value(QStringLiteral("OriginY")).toDouble() );
+    item.origin = QPointF( node.attributes.value(QStringLiteral("OriginX")).toDouble(), node.attributes.value(QStringLiteral("OriginY")).toDouble() );
 
     //Fill
     QBrush brush;
@@ -828,19 +830,17 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
         } else {
             // no "Fill" attribute and no "Glyphs.Fill" child, so show nothing
             // (see XPS specs, 5.10)
-            m_painter->restore();
             return;
         }
     } else {
         brush = parseRscRefColorForBrush( att );
         if ( brush.style() > Qt::NoBrush && brush.style() < Qt::LinearGradientPattern
              && brush.color().alpha() == 0 ) {
-            m_painter->restore();
             return;
         }
     }
-    m_painter->setBrush( brush );
-    m_painter->setPen( QPen( brush, 0 ) );
+    item.brush = brush;
+    item.pen = QPen( brush, 0 );
 
     // Opacity
     att = node.attributes.value(QStringLiteral("Opacity"));
@@ -848,9 +848,8 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
         bool ok = true;
         double value = att.toDouble( &ok );
         if ( ok && value >= 0.1 ) {
-            m_painter->setOpacity( value );
+            item.opacity = value;
         } else {
-            m_painter->restore();
             return;
         }
     }
@@ -858,31 +857,27 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     //RenderTransform
     att = node.attributes.value(QStringLiteral("RenderTransform"));
     if (!att.isEmpty()) {
-        m_painter->setWorldTransform( parseRscRefMatrix( att ), true);
+        item.transform = parseRscRefMatrix( att ) * item.transform;
     }
 
     // Clip
     att = node.attributes.value( QStringLiteral("Clip") );
     if ( !att.isEmpty() ) {
-        QPainterPath clipPath = parseRscRefPath( att );
-        if ( !clipPath.isEmpty() ) {
-            m_painter->setClipPath( clipPath );
-        }
+        item.clipPath = m_page->m_file->parsePath( att );
     }
 
     // BiDiLevel - default Left-to-Right
-    m_painter->setLayoutDirection( Qt::LeftToRight );
     att = node.attributes.value( QStringLiteral("BiDiLevel") );
     if ( !att.isEmpty() ) {
         if ( (att.toInt() % 2) == 1 ) {
             // odd BiDiLevel, so Right-to-Left
-            m_painter->setLayoutDirection( Qt::RightToLeft );
+            item.layoutDirection = Qt::RightToLeft;
         }
     }
 
     // Indices - partial handling only
     att = node.attributes.value( QStringLiteral("Indices") );
-    QList<qreal> advanceWidths;
+    QVector<qreal> &advanceWidths = item.advanceWidths;
     if ( ! att.isEmpty() ) {
         QStringList indicesElements = att.split( QLatin1Char(';') );
         for( int i = 0; i < indicesElements.size(); ++i ) {
@@ -909,24 +904,12 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     }
 
     // UnicodeString
-    QString stringToDraw( unicodeString( node.attributes.value( QStringLiteral("UnicodeString") ) ) );
-    QPointF originAdvance(0, 0);
-    QFontMetrics metrics = m_painter->fontMetrics();
-    for ( int i = 0; i < stringToDraw.size(); ++i ) {
-        QChar thisChar = stringToDraw.at( i );
-        m_painter->drawText( origin + originAdvance, QString( thisChar ) );
-	const qreal advanceWidth = advanceWidths.value( i, qreal(-1.0) );
-        if ( advanceWidth > 0.0 ) {
-            originAdvance.rx() += advanceWidth;
-        } else {
-            originAdvance.rx() += metrics.width( thisChar );
-        }
-    }
+    item.text = unicodeString( node.attributes.value( QStringLiteral("UnicodeString") ) );
     // qCWarning(OkularXpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
     // qCWarning(OkularXpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
     // qCWarning(OkularXpsDebug) << "    Unicode: " << atts.value("UnicodeString");
 
-    m_painter->restore();
+    m_displayList->items.append( item );
 }
 
 void XpsHandler::processFill( XpsRenderNode &node )
@@ -961,7 +944,7 @@ void XpsHandler::processImageBrush( XpsRenderNode &node )
 
     QRectF viewport = stringToRectF( node.attributes.value( QStringLiteral("Viewport") ) );
     QRectF viewbox = stringToRectF( node.attributes.value( QStringLiteral("Viewbox") ) );
-    QImage image = m_page->loadImageFromFile( node.attributes.value( QStringLiteral("ImageSource") ) );
+    QImage image = m_page->loadImageFromFile( m_archive, node.attributes.value( QStringLiteral("ImageSource") ) );
 
     // Matrix which can transform [0, 0, 1, 1] rectangle to given viewbox
     QTransform viewboxMatrix = QTransform( viewbox.width() * image.physicalDpiX() / 96, 0, 0, viewbox.height() * image.physicalDpiY() / 96, viewbox.x(), viewbox.y() );
@@ -986,6 +969,12 @@ void XpsHandler::processImageBrush( XpsRenderNode &node )
     brush = QBrush( image );
     brush.setTransform( viewboxMatrix.inverted() * viewportMatrix );
 
+    // the brush shares the decoded image, it lives as long as the display list
+    if ( !m_images.contains( image.cacheKey() ) ) {
+        m_images.insert( image.cacheKey() );
+        m_displayList->memory += image.bytesPerLine() * image.height();
+    }
+
     node.data = QVariant::fromValue( brush );
 }
 
@@ -994,7 +983,9 @@ void XpsHandler::processPath( XpsRenderNode &node )
     //TODO Ignored attributes: Clip, OpacityMask, StrokeEndLineCap, StorkeStartLineCap, Name, FixedPage.NavigateURI, xml:lang, x:key, AutomationProperties.Name, AutomationProperties.HelpText, SnapsToDevicePixels
     //TODO Ignored child elements: RenderTransform, Clip, OpacityMask
     // Handled separately: RenderTransform
-    m_painter->save();
+    XpsDisplayItem item( XpsDisplayItem::Path );
+    item.transform = m_state.transform;
+    item.opacity = m_state.opacity;
 
     QString att;
     QVariant data;
@@ -1003,14 +994,13 @@ void XpsHandler::processPath( XpsRenderNode &node )
     XpsPathGeometry * pathdata = node.getChildData( QStringLiteral("Path.Data") ).value< XpsPathGeometry * >();
     att = node.attributes.value( QStringLiteral("Data") );
     if (! att.isEmpty() ) {
-        QPainterPath path = parseRscRefPath( att );
+        QPainterPath path = m_page->m_file->parsePath( att );
         delete pathdata;
         pathdata = new XpsPathGeometry();
         pathdata->paths.append( new XpsPathFigure( path, true ) );
     }
     if ( !pathdata ) {
         // nothing to draw
-        m_painter->restore();
         return;
     }
 
@@ -1025,7 +1015,7 @@ void XpsHandler::processPath( XpsRenderNode &node )
             brush = data.value<QBrush>();
         }
     }
-    m_painter->setBrush( brush );
+    item.brush = brush;
 
     // Stroke (pen)
     att = node.attributes.value( QStringLiteral("Stroke") );
@@ -1104,31 +1094,30 @@ void XpsHandler::processPath( XpsRenderNode &node )
             pen.setMiterLimit( limit / 2 );
         }
     }
-    m_painter->setPen( pen );
+    item.pen = pen;
 
     // Opacity
     att = node.attributes.value(QStringLiteral("Opacity"));
     if (! att.isEmpty()) {
-        m_painter->setOpacity(att.toDouble());
+        item.opacity = att.toDouble();
     }
 
     // RenderTransform
     att = node.attributes.value( QStringLiteral("RenderTransform") );
     if (! att.isEmpty() ) {
-        m_painter->setWorldTransform( parseRscRefMatrix( att ), true );
+        item.transform = parseRscRefMatrix( att ) * item.transform;
     }
     if ( !pathdata->transform.isIdentity() ) {
-        m_painter->setWorldTransform( pathdata->transform, true );
+        item.transform = pathdata->transform * item.transform;
     }
 
     for ( const XpsPathFigure *figure : qAsConst(pathdata->paths) ) {
-        m_painter->setBrush( figure->isFilled ? brush : QBrush() );
-        m_painter->drawPath( figure->path );
+        item.figures.append( *figure );
     }
 
     delete pathdata;
 
-    m_painter->restore();
+    m_displayList->items.append( item );
 }
 
 void XpsHandler::processPathData( XpsRenderNode &node )
@@ -1155,7 +1144,7 @@ void XpsHandler::processPathGeometry( XpsRenderNode &node )
 
     att = node.attributes.value( QStringLiteral("Figures") );
     if ( !att.isEmpty() ) {
-        QPainterPath path = parseRscRefPath( att );
+        QPainterPath path = m_page->m_file->parsePath( att );
         qDeleteAll( geom->paths );
         geom->paths.clear();
         geom->paths.append( new XpsPathFigure( path, true ) );
@@ -1269,20 +1258,20 @@ void XpsHandler::processPathFigure( XpsRenderNode &node )
 void XpsHandler::processStartElement( XpsRenderNode &node )
 {
     if (node.name == QLatin1String("Canvas")) {
-        m_painter->save();
+        m_states.push( m_state );
         QString att = node.attributes.value( QStringLiteral("RenderTransform") );
         if ( !att.isEmpty() ) {
-            m_painter->setWorldTransform( parseRscRefMatrix( att ), true );
+            m_state.transform = parseRscRefMatrix( att ) * m_state.transform;
         }
         att = node.attributes.value( QStringLiteral("Opacity") );
         if ( !att.isEmpty() ) {
             double value = att.toDouble();
             if ( value > 0.0 && value <= 1.0 ) {
-                m_painter->setOpacity( m_painter->opacity() * value );
+                m_state.opacity = m_state.opacity * value;
             } else {
                 // setting manually to 0 is necessary to "disable"
                 // all the stuff inside
-                m_painter->setOpacity( 0.0 );
+                m_state.opacity = 0.0;
             }
         }
     }
@@ -1300,10 +1289,12 @@ void XpsHandler::processEndElement( XpsRenderNode &node )
     } else if ((node.name == QLatin1String("Canvas.RenderTransform")) || (node.name == QLatin1String("Glyphs.RenderTransform")) || (node.name == QLatin1String("Path.RenderTransform")))  {
         QVariant data = node.getRequiredChildData( QStringLiteral("MatrixTransform") );
         if (data.canConvert<QTransform>()) {
-            m_painter->setWorldTransform( data.value<QTransform>(), true );
+            m_state.transform = data.value<QTransform>() * m_state.transform;
         }
     } else if (node.name == QLatin1String("Canvas")) {
-        m_painter->restore();
+        if ( !m_states.isEmpty() ) {
+            m_state = m_states.pop();
+        }
     } else if ((node.name == QLatin1String("Path.Fill")) || (node.name == QLatin1String("Glyphs.Fill"))) {
         processFill( node );
     } else if (node.name == QLatin1String("Path.Stroke")) {
@@ -1381,9 +1372,8 @@ void XpsHandler::processEndElement( XpsRenderNode &node )
 }
 
 XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
-    m_fileName( fileName ), m_pageIsRendered(false)
+    m_fileName( fileName )
 {
-    m_pageImage = nullptr;
 
     // qCWarning(OkularXpsDebug) << "page file name: " << fileName;
 
@@ -1410,47 +1400,61 @@ XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
 
 XpsPage::~XpsPage()
 {
-    delete m_pageImage;
 }
 
 bool XpsPage::renderToImage( QImage *p )
 {
+    // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
+    p->setDotsPerMeterX( 2835 );
+    p->setDotsPerMeterY( 2835 );
+    p->fill( qRgba( 255, 255, 255, 255 ) );
 
-    if ((m_pageImage == nullptr) || (m_pageImage->size() != p->size())) {
-        delete m_pageImage;
-        m_pageImage = new QImage( p->size(), QImage::Format_ARGB32 );
-        // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
-        m_pageImage->setDotsPerMeterX( 2835 );
-        m_pageImage->setDotsPerMeterY( 2835 );
+    QPainter painter( p );
+    return renderToPainter( &painter );
+}
 
-        m_pageIsRendered = false;
-    }
-    if (! m_pageIsRendered) {
-        m_pageImage->fill( qRgba( 255, 255, 255, 255 ) );
-        QPainter painter( m_pageImage );
-        renderToPainter( &painter );
-        m_pageIsRendered = true;
+QSharedPointer<const XpsDisplayList> XpsPage::displayList()
+{
+    // other pages may be parsed at the same time, this one only once
+    QMutexLocker lock( &m_displayListMutex );
+    const QSharedPointer<const XpsDisplayList> cached = m_file->cachedDisplayList( this );
+    if ( cached ) {
+        return cached;
     }
 
-    *p = *m_pageImage;
-
-    return true;
-}
+    // the page is parsed only once, rendering just replays what it draws
+    QSharedPointer<XpsDisplayList> displayList( new XpsDisplayList() );
+    KZip *archive = m_file->acquireArchive();
+    if ( !archive ) {
+        return displayList;
+    }
 
-bool XpsPage::renderToPainter( QPainter *painter )
-{
     XpsHandler handler( this );
-    handler.m_painter = painter;
-    handler.m_painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    handler.m_displayList = displayList.data();
+    handler.m_archive = archive;
     QXmlSimpleReader parser;
     parser.setContentHandler( &handler );
     parser.setErrorHandler( &handler );
-    const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( m_fileName ));
+    const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(archive->directory()->entry( m_fileName ));
     QByteArray data = readFileOrDirectoryParts( pageFile );
     QBuffer buffer( &data );
     QXmlInputSource source( &buffer );
     bool ok = parser.parse( source );
     qCWarning(OkularXpsDebug) << "Parse result: " << ok;
+    m_file->releaseArchive( archive );
+
+    // what a failed parse drew is shown, and the page parsed again next time
+    if ( ok ) {
+        displayList->memory += displayList->items.count() * sizeof( XpsDisplayItem );
+        m_file->cacheDisplayList( this, displayList );
+    }
+    return displayList;
+}
+
+bool XpsPage::renderToPainter( QPainter *painter )
+{
+    painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    displayList()->replay( painter );
 
     return true;
 }
@@ -1460,41 +1464,78 @@ QSizeF XpsPage::size() const
     return m_pageSize;
 }
 
-QFont XpsFile::getFontByName( const QString &absoluteFileName, float size )
+QFont XpsFile::getFontByName( KZip *archive, const QString &absoluteFileName, float size )
 {
     // qCWarning(OkularXpsDebug) << "trying to get font: " << fileName << ", size: " << size;
 
-    int index = m_fontCache.value(absoluteFileName, -1);
-    if (index == -1)
+    QFont font;
+    bool known;
+    bool resolved;
     {
-        index = loadFontByName(absoluteFileName);
-        m_fontCache[absoluteFileName] = index;
+        QReadLocker lock( &m_fontLock );
+        const QHash<QString, QFont>::const_iterator it = m_fonts.constFind( absoluteFileName );
+        known = it != m_fonts.constEnd();
+        if ( known ) {
+            font = *it;
+        }
+        resolved = known || m_fontCache.contains( absoluteFileName );
+    }
+    if ( !resolved ) {
+        known = resolveFont( archive, absoluteFileName, &font );
+    }
+    if ( !known ) {
+        return QFont();
+    }
+
+    // the size is the one thing differing between the glyphs using a font
+    if ( qRound( size ) > 0 ) {
+        font.setPointSize( qRound( size ) );
     }
+    return font;
+}
+
+bool XpsFile::resolveFont( KZip *archive, const QString &absoluteFileName, QFont *font )
+{
+    // the pages parsed in other threads may want the same font, load it only once
+    QWriteLocker lock( &m_fontLock );
+    if ( m_fontCache.contains( absoluteFileName ) ) {
+        const QHash<QString, QFont>::const_iterator it = m_fonts.constFind( absoluteFileName );
+        if ( it == m_fonts.constEnd() ) {
+            return false;
+        }
+        *font = *it;
+        return true;
+    }
+
+    const int index = loadFontByName(archive, absoluteFileName);
+    m_fontCache[absoluteFileName] = index;
     if ( index == -1 ) {
         qCWarning(OkularXpsDebug) << "Requesting unknown font:" << absoluteFileName;
-        return QFont();
+        return false;
     }
 
     const QStringList fontFamilies = m_fontDatabase.applicationFontFamilies( index );
     if ( fontFamilies.isEmpty() ) {
       qCWarning(OkularXpsDebug) << "The unexpected has happened. No font family for a known font:" << absoluteFileName << index;
-      return QFont();
+      return false;
     }
     const QString fontFamily = fontFamilies[0];
     const QStringList fontStyles = m_fontDatabase.styles( fontFamily );
     if ( fontStyles.isEmpty() ) {
       qCWarning(OkularXpsDebug) << "The unexpected has happened. No font style for a known font family:" << absoluteFileName << index << fontFamily ;
-      return QFont();
+      return false;
     }
     const QString fontStyle =  fontStyles[0];
-    return m_fontDatabase.font(fontFamily, fontStyle, qRound(size));
+    *font = m_fontDatabase.font( fontFamily, fontStyle, -1 );
+    m_fonts.insert( absoluteFileName, *font );
+    return true;
 }
 
-int XpsFile::loadFontByName( const QString &absoluteFileName )
+int XpsFile::loadFontByName( KZip *archive, const QString &absoluteFileName )
 {
     // qCWarning(OkularXpsDebug) << "font file name: " << absoluteFileName;
 
-    const KArchiveEntry* fontFile = loadEntry( m_xpsArchive, absoluteFileName, Qt::CaseInsensitive );
+    const KArchiveEntry* fontFile = loadEntry( archive, absoluteFileName, Qt::CaseInsensitive );
     if ( !fontFile ) {
         return -1;
     }
@@ -1540,7 +1581,31 @@ KZip * XpsFile::xpsArchive() {
     return m_xpsArchive;
 }
 
-QImage XpsPage::loadImageFromFile( const QString &fileName )
+KZip * XpsFile::acquireArchive()
+{
+    QMutexLocker lock( &m_archivesMutex );
+    if ( !m_freeArchives.isEmpty() ) {
+        return m_freeArchives.takeLast();
+    }
+
+    // one more reader for one more thread rendering at the same time
+    KZip *archive = new KZip( m_xpsArchive->fileName() );
+    if ( !archive->open( QIODevice::ReadOnly ) ) {
+        qCWarning(OkularXpsDebug) << "Could not open XPS archive:" << archive->fileName();
+        delete archive;
+        return nullptr;
+    }
+    m_archives.append( archive );
+    return archive;
+}
+
+void XpsFile::releaseArchive( KZip *archive )
+{
+    QMutexLocker lock( &m_archivesMutex );
+    m_freeArchives.append( archive );
+}
+
+QImage XpsPage::loadImageFromFile( KZip *archive, const QString &fileName )
 {
     // qCWarning(OkularXpsDebug) << "image file name: " << fileName;
 
@@ -1550,8 +1615,19 @@ QImage XpsPage::loadImageFromFile( const QString &fileName )
         return QImage();
     }
 
-    QString absoluteFileName = absolutePath( entryPath( m_fileName ), fileName );
-    const KZipFileEntry* imageFile = loadFile( m_file->xpsArchive(), absoluteFileName, Qt::CaseInsensitive );
+    return m_file->loadImage( archive, absolutePath( entryPath( m_fileName ), fileName ) );
+}
+
+QImage XpsFile::loadImage( KZip *archive, const QString &absoluteFileName )
+{
+    {
+        QMutexLocker lock( &m_cacheMutex );
+        if ( QImage *cached = m_imageCache.object( absoluteFileName ) ) {
+            return *cached;
+        }
+    }
+
+    const KZipFileEntry* imageFile = loadFile( archive, absoluteFileName, Qt::CaseInsensitive );
     if ( !imageFile ) {
         // image not found
         return QImage();
@@ -1584,9 +1660,112 @@ QImage XpsPage::loadImageFromFile( const QString &fileName )
     reader.setDevice(&buffer);
     reader.read(&image);
 
+    // the cost is in KiB
+    QMutexLocker lock( &m_cacheMutex );
+    m_imageCache.insert( absoluteFileName, new QImage( image ), qMax( 1, image.bytesPerLine() * image.height() / 1024 ) );
+
     return image;
 }
 
+QPainterPath XpsFile::parsePath( const QString &data )
+{
+    {
+        QMutexLocker lock( &m_cacheMutex );
+        if ( QPainterPath *cached = m_pathCache.object( data ) ) {
+            return *cached;
+        }
+    }
+
+    const QPainterPath path = parseRscRefPath( data );
+    // the cost is the length of the data
+    QMutexLocker lock( &m_cacheMutex );
+    m_pathCache.insert( data, new QPainterPath( path ), qMax( 1, data.length() ) );
+    return path;
+}
+
+QSharedPointer<const XpsDisplayList> XpsFile::cachedDisplayList( const XpsPage *page )
+{
+    QMutexLocker lock( &m_cacheMutex );
+    QSharedPointer<const XpsDisplayList> *cached = m_displayListCache.object( page );
+    return cached ? *cached : QSharedPointer<const XpsDisplayList>();
+}
+
+void XpsFile::cacheDisplayList( const XpsPage *page, const QSharedPointer<const XpsDisplayList> &displayList )
+{
+    // the cost is in KiB
+    QMutexLocker lock( &m_cacheMutex );
+    m_displayListCache.insert( page, new QSharedPointer<const XpsDisplayList>( displayList ), int( qMax( qint64( 1 ), displayList->memory / 1024 ) ) );
+}
+
+// drops the least recently used items of 'cache' to free up to 'kiloBytes'
+template <typename Key, typename T>
+static qulonglong shrinkCache( QCache<Key, T> *cache, qulonglong kiloBytes )
+{
+    const int before = cache->totalCost();
+    const int maxCost = cache->maxCost();
+    cache->setMaxCost( kiloBytes >= qulonglong( before ) ? 0 : before - int( kiloBytes ) );
+    cache->setMaxCost( maxCost );
+    return before - cache->totalCost();
+}
+
+qulonglong XpsFile::freeCachedMemory( qulonglong bytes )
+{
+    // don't wait for a page being parsed, a display list being drawn is
+    // kept alive by its renderer
+    if ( !m_cacheMutex.tryLock() ) {
+        return 0;
+    }
+
+    const qulonglong kiloBytes = ( bytes + 1023 ) / 1024;
+    qulonglong freed = shrinkCache( &m_displayListCache, kiloBytes );
+    if ( freed < kiloBytes ) {
+        freed += shrinkCache( &m_imageCache, kiloBytes - freed );
+    }
+
+    m_cacheMutex.unlock();
+    return freed * 1024;
+}
+
+void XpsDisplayList::replay( QPainter *painter ) const
+{
+    for ( const XpsDisplayItem &item : items ) {
+        painter->save();
+        painter->setWorldTransform( item.transform, true );
+        painter->setOpacity( item.opacity );
+        painter->setBrush( item.brush );
+        painter->setPen( item.pen );
+
+        if ( item.type == XpsDisplayItem::Path ) {
+            for ( const XpsPathFigure &figure : item.figures ) {
+                painter->setBrush( figure.isFilled ? item.brush : QBrush() );
+                painter->drawPath( figure.path );
+            }
+        } else {
+            painter->setFont( item.font );
+            if ( !item.clipPath.isEmpty() ) {
+                painter->setClipPath( item.clipPath );
+            }
+            painter->setLayoutDirection( item.layoutDirection );
+
+            // the advances come from the metrics of the device drawn on
+            QPointF originAdvance(0, 0);
+            QFontMetrics metrics = painter->fontMetrics();
+            for ( int i = 0; i < item.text.size(); ++i ) {
+                QChar thisChar = item.text.at( i );
+                painter->drawText( item.origin + originAdvance, QString( thisChar ) );
+                const qreal advanceWidth = item.advanceWidths.value( i, qreal(-1.0) );
+                if ( advanceWidth > 0.0 ) {
+                    originAdvance.rx() += advanceWidth;
+                } else {
+                    originAdvance.rx() += metrics.width( thisChar );
+                }
+            }
+        }
+
+        painter->restore();
+    }
+}
+
 Okular::TextPage* XpsPage::textPage()
 {
     // qCWarning(OkularXpsDebug) << "Parsing XpsPage, text extraction";
@@ -1649,7 +1828,7 @@ Okular::TextPage* XpsPage::textPage()
 
                 // Get font (doesn't work well because qt doesn't allow to load font from file)
                 const QString absoluteFileName = absolutePath( entryPath( m_fileName ), glyphsAtts.value( QStringLiteral("FontUri") ).toString() );
-                QFont font = m_file->getFontByName( absoluteFileName,
+                QFont font = m_file->getFontByName( m_file->xpsArchive(), absoluteFileName,
                                                     glyphsAtts.value(QStringLiteral("FontRenderingEmSize")).toString().toFloat() * 72 / 96 );
                 QFontMetrics metrics = QFontMetrics( font );
                 // Origin
@@ -1874,6 +2053,7 @@ XpsPage* XpsDocument::page(int pageNum) const
 }
 
 XpsFile::XpsFile()
+    : m_imageCache( 64 * 1024 ), m_pathCache( 4 * 1024 * 1024 ), m_displayListCache( 128 * 1024 )
 {
 }
 
@@ -2034,9 +2214,18 @@ Okular::DocumentInfo XpsFile::generateDocumentInfo() const
 
 bool XpsFile::closeDocument()
 {
+    {
+        QMutexLocker lock( &m_cacheMutex );
+        m_displayListCache.clear();
+    }
+
     qDeleteAll( m_documents );
     m_documents.clear();
 
+    qDeleteAll( m_archives );
+    m_archives.clear();
+    m_freeArchives.clear();
+
     delete m_xpsArchive;
 
     return true;
@@ -2069,6 +2258,7 @@ XpsGenerator::XpsGenerator( QObject *parent, const QVariantList &args )
     setFeature( PrintNative );
     setFeature( PrintToFile );
     setFeature( Threaded );
+    setFeature( ParallelRendering );
     userMutex();
 }
 
@@ -2108,9 +2298,15 @@ bool XpsGenerator::doCloseDocument()
     return true;
 }
 
+qulonglong XpsGenerator::freeCachedMemory( qulonglong bytes )
+{
+    return m_xpsFile ? m_xpsFile->freeCachedMemory( bytes ) : 0;
+}
+
 QImage XpsGenerator::image( Okular::PixmapRequest * request )
 {
-    QMutexLocker lock( userMutex() );
+    // each page is parsed with a reader of the archive of its own, so
+    // several of them can render at the same time
     QSize size( (int)request->width(), (int)request->height() );
     QImage image( size, QImage::Format_RGB32 );
     XpsPage *pageToRender = m_xpsFile->page( request->page()->number() );
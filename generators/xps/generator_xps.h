@@ -23,10 +23,18 @@
 #include <core/generator.h>
 #include <core/textpage.h>
 
+#include <QCache>
 #include <QColor>
 #include <QDomDocument>
 #include <QFontDatabase>
+#include <QHash>
 #include <QImage>
+#include <QMutex>
+#include <QPainterPath>
+#include <QPen>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QSharedPointer>
 #include <QXmlStreamReader>
 #include <QXmlDefaultHandler>
 #include <QStack>
@@ -107,6 +115,65 @@ struct XpsPathGeometry
     XpsMatrixTransform transform;
 };
 
+/**
+    One drawing of a page. A page is parsed once into a list of them, which
+    is replayed at every render whatever the size
+*/
+struct XpsDisplayItem
+{
+    enum Type { Path, Glyphs };
+
+    XpsDisplayItem( Type t )
+        : type( t ), opacity( 1.0 ), layoutDirection( Qt::LeftToRight )
+    {}
+
+    Type type;
+    // the painter state it is drawn with, on top of the scaling of the page
+    QTransform transform;
+    qreal opacity;
+    QBrush brush;
+    QPen pen;
+
+    // Path
+    QList< XpsPathFigure > figures;
+
+    // Glyphs
+    QFont font;
+    QPointF origin;
+    QString text;
+    // -1 for the characters advancing by the font metrics
+    QVector< qreal > advanceWidths;
+    QPainterPath clipPath;
+    Qt::LayoutDirection layoutDirection;
+};
+
+class XpsDisplayList
+{
+public:
+    XpsDisplayList()
+        : memory( 0 )
+    {}
+
+    void replay( QPainter *painter ) const;
+
+    QList< XpsDisplayItem > items;
+    // the bytes the list keeps alive, the images its brushes share included
+    qint64 memory;
+};
+
+/**
+    The painter state the display list items get while parsing
+*/
+struct XpsPaintState
+{
+    XpsPaintState()
+        : opacity( 1.0 )
+    {}
+
+    QTransform transform;
+    qreal opacity;
+};
+
 class XpsPage;
 class XpsFile;
 
@@ -141,12 +208,18 @@ protected:
     void processPathGeometry( XpsRenderNode &node );
     void processPathFigure( XpsRenderNode &node );
 
-    QPainter *m_painter;
+    XpsDisplayList *m_displayList;
+    // the reader of the archive of the thread parsing the page
+    KZip *m_archive;
 
-    QImage m_image;
+    XpsPaintState m_state;
+    QStack<XpsPaintState> m_states;
 
     QStack<XpsRenderNode> m_nodes;
 
+    // the images already counted in the memory of the display list
+    QSet<qint64> m_images;
+
     friend class XpsPage;
 };
 
@@ -164,10 +237,12 @@ public:
     bool renderToPainter( QPainter *painter );
     Okular::TextPage* textPage();
 
-    QImage loadImageFromFile( const QString &filename );
+    QImage loadImageFromFile( KZip *archive, const QString &filename );
     QString fileName() const { return m_fileName; }
 
 private:
+    QSharedPointer<const XpsDisplayList> displayList();
+
     XpsFile *m_file;
     const QString m_fileName;
 
@@ -179,8 +254,8 @@ private:
     QImage m_thumbnail;
     bool m_thumbnailIsLoaded;
 
-    QImage *m_pageImage;
-    bool m_pageIsRendered;
+    // the display list itself is in the cache of the file
+    QMutex m_displayListMutex;
 
     friend class XpsHandler;
     friend class XpsTextExtractionHandler;
@@ -284,13 +359,54 @@ public:
     */
     XpsDocument* document(int documentNum) const;
 
-    QFont getFontByName( const QString &absoluteFileName, float size );
+    /**
+       the font in the file at \param absoluteFileName, read with \param archive
+       and resolved by the first thread asking for it
+    */
+    QFont getFontByName( KZip *archive, const QString &absoluteFileName, float size );
+
+    /**
+       the image in the file at \param absoluteFileName, read with \param archive
+       and decoded once for all the pages using it
+    */
+    QImage loadImage( KZip *archive, const QString &absoluteFileName );
+
+    /**
+       the path of the given abbreviated syntax \param data, parsed once for
+       all the pages using it
+    */
+    QPainterPath parsePath( const QString &data );
+
+    /**
+       the display list of \param page if it is still cached
+    */
+    QSharedPointer<const XpsDisplayList> cachedDisplayList( const XpsPage *page );
+
+    /**
+       caches the parsed \param displayList of \param page, the least
+       recently used lists are dropped when they take too much memory
+    */
+    void cacheDisplayList( const XpsPage *page, const QSharedPointer<const XpsDisplayList> &displayList );
+
+    /**
+       drops up to \param bytes of the cached display lists and images,
+       returns how many bytes were freed
+    */
+    qulonglong freeCachedMemory( qulonglong bytes );
 
     KZip* xpsArchive();
 
+    /**
+       a reader of the archive for the calling thread only, as a KZip can
+       not be read by several threads at once. Give it back with
+       releaseArchive() when done
+    */
+    KZip* acquireArchive();
+    void releaseArchive( KZip *archive );
 
 private:
-    int loadFontByName( const QString &absoluteFileName );
+    bool resolveFont( KZip *archive, const QString &absoluteFileName, QFont *font );
+    int loadFontByName( KZip *archive, const QString &absoluteFileName );
 
     QList<XpsDocument*> m_documents;
     QList<XpsPage*> m_pages;
@@ -306,8 +422,21 @@ private:
 
     KZip * m_xpsArchive;
 
+    QList<KZip*> m_archives;
+    QList<KZip*> m_freeArchives;
+    QMutex m_archivesMutex;
+
+    // the fonts are loaded and resolved under the write lock, and then
+    // only read by the threads drawing or extracting the text
     QMap<QString, int> m_fontCache;
+    QHash<QString, QFont> m_fonts;
     QFontDatabase m_fontDatabase;
+    QReadWriteLock m_fontLock;
+
+    QCache<QString, QImage> m_imageCache;
+    QCache<QString, QPainterPath> m_pathCache;
+    QCache<const XpsPage*, QSharedPointer<const XpsDisplayList> > m_displayListCache;
+    QMutex m_cacheMutex;
 };
 
 
@@ -329,6 +458,8 @@ class XpsGenerator : public Okular::Generator
 
         bool print( QPrinter &printer ) override;
 
+        qulonglong freeCachedMemory( qulonglong bytes ) override;
+
     protected:
         bool doCloseDocument() override;
         QImage image( Okular::PixmapRequest *request ) override;
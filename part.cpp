@@ -114,6 +114,7 @@
 #include "core/bookmarkmanager.h"
 #include "core/document.h"
 #include "core/document_p.h"
+#include "core/form.h"
 #include "core/generator.h"
 #include "core/page.h"
 #include "core/fileprinter.h"
@@ -309,7 +310,7 @@ Part::Part(QWidget *parentWidget,
 QObject *parent,
 const QVariantList &args)
 : KParts::ReadWritePart(parent),
-m_tempfile( nullptr ), m_documentOpenWithPassword( false ), m_swapInsteadOfOpening( false ), m_isReloading( false ), m_fileWasRemoved( false ), m_showMenuBarAction( nullptr ), m_showFullScreenAction( nullptr ), m_actionsSearched( false ),
+m_tempfile( nullptr ), m_documentOpenWithPassword( false ), m_swapInsteadOfOpening( false ), m_formsMessageShown( false ), m_signatureMessageShown( false ), m_isReloading( false ), m_fileWasRemoved( false ), m_showMenuBarAction( nullptr ), m_showFullScreenAction( nullptr ), m_actionsSearched( false ),
 m_cliPresentation(false), m_cliPrint(false), m_cliPrintAndExit(false), m_embedMode(detectEmbedMode(parentWidget, parent, args)), m_generatorGuiClient(nullptr), m_keeper( nullptr )
 {
     // make sure that the component name is okular otherwise the XMLGUI .rc files are not found
@@ -1261,6 +1262,19 @@ void Part::notifyViewportChanged( bool /*smoothMove*/ )
 
 void Part::notifyPageChanged( int page, int flags )
 {
+    // the form fields of the page may have been loaded after the document was opened
+    if ( ( flags & Okular::DocumentObserver::Annotations ) && ( !m_formsMessageShown || !m_signatureMessageShown ) )
+    {
+        const QLinkedList< Okular::FormField * > formFields = m_document->page( page )->formFields();
+        if ( !formFields.isEmpty() && !m_formsMessageShown && m_pageView->toggleFormsAction() )
+            showFormsMessage();
+        for ( const Okular::FormField *f : formFields )
+        {
+            if ( f->type() == Okular::FormField::FormSignature && !m_signatureMessageShown )
+                showSignatureMessage();
+        }
+    }
+
     if ( !(flags & Okular::DocumentObserver::Bookmark ) )
         return;
 
@@ -1270,6 +1284,29 @@ void Part::notifyPageChanged( int page, int flags )
 }
 
 
+void Part::showFormsMessage()
+{
+    m_formsMessage->setText( i18n( "This document has forms. Click on the button to interact with them, or use View -> Show Forms." ) );
+    m_formsMessage->setMessageType( KMessageWidget::Information );
+    m_formsMessage->setVisible( true );
+    m_formsMessageShown = true;
+}
+
+void Part::showSignatureMessage()
+{
+    if ( m_embedMode == PrintPreviewMode )
+    {
+        m_signatureMessage->setText( i18n( "All editing and interactive features for this document are disabled. Please save a copy and reopen to edit this document." ) );
+    }
+    else
+    {
+        m_signatureMessage->setText( i18n( "This document is digitally signed." ) );
+    }
+    m_signatureMessage->setVisible( true );
+    m_signatureMessageShown = true;
+}
+
+
 void Part::goToPage(uint page)
 {
     if ( page <= m_document->pages() )
@@ -1597,30 +1634,24 @@ bool Part::openFile()
         m_formsMessage->setIcon( QIcon::fromTheme( QStringLiteral("dialog-warning") ) );
         m_formsMessage->setMessageType( KMessageWidget::Warning );
         m_formsMessage->setVisible( true );
+        m_formsMessageShown = true;
     }
     // m_pageView->toggleFormsAction() may be null on dummy mode
     else if ( ok && m_pageView->toggleFormsAction() && m_pageView->toggleFormsAction()->isEnabled() )
     {
-        m_formsMessage->setText( i18n( "This document has forms. Click on the button to interact with them, or use View -> Show Forms." ) );
-        m_formsMessage->setMessageType( KMessageWidget::Information );
-        m_formsMessage->setVisible( true );
+        showFormsMessage();
     }
     else
     {
         m_formsMessage->setVisible( false );
+        // the forms of the pages loaded later may still show it
+        m_formsMessageShown = !ok;
     }
 
+    m_signatureMessageShown = !ok;
     if ( ok && m_document->metaData( QStringLiteral("IsDigitallySigned") ).toBool() )
     {
-        if ( m_embedMode == PrintPreviewMode )
-        {
-            m_signatureMessage->setText( i18n( "All editing and interactive features for this document are disabled. Please save a copy and reopen to edit this document." ) );
-        }
-        else
-        {
-            m_signatureMessage->setText( i18n( "This document is digitally signed." ) );
-        }
-        m_signatureMessage->setVisible( true );
+        showSignatureMessage();
     }
 
     if ( m_showPresentation ) m_showPresentation->setEnabled( ok );
@@ -1913,6 +1944,8 @@ bool Part::closeUrl(bool promptToSave)
         m_formsMessage->setVisible( false );
         m_signatureMessage->setVisible( false );
     }
+    m_formsMessageShown = true;
+    m_signatureMessageShown = true;
 #ifdef OKULAR_KEEP_FILE_OPEN
     m_keeper->close();
 #endif
@@ -268,6 +268,8 @@ class OKULARPART_EXPORT Part : public KParts::ReadWritePart, public Okular::Docu
         bool doPrint( QPrinter &printer );
         bool handleCompressed(QString &destpath, const QString &path, KCompressionDevice::CompressionType compressionType );
         void rebuildBookmarkMenu( bool unplugActions = true );
+        void showFormsMessage();
+        void showSignatureMessage();
         void updateAboutBackendAction();
         void unsetDummyMode();
         void slotRenameBookmark( const DocumentViewport &viewport );
@@ -312,6 +314,10 @@ class OKULARPART_EXPORT Part : public KParts::ReadWritePart, public Okular::Docu
         KMessageWidget * m_formsMessage;
         KMessageWidget * m_infoMessage;
         KMessageWidget * m_signatureMessage;
+        // whether the forms and signature messages were shown for the
+        // current document, whose form fields may be loaded page by page
+        bool m_formsMessageShown;
+        bool m_signatureMessageShown;
         QPointer<ThumbnailList> m_thumbnailList;
         QPointer<PageView> m_pageView;
         QPointer<TOC> m_toc;
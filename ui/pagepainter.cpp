@@ -31,6 +31,7 @@
 #include "core/annotations.h"
 #include "core/utils.h"
 #include "guiutils.h"
+#include "pagepainterkernels.h"
 #include "settings.h"
 #include "core/observer.h"
 #include "core/tile.h"
@@ -53,6 +54,27 @@ inline QPen buildPen( const Okular::Annotation *ann, double width, const QColor
     return p;
 }
 
+// identifies the color transformation of the accessibility settings, 0 if none
+static quint64 colorTransformKey()
+{
+    if ( !Okular::SettingsCore::changeColors() )
+        return 0;
+
+    switch ( Okular::SettingsCore::renderMode() )
+    {
+        case Okular::SettingsCore::EnumRenderMode::Inverted:
+            return 1;
+        case Okular::SettingsCore::EnumRenderMode::Recolor:
+            return 2 | ( quint64( Okular::Settings::recolorForeground().rgb() & 0xffffff ) << 8 )
+                     | ( quint64( Okular::Settings::recolorBackground().rgb() & 0xffffff ) << 32 );
+        case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+            return 3 | ( quint64( Okular::Settings::bWContrast() & 0xffff ) << 8 )
+                     | ( quint64( Okular::Settings::bWThreshold() & 0xffff ) << 24 );
+        default:
+            return 0;
+    }
+}
+
 void PagePainter::paintPageOnPainter( QPainter * destPainter, const Okular::Page * page,
     Okular::DocumentObserver *observer, int flags, int scaledWidth, int scaledHeight, const QRect &limits )
 {
@@ -103,6 +125,8 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
 
     const bool hasTilesManager = page->hasTilesManager( observer );
     QPixmap pixmap;
+    qint64 pixmapKey = 0;
+    bool colorsTransformed = false;
 
     if ( !hasTilesManager )
     {
@@ -110,6 +134,8 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
         const QPixmap *p = page->_o_nearestPixmap( observer, dScaledWidth, dScaledHeight );
 
         if (p != NULL) {
+            // the key of the pixmap owned by the page, the copy may detach below
+            pixmapKey = p->cacheKey();
             pixmap = *p;
             pixmap.setDevicePixelRatio( qApp->devicePixelRatio() );
         }
@@ -134,6 +160,31 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
             }
             return;
         }
+
+        /** 1C - PAINT THE OBSERVER PIXMAP WITH THE ACCESSIBILITY COLORS APPLIED ONCE **/
+        const quint64 transformKey = ( flags & Accessibility ) ? colorTransformKey() : 0;
+        if ( transformKey && page->hasPixmap( observer ) )
+        {
+            const QPixmap *transformed = page->d->transformedPixmap( observer, transformKey );
+            if ( !transformed )
+            {
+                QImage image( p->size(), QImage::Format_ARGB32_Premultiplied );
+                image.fill( paperColor );
+                QPainter imagePainter( &image );
+                imagePainter.drawPixmap( QRect( QPoint( 0, 0 ), p->size() ), *p );
+                imagePainter.end();
+                transformColors( &image );
+
+                QPixmap *newTransformed = new QPixmap( QPixmap::fromImage( image ) );
+                page->d->setTransformedPixmap( observer, transformKey, newTransformed );
+                transformed = newTransformed;
+            }
+
+            pixmapKey = transformed->cacheKey();
+            pixmap = *transformed;
+            pixmap.setDevicePixelRatio( qApp->devicePixelRatio() );
+            colorsTransformed = true;
+        }
     }
 
     /** 2 - FIND OUT WHAT TO PAINT (Flags + Configuration + Presence) **/
@@ -254,7 +305,7 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
     }
 
     /** 3 - ENABLE BACKBUFFERING IF DIRECT IMAGE MANIPULATION IS NEEDED **/
-    bool bufferAccessibility = (flags & Accessibility) && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
+    bool bufferAccessibility = (flags & Accessibility) && !colorsTransformed && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
     bool useBackBuffer = bufferAccessibility || bufferedHighlights || bufferedAnnotations || viewPortPoint;
     QPixmap * backPixmap = nullptr;
     QPainter * mixedPainter = nullptr;
@@ -296,9 +347,8 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
         }
         else
         {
-            QPixmap scaledCroppedPixmap = pixmap.scaled(dScaledWidth, dScaledHeight).copy(dLimitsInPixmap);
-            scaledCroppedPixmap.setDevicePixelRatio(dpr);
-            destPainter->drawPixmap( limits.topLeft(), scaledCroppedPixmap, QRectF(0, 0, dLimits.width(),dLimits.height()));
+            drawPagePixmap( destPainter, QRectF( limits.topLeft(), QSizeF( dLimits.size() ) / dpr ), page, observer,
+                            pixmap, pixmapKey, dScaledWidth, dScaledHeight, dLimitsInPixmap );
         }
 
         // 4A.2. active painter is the one passed to this method
@@ -351,50 +401,15 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
         else
         {
             // 4B.1. draw the page pixmap: normal or scaled
-            QPixmap scaledCroppedPixmap = pixmap.scaled(dScaledWidth, dScaledHeight).copy(dLimitsInPixmap);
-            scaledCroppedPixmap.setDevicePixelRatio(dpr);
-            p.drawPixmap( 0, 0, scaledCroppedPixmap );
+            drawPagePixmap( &p, QRectF( QPointF( 0, 0 ), QSizeF( dLimits.size() ) / dpr ), page, observer,
+                            pixmap, pixmapKey, dScaledWidth, dScaledHeight, dLimitsInPixmap );
         }
 
         p.end();
 
         // 4B.2. modify pixmap following accessibility settings
         if ( bufferAccessibility )
-        {
-            switch ( Okular::SettingsCore::renderMode() )
-            {
-                case Okular::SettingsCore::EnumRenderMode::Inverted:
-                    // Invert image pixels using QImage internal function
-                    backImage.invertPixels(QImage::InvertRgb);
-                    break;
-                case Okular::SettingsCore::EnumRenderMode::Recolor:
-                    recolor(&backImage, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
-                    break;
-                case Okular::SettingsCore::EnumRenderMode::BlackWhite:
-                    // Manual Gray and Contrast
-                    unsigned int * data = (unsigned int *)backImage.bits();
-                    int val, pixels = backImage.width() * backImage.height(),
-                        con = Okular::Settings::bWContrast(), thr = 255 - Okular::Settings::bWThreshold();
-                    for( int i = 0; i < pixels; ++i )
-                    {
-                        val = qGray( data[i] );
-                        if ( val > thr )
-                            val = 128 + (127 * (val - thr)) / (255 - thr);
-                        else if ( val < thr )
-                            val = (128 * val) / thr;
-                        if ( con > 2 )
-                        {
-                            val = con * ( val - thr ) / 2 + thr;
-                            if ( val > 255 )
-                                val = 255;
-                            else if ( val < 0 )
-                                val = 0;
-                        }
-                        data[i] = qRgba( val, val, val, 255 );
-                    }
-                    break;
-            }
-        }
+            transformColors( &backImage );
 
         // 4B.3. highlight rects in page
         if ( bufferedHighlights )
@@ -795,6 +810,50 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
 
 
 /** Private Helpers :: Pixmap conversion **/
+void PagePainter::drawPagePixmap( QPainter * painter, const QRectF & target, const Okular::Page * page, Okular::DocumentObserver *observer,
+    const QPixmap & pixmap, qint64 pixmapKey, int dScaledWidth, int dScaledHeight, const QRect & dLimitsInPixmap )
+{
+    // paint only what the page covers, shrinking the target accordingly
+    const QRect source = dLimitsInPixmap & QRect( 0, 0, dScaledWidth, dScaledHeight );
+    if ( source.isEmpty() )
+        return;
+    const double kx = target.width() / dLimitsInPixmap.width();
+    const double ky = target.height() / dLimitsInPixmap.height();
+    const QRectF dest( target.x() + ( source.x() - dLimitsInPixmap.x() ) * kx, target.y() + ( source.y() - dLimitsInPixmap.y() ) * ky,
+                       source.width() * kx, source.height() * ky );
+
+    // 1. the pixmap already has the requested size: blit the exposed part
+    if ( pixmap.width() == dScaledWidth && pixmap.height() == dScaledHeight )
+    {
+        painter->drawPixmap( dest, pixmap, source );
+        return;
+    }
+
+    // 2. a previous paint already rescaled this very pixmap to this size
+    if ( const QPixmap *scaled = page->d->scaledPixmap( observer, pixmapKey, dScaledWidth, dScaledHeight ) )
+    {
+        painter->drawPixmap( dest, *scaled, source );
+        return;
+    }
+
+    // 3. most of the page is exposed: rescale it once and keep it in the
+    // page for the following paints, that are likely to expose the rest of
+    // it, unless memory is scarce
+    if ( Okular::SettingsCore::memoryLevel() != Okular::SettingsCore::EnumMemoryLevel::Low &&
+         (qint64)source.width() * source.height() * 2 >= (qint64)dScaledWidth * dScaledHeight )
+    {
+        QPixmap *scaled = new QPixmap( pixmap.scaled( dScaledWidth, dScaledHeight ) );
+        painter->drawPixmap( dest, *scaled, source );
+        page->d->setScaledPixmap( observer, pixmapKey, scaled );
+        return;
+    }
+
+    // 4. rescale only the exposed part of the pixmap
+    const double xScale = pixmap.width() / (double)dScaledWidth;
+    const double yScale = pixmap.height() / (double)dScaledHeight;
+    painter->drawPixmap( dest, pixmap, QRectF( source.x() * xScale, source.y() * yScale, source.width() * xScale, source.height() * yScale ) );
+}
+
 void PagePainter::cropPixmapOnImage( QImage & dest, const QPixmap * src, const QRect & r )
 {
     qreal dpr = src->devicePixelRatioF();
@@ -826,49 +885,31 @@ void PagePainter::recolor(QImage *image, const QColor &foreground, const QColor
 
     Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
 
-    const float scaleRed = background.redF() - foreground.redF();
-    const float scaleGreen = background.greenF() - foreground.greenF();
-    const float scaleBlue = background.blueF() - foreground.blueF();
-
-    for (int y=0; y<image->height(); y++) {
-        QRgb *pixels = reinterpret_cast<QRgb*>(image->scanLine(y));
+    PagePainterKernels::recolor(image, foreground, background);
+}
 
-        for (int x=0; x<image->width(); x++) {
-            const int lightness = qGray(pixels[x]);
-            pixels[x] = qRgba(scaleRed * lightness + foreground.red(),
-                           scaleGreen * lightness + foreground.green(),
-                           scaleBlue * lightness + foreground.blue(),
-                           qAlpha(pixels[x]));
-        }
+void PagePainter::transformColors( QImage *image )
+{
+    switch ( Okular::SettingsCore::renderMode() )
+    {
+        case Okular::SettingsCore::EnumRenderMode::Inverted:
+            // Invert image pixels using QImage internal function
+            image->invertPixels(QImage::InvertRgb);
+            break;
+        case Okular::SettingsCore::EnumRenderMode::Recolor:
+            recolor(image, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
+            break;
+        case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+            PagePainterKernels::blackWhite( image, Okular::Settings::bWContrast(), 255 - Okular::Settings::bWThreshold() );
+            break;
+        default: ;
     }
 }
 
 /** Private Helpers :: Image Drawing **/
-// from Arthur - qt4
-static inline int qt_div_255(int x) { return (x + (x>>8) + 0x80) >> 8; }
-
 void PagePainter::changeImageAlpha( QImage & image, unsigned int destAlpha )
 {
-    // iterate over all pixels changing the alpha component value
-    unsigned int * data = (unsigned int *)image.bits();
-    unsigned int pixels = image.width() * image.height();
-
-    int source, sourceAlpha;
-    for( unsigned int i = 0; i < pixels; ++i )
-    {   // optimize this loop keeping byte order into account
-        source = data[i];
-        if ( (sourceAlpha = qAlpha( source )) == 255 )
-        {
-            // use destAlpha
-            data[i] = qRgba( qRed(source), qGreen(source), qBlue(source), destAlpha );
-        }
-        else
-        {
-            // use destAlpha * sourceAlpha product
-            sourceAlpha = qt_div_255( destAlpha * sourceAlpha );
-            data[i] = qRgba( qRed(source), qGreen(source), qBlue(source), sourceAlpha );
-        }
-    }
+    PagePainterKernels::changeAlpha( &image, destAlpha );
 }
 
 void PagePainter::drawShapeOnImage(
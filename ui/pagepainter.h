@@ -54,9 +54,16 @@ class Q_DECL_EXPORT PagePainter
             const Okular::NormalizedRect & crop, Okular::NormalizedPoint *viewPortPoint );
 
     private:
+        // draw the 'dLimitsInPixmap' part of the page 'pixmap', as if it were
+        // 'dScaledWidth'x'dScaledHeight' device pixels large, into 'target'
+        static void drawPagePixmap( QPainter * painter, const QRectF & target, const Okular::Page * page, Okular::DocumentObserver *observer,
+            const QPixmap & pixmap, qint64 pixmapKey, int dScaledWidth, int dScaledHeight, const QRect & dLimitsInPixmap );
         static void cropPixmapOnImage( QImage & dest, const QPixmap * src, const QRect & r );
         static void recolor(QImage *image, const QColor &foreground, const QColor &background);
 
+        // apply the color transformation of the accessibility settings
+        static void transformColors( QImage *image );
+
         // set the alpha component of the image to a given value
         static void changeImageAlpha( QImage & image, unsigned int alpha );
 
@@ -0,0 +1,192 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "pagepainterkernels.h"
+
+#include <QColor>
+#include <QImage>
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PAGEPAINTER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#define PAGEPAINTER_NEON
+#include <arm_neon.h>
+#endif
+
+static bool s_simdEnabled = PagePainterKernels::hasSimd();
+
+// from Arthur - qt4
+static inline int qt_div_255( int x ) { return ( x + ( x >> 8 ) + 0x80 ) >> 8; }
+
+#if defined(PAGEPAINTER_SSE2)
+// qGray() of 4 pixels, one in each 32 bit lane
+static inline __m128i grayOf( __m128i pixels )
+{
+    // the 16 bit halves of each lane hold blue and red, multiply and add them at once
+    const __m128i redBlue = _mm_and_si128( pixels, _mm_set1_epi32( 0x00ff00ff ) );
+    const __m128i green = _mm_and_si128( _mm_srli_epi32( pixels, 8 ), _mm_set1_epi32( 0xff ) );
+    const __m128i sum = _mm_add_epi32( _mm_madd_epi16( redBlue, _mm_set1_epi32( ( 11 << 16 ) | 5 ) ), _mm_slli_epi32( green, 4 ) );
+    return _mm_srli_epi32( sum, 5 );
+}
+#elif defined(PAGEPAINTER_NEON)
+// qGray() of 8 pixels, whose channels are stored in b, g, r, a order
+static inline uint8x8_t grayOf( const uint8x8x4_t &pixels )
+{
+    uint16x8_t sum = vmull_u8( pixels.val[2], vdup_n_u8( 11 ) );
+    sum = vmlal_u8( sum, pixels.val[1], vdup_n_u8( 16 ) );
+    sum = vmlal_u8( sum, pixels.val[0], vdup_n_u8( 5 ) );
+    return vshrn_n_u16( sum, 5 );
+}
+#endif
+
+// replace each pixel with the color of its lightness, keeping the pixel alpha if 'keepAlpha'
+static void mapLightness( QRgb *pixels, int count, const QRgb *colors, bool keepAlpha )
+{
+    const QRgb alphaMask = keepAlpha ? 0xff000000 : 0;
+    int i = 0;
+#if defined(PAGEPAINTER_SSE2)
+    if ( s_simdEnabled )
+    {
+        const __m128i alphaMask128 = _mm_set1_epi32( alphaMask );
+        alignas( 16 ) quint32 gray[4];
+        for ( ; i + 4 <= count; i += 4 )
+        {
+            __m128i *p = reinterpret_cast<__m128i *>( pixels + i );
+            const __m128i source = _mm_loadu_si128( p );
+            _mm_store_si128( reinterpret_cast<__m128i *>( gray ), grayOf( source ) );
+            const __m128i mapped = _mm_setr_epi32( colors[gray[0]], colors[gray[1]], colors[gray[2]], colors[gray[3]] );
+            _mm_storeu_si128( p, _mm_or_si128( mapped, _mm_and_si128( source, alphaMask128 ) ) );
+        }
+    }
+#elif defined(PAGEPAINTER_NEON)
+    if ( s_simdEnabled )
+    {
+        uint8_t gray[8];
+        for ( ; i + 8 <= count; i += 8 )
+        {
+            vst1_u8( gray, grayOf( vld4_u8( reinterpret_cast<const uint8_t *>( pixels + i ) ) ) );
+            for ( int j = 0; j < 8; ++j )
+                pixels[i + j] = colors[gray[j]] | ( pixels[i + j] & alphaMask );
+        }
+    }
+#endif
+    for ( ; i < count; ++i )
+        pixels[i] = colors[qGray( pixels[i] )] | ( pixels[i] & alphaMask );
+}
+
+void PagePainterKernels::recolor( QImage *image, const QColor &foreground, const QColor &background )
+{
+    const float scaleRed = background.redF() - foreground.redF();
+    const float scaleGreen = background.greenF() - foreground.greenF();
+    const float scaleBlue = background.blueF() - foreground.blueF();
+
+    // the new color only depends on the pixel lightness, compute all of them upfront
+    QRgb colors[256];
+    for ( int lightness = 0; lightness < 256; ++lightness )
+    {
+        colors[lightness] = qRgba( scaleRed * lightness + foreground.red(),
+                                   scaleGreen * lightness + foreground.green(),
+                                   scaleBlue * lightness + foreground.blue(),
+                                   0 );
+    }
+
+    mapLightness( reinterpret_cast<QRgb *>( image->bits() ), image->width() * image->height(), colors, true );
+}
+
+void PagePainterKernels::blackWhite( QImage *image, int contrast, int threshold )
+{
+    // Manual Gray and Contrast
+    QRgb grays[256];
+    for ( int gray = 0; gray < 256; ++gray )
+    {
+        int val = gray;
+        if ( val > threshold )
+            val = 128 + (127 * (val - threshold)) / (255 - threshold);
+        else if ( val < threshold )
+            val = (128 * val) / threshold;
+        if ( contrast > 2 )
+        {
+            val = contrast * ( val - threshold ) / 2 + threshold;
+            if ( val > 255 )
+                val = 255;
+            else if ( val < 0 )
+                val = 0;
+        }
+        grays[gray] = qRgba( val, val, val, 255 );
+    }
+
+    mapLightness( reinterpret_cast<QRgb *>( image->bits() ), image->width() * image->height(), grays, false );
+}
+
+void PagePainterKernels::changeAlpha( QImage *image, unsigned int alpha )
+{
+    QRgb *pixels = reinterpret_cast<QRgb *>( image->bits() );
+    const int count = image->width() * image->height();
+
+    // opaque pixels take 'alpha', the others the product of the two alphas
+    uchar alphas[256];
+    for ( int sourceAlpha = 0; sourceAlpha < 255; ++sourceAlpha )
+        alphas[sourceAlpha] = qt_div_255( alpha * sourceAlpha );
+    alphas[255] = alpha;
+
+    int i = 0;
+    // qt_div_255( alpha * 255 ) == alpha for any alpha up to 255, so the
+    // vectorized code does not need to special case the opaque pixels
+#if defined(PAGEPAINTER_SSE2)
+    if ( s_simdEnabled && alpha <= 255 )
+    {
+        const __m128i factor = _mm_set1_epi32( alpha );
+        const __m128i half = _mm_set1_epi32( 0x80 );
+        const __m128i colorMask = _mm_set1_epi32( 0x00ffffff );
+        for ( ; i + 4 <= count; i += 4 )
+        {
+            __m128i *p = reinterpret_cast<__m128i *>( pixels + i );
+            const __m128i source = _mm_loadu_si128( p );
+            // the products fit in the low 16 bit half of each lane
+            __m128i product = _mm_mullo_epi16( _mm_srli_epi32( source, 24 ), factor );
+            product = _mm_add_epi16( _mm_add_epi16( product, _mm_srli_epi16( product, 8 ) ), half );
+            const __m128i newAlpha = _mm_slli_epi32( _mm_srli_epi16( product, 8 ), 24 );
+            _mm_storeu_si128( p, _mm_or_si128( _mm_and_si128( source, colorMask ), newAlpha ) );
+        }
+    }
+#elif defined(PAGEPAINTER_NEON)
+    if ( s_simdEnabled && alpha <= 255 )
+    {
+        const uint8x8_t factor = vdup_n_u8( alpha );
+        const uint16x8_t half = vdupq_n_u16( 0x80 );
+        for ( ; i + 8 <= count; i += 8 )
+        {
+            uint8_t *p = reinterpret_cast<uint8_t *>( pixels + i );
+            uint8x8x4_t source = vld4_u8( p );
+            uint16x8_t product = vmull_u8( source.val[3], factor );
+            product = vaddq_u16( vaddq_u16( product, vshrq_n_u16( product, 8 ) ), half );
+            source.val[3] = vshrn_n_u16( product, 8 );
+            vst4_u8( p, source );
+        }
+    }
+#endif
+    for ( ; i < count; ++i )
+        pixels[i] = ( pixels[i] & 0x00ffffff ) | ( uint( alphas[qAlpha( pixels[i] )] ) << 24 );
+}
+
+bool PagePainterKernels::hasSimd()
+{
+#if defined(PAGEPAINTER_SSE2) || defined(PAGEPAINTER_NEON)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PagePainterKernels::setSimdEnabled( bool enabled )
+{
+    s_simdEnabled = enabled && hasSimd();
+}
@@ -0,0 +1,42 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef OKULAR_PAGEPAINTERKERNELS_H
+#define OKULAR_PAGEPAINTERKERNELS_H
+
+class QColor;
+class QImage;
+
+/**
+ * The per pixel operations of the accessibility render modes.
+ *
+ * They work in place on 32 bit images, using SSE2 or NEON when the CPU
+ * has them and producing exactly the same pixels as the plain C++ code.
+ */
+namespace PagePainterKernels
+{
+    // replace the lightness of each pixel by a color in the
+    // foreground-background range, keeping its alpha
+    void recolor( QImage *image, const QColor &foreground, const QColor &background );
+
+    // turn the image into opaque grays, stretching them around the
+    // 'threshold' gray level and applying 'contrast' if bigger than 2
+    void blackWhite( QImage *image, int contrast, int threshold );
+
+    // multiply the alpha of each pixel by 'alpha' / 255
+    void changeAlpha( QImage *image, unsigned int alpha );
+
+    // whether vectorized kernels are available for this CPU
+    bool hasSimd();
+
+    // enable or disable the vectorized kernels, mostly for testing
+    void setSimdEnabled( bool enabled );
+}
+
+#endif
@@ -63,6 +63,8 @@
 // system includes
 #include <math.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <climits>
 
 // local includes
 #include "debug_ui.h"
@@ -75,6 +77,7 @@
 #include "annotationpopup.h"
 #include "pageviewannotator.h"
 #include "pageviewmouseannotation.h"
+#include "prefetchplanner.h"
 #include "priorities.h"
 #include "toolaction.h"
 #include "okmenutitle.h"
@@ -195,6 +198,17 @@ public:
 #endif
     QTimer * refreshTimer;
     QSet<int> refreshPages;
+    // pages whose form and video widgets wait for the page details to be loaded
+    QSet<int> pagesWithPendingWidgets;
+    // the items that have form or video widgets to keep in place while scrolling
+    QSet<PageViewItem *> itemsWithWidgets;
+    // the visible items sorted by top, with the farthest bottom reached up to each of them
+    QVector<PageViewItem *> layoutItems;
+    QVector<int> layoutTops;
+    QVector<int> layoutBottoms;
+    // where the user is scrolling to, to choose the pages to preload
+    PrefetchPlanner prefetchPlanner;
+    QElapsedTimer scrollClock;
 
     // bbox state for Trim to Selection mode
     Okular::NormalizedRect trimBoundingBox;
@@ -362,6 +376,7 @@ PageView::PageView( QWidget *parent, Okular::Document *document )
     d->m_tts = nullptr;
 #endif
     d->refreshTimer = nullptr;
+    d->scrollClock.start();
     d->aRotateClockwise = nullptr;
     d->aRotateCounterClockwise = nullptr;
     d->aRotateOriginal = nullptr;
@@ -994,6 +1009,30 @@ void PageView::selectAll()
     }
 }
 
+bool PageView::createPageWidgets( PageViewItem *item, const Okular::Page *page, bool allowfillforms )
+{
+    bool hasformwidgets = false;
+    const QLinkedList< Okular::FormField * > pageFields = page->formFields();
+    for ( Okular::FormField * ff : pageFields )
+    {
+        FormWidgetIface * w = FormWidgetFactory::createWidget( ff, viewport() );
+        if ( w )
+        {
+            w->setPageItem( item );
+            w->setFormWidgetsController( d->formWidgetsController() );
+            w->setVisibility( false );
+            w->setCanBeFilled( allowfillforms );
+            item->formWidgets().insert( w );
+            hasformwidgets = true;
+        }
+    }
+
+    createAnnotationsVideoWidgets( item, page->annotations() );
+    if ( hasformwidgets )
+        d->itemsWithWidgets.insert( item );
+    return hasformwidgets;
+}
+
 void PageView::createAnnotationsVideoWidgets(PageViewItem *item, const QLinkedList< Okular::Annotation * > &annotations)
 {
     qDeleteAll( item->videoWidgets() );
@@ -1027,6 +1066,9 @@ void PageView::createAnnotationsVideoWidgets(PageViewItem *item, const QLinkedLi
             }
         }
     }
+
+    if ( !item->videoWidgets().isEmpty() )
+        d->itemsWithWidgets.insert( item );
 }
 
 //BEGIN DocumentObserver inherited methods
@@ -1129,6 +1171,10 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
     qDeleteAll( d->items );
     d->items.clear();
     d->visibleItems.clear();
+    d->itemsWithWidgets.clear();
+    d->layoutItems.clear();
+    d->layoutTops.clear();
+    d->layoutBottoms.clear();
     d->pagesWithTextSelection.clear();
     toggleFormWidgets( false );
     if ( d->formsWidgetController )
@@ -1136,6 +1182,7 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
 
     bool haspages = !pageSet.isEmpty();
     bool hasformwidgets = false;
+    d->pagesWithPendingWidgets.clear();
     // create children widgets
     for ( const Okular::Page * page : pageSet )
     {
@@ -1144,22 +1191,16 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
 #ifdef PAGEVIEW_DEBUG
         qCDebug(OkularUiDebug).nospace() << "cropped geom for " << d->items.last()->pageNumber() << " is " << d->items.last()->croppedGeometry();
 #endif
-        const QLinkedList< Okular::FormField * > pageFields = page->formFields();
-        for ( Okular::FormField * ff : pageFields )
+        // the widgets of pages without details are created when they get loaded
+        if ( page->detailsLoaded() )
         {
-            FormWidgetIface * w = FormWidgetFactory::createWidget( ff, viewport() );
-            if ( w )
-            {
-                w->setPageItem( item );
-                w->setFormWidgetsController( d->formWidgetsController() );
-                w->setVisibility( false );
-                w->setCanBeFilled( allowfillforms );
-                item->formWidgets().insert( w );
+            if ( createPageWidgets( item, page, allowfillforms ) )
                 hasformwidgets = true;
-            }
         }
-
-        createAnnotationsVideoWidgets( item, page->annotations() );
+        else
+        {
+            d->pagesWithPendingWidgets.insert( page->number() );
+        }
     }
 
     // invalidate layout so relayout/repaint will happen on next viewport change
@@ -1400,6 +1441,25 @@ void PageView::notifyPageChanged( int pageNumber, int changedFlags )
     if ( changedFlags & DocumentObserver::Bookmark )
         return;
 
+    // the details of the page got loaded, create the widgets for them
+    if ( ( changedFlags & DocumentObserver::Annotations ) && d->pagesWithPendingWidgets.remove( pageNumber ) )
+    {
+        const Okular::Page *page = d->document->page( pageNumber );
+        PageViewItem *item = d->items.value( pageNumber );
+        // nothing to create for the pages without forms nor annotations
+        if ( item && ( !page->formFields().isEmpty() || !page->annotations().isEmpty() ) )
+        {
+            const bool allowfillforms = d->document->isAllowed( Okular::AllowFillForms );
+            if ( createPageWidgets( item, page, allowfillforms ) && d->aToggleForms )
+                d->aToggleForms->setEnabled( true );
+
+            // size them like the ones of the other pages, slotRequestVisiblePixmaps() will place them
+            item->setWHZC( item->croppedWidth(), item->croppedHeight(), item->zoomFactor(), item->crop() );
+            item->setFormWidgetsVisible( d->m_formsVisible );
+            QMetaObject::invokeMethod( this, "slotRequestVisiblePixmaps", Qt::QueuedConnection );
+        }
+    }
+
     if ( changedFlags & DocumentObserver::Annotations )
     {
         const QLinkedList< Okular::Annotation * > annots = d->document->page( pageNumber )->annotations();
@@ -1439,6 +1499,18 @@ void PageView::notifyPageChanged( int pageNumber, int changedFlags )
         return;
     }
 
+    if ( changedFlags & DocumentObserver::Size )
+    {
+        // the pages resized together are laid out with a single delayed relayout,
+        // which requests the pixmaps of the visible pages too
+        if ( !d->dirtyLayout )
+        {
+            d->dirtyLayout = true;
+            QMetaObject::invokeMethod( this, "slotRelayoutPages", Qt::QueuedConnection );
+        }
+        return;
+    }
+
     // iterate over visible items: if page(pageNumber) is one of them, repaint it
     for ( const PageViewItem * visibleItem : qAsConst( d->visibleItems ) )
         if ( visibleItem->pageNumber() == pageNumber && visibleItem->isVisible() )
@@ -3851,6 +3923,50 @@ void PageView::updateItemSize( PageViewItem * item, int colWidth, int rowHeight
 #endif
 }
 
+void PageView::updateLayoutIndex()
+{
+    d->layoutItems.clear();
+    for ( PageViewItem * item : qAsConst( d->items ) )
+    {
+        if ( item->isVisible() )
+            d->layoutItems.append( item );
+    }
+    std::stable_sort( d->layoutItems.begin(), d->layoutItems.end(), [] ( const PageViewItem *a, const PageViewItem *b ) {
+        return a->croppedGeometry().top() < b->croppedGeometry().top();
+    } );
+
+    // the bottoms only grow, so that the first item reaching a given height can be binary searched
+    d->layoutTops.resize( d->layoutItems.count() );
+    d->layoutBottoms.resize( d->layoutItems.count() );
+    int bottom = INT_MIN;
+    for ( int i = 0; i < d->layoutItems.count(); ++i )
+    {
+        const QRect &geometry = d->layoutItems.at( i )->croppedGeometry();
+        bottom = qMax( bottom, geometry.bottom() );
+        d->layoutTops[ i ] = geometry.top();
+        d->layoutBottoms[ i ] = bottom;
+    }
+}
+
+QVector< PageViewItem * > PageView::itemsInRows( int top, int bottom ) const
+{
+    // the items starting above 'bottom' and not all ending above 'top'
+    const int first = std::lower_bound( d->layoutBottoms.constBegin(), d->layoutBottoms.constEnd(), top ) - d->layoutBottoms.constBegin();
+    const int last = std::upper_bound( d->layoutTops.constBegin(), d->layoutTops.constEnd(), bottom ) - d->layoutTops.constBegin();
+
+    QVector< PageViewItem * > items;
+    for ( int i = first; i < last; ++i )
+    {
+        const QRect &geometry = d->layoutItems.at( i )->croppedGeometry();
+        if ( geometry.top() <= bottom && geometry.bottom() >= top )
+            items.append( d->layoutItems.at( i ) );
+    }
+    std::sort( items.begin(), items.end(), [] ( const PageViewItem *a, const PageViewItem *b ) {
+        return a->pageNumber() < b->pageNumber();
+    } );
+    return items;
+}
+
 PageViewItem * PageView::pickItemOnPoint( int x, int y )
 {
     PageViewItem * item = nullptr;
@@ -4772,6 +4888,10 @@ void PageView::slotRelayoutPages()
         delete [] colWidth;
         delete [] rowHeight;
 
+    updateLayoutIndex();
+    // the scroll positions of the previous layout mean nothing now
+    d->prefetchPlanner.reset();
+
     // 3) reset dirty state
     d->dirtyLayout = false;
 
@@ -4820,8 +4940,26 @@ void PageView::delayedResizeEvent()
     slotRequestVisiblePixmaps();
 }
 
-static void slotRequestPreloadPixmap( Okular::DocumentObserver * observer, const PageViewItem * i, const QRect &expandedViewportRect, QLinkedList< Okular::PixmapRequest * > *requestedPixmaps )
+// low resolution previews are this fraction of the page size
+static const double previewScale = 0.25;
+
+static void slotRequestPreloadPixmap( Okular::DocumentObserver * observer, const PageViewItem * i, const QRect &expandedViewportRect, QLinkedList< Okular::PixmapRequest * > *requestedPixmaps, bool lowResolution = false )
 {
+    // a preview is enough for pages that are going to scroll by quickly,
+    // any pixmap the page already has is as good for that; flagged as such the
+    // document drops it once the page got a better pixmap meanwhile
+    if ( lowResolution && !i->page()->hasTilesManager( observer ) )
+    {
+        if ( !i->page()->hasPixmap( observer ) && i->uncroppedWidth() > 0 )
+        {
+            const int width = qMax( 1, qRound( i->uncroppedWidth() * previewScale ) );
+            const int height = qMax( 1, qRound( i->uncroppedHeight() * previewScale ) );
+            Okular::PixmapRequest * p = new Okular::PixmapRequest( observer, i->pageNumber(), width, height, PAGEVIEW_PRELOAD_PRIO, Okular::PixmapRequest::Preload | Okular::PixmapRequest::Preview | Okular::PixmapRequest::Asynchronous );
+            requestedPixmaps->push_back( p );
+        }
+        return;
+    }
+
     Okular::NormalizedRect preRenderRegion;
     const QRect intersectionRect = expandedViewportRect.intersected( i->croppedGeometry() );
     if ( !intersectionRect.isEmpty() )
@@ -4873,11 +5011,8 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
     // Margin (in pixels) around the viewport to preload
     const int pixelsToExpand = 512;
 
-    // iterate over all items
-    d->visibleItems.clear();
-    QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
-    QVector< Okular::VisiblePageRect * > visibleRects;
-    for ( PageViewItem * i : qAsConst( d->items ) )
+    // keep the form and video widgets on their pages
+    for ( PageViewItem * i : qAsConst( d->itemsWithWidgets ) )
     {
         const QSet<FormWidgetIface *> formWidgetsList = i->formWidgets();
         for ( FormWidgetIface *fwi :  formWidgetsList)
@@ -4900,7 +5035,15 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
                 vw->pageLeft();
             }
         }
+    }
 
+    // iterate over the items in the rows of the viewport
+    d->visibleItems.clear();
+    QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
+    QVector< Okular::VisiblePageRect * > visibleRects;
+    const QVector< PageViewItem * > rowItems = itemsInRows( viewportRect.top(), viewportRect.bottom() );
+    for ( PageViewItem * i : rowItems )
+    {
         if ( !i->isVisible() )
             continue;
 #ifdef PAGEVIEW_DEBUG
@@ -4976,31 +5119,36 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
          Okular::SettingsCore::memoryLevel() != Okular::SettingsCore::EnumMemoryLevel::Low )
     {
         // as the requests are done in the order as they appear in the list,
-        // request first the next page and then the previous
-
-        int pagesToPreload = viewColumns();
+        // request first the pages in the scrolling direction, by default the next ones
+        const int firstVisible = d->visibleItems.first()->pageNumber();
+        const int lastVisible = d->visibleItems.last()->pageNumber();
+        if ( isEvent )
+            d->prefetchPlanner.addPosition( viewportRect.top(), d->scrollClock.elapsed() );
+        PrefetchPlanner::Plan plan = d->prefetchPlanner.plan( d->scrollClock.elapsed(), viewColumns(), d->visibleItems.first()->croppedHeight(), viewportRect.height() );
 
         // if the greedy option is set, preload all pages
         if (Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Greedy)
-            pagesToPreload = d->items.count();
+        {
+            plan.pagesAfter = d->items.count();
+            plan.pagesBefore = d->items.count();
+        }
 
         const QRect expandedViewportRect = viewportRect.adjusted( 0, -pixelsToExpand, 0, pixelsToExpand );
 
+        const int pagesToPreload = qMax( plan.pagesAfter, plan.pagesBefore );
         for( int j = 1; j <= pagesToPreload; j++ )
         {
-            // add the page after the 'visible series' in preload
-            const int tailRequest = d->visibleItems.last()->pageNumber() + j;
-            if ( tailRequest < (int)d->items.count() )
-            {
-                slotRequestPreloadPixmap( this, d->items[ tailRequest ], expandedViewportRect, &requestedPixmaps );
-            }
-
-            // add the page before the 'visible series' in preload
-            const int headRequest = d->visibleItems.first()->pageNumber() - j;
-            if ( headRequest >= 0 )
-            {
-                slotRequestPreloadPixmap( this, d->items[ headRequest ], expandedViewportRect, &requestedPixmaps );
-            }
+            // add the pages after and before the 'visible series' in preload
+            const int tailRequest = lastVisible + j;
+            const int headRequest = firstVisible - j;
+            const bool wantTail = j <= plan.pagesAfter && tailRequest < (int)d->items.count();
+            const bool wantHead = j <= plan.pagesBefore && headRequest >= 0;
+            if ( wantTail && plan.afterFirst )
+                slotRequestPreloadPixmap( this, d->items[ tailRequest ], expandedViewportRect, &requestedPixmaps, plan.lowResolution );
+            if ( wantHead )
+                slotRequestPreloadPixmap( this, d->items[ headRequest ], expandedViewportRect, &requestedPixmaps, plan.lowResolution );
+            if ( wantTail && !plan.afterFirst )
+                slotRequestPreloadPixmap( this, d->items[ tailRequest ], expandedViewportRect, &requestedPixmaps, plan.lowResolution );
 
             // stop if we've already reached both ends of the document
             if ( headRequest < 0 && tailRequest >= (int)d->items.count() )
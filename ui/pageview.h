@@ -167,6 +167,10 @@ Q_OBJECT
         void updateItemSize( PageViewItem * item, int colWidth, int rowHeight );
         // return the widget placed on a certain point or 0 if clicking on empty space
         PageViewItem * pickItemOnPoint( int x, int y );
+        // index the visible items by their vertical position, after a relayout
+        void updateLayoutIndex();
+        // the visible items between the content area rows top and bottom, in page order
+        QVector< PageViewItem * > itemsInRows( int top, int bottom ) const;
         // start / modify / clear selection rectangle
         void selectionStart( const QPoint & pos, const QColor & color, bool aboveAll = false );
         void selectionClear( const ClearMode mode = ClearAllSelection );
@@ -212,6 +216,7 @@ Q_OBJECT
         // handle link clicked
         bool mouseReleaseOverLink( const Okular::ObjectRect * rect ) const;
 
+        bool createPageWidgets( PageViewItem *item, const Okular::Page *page, bool allowfillforms );
         void createAnnotationsVideoWidgets(PageViewItem *item, const QLinkedList< Okular::Annotation * > &annotations);
 
         // don't want to expose classes in here
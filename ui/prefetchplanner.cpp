@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "prefetchplanner.h"
+
+#include <QtGlobal>
+
+#include <cmath>
+
+// the velocity is measured over the last positions in this window
+static const qint64 velocityWindow = 300;
+// scrolling is considered stopped if the position did not change for this long
+static const qint64 stoppedDelay = 200;
+// how far ahead in time the preloaded pages should reach
+static const double lookAheadSeconds = 0.75;
+// the most pages preloaded ahead, in multiples of the base pages
+static const int maximumPagesFactor = 10;
+// viewports per second above which the previews are asked at low resolution
+static const double lowResolutionSpeed = 3.0;
+
+PrefetchPlanner::PrefetchPlanner()
+{
+}
+
+void PrefetchPlanner::addPosition( int position, qint64 msecs )
+{
+    if ( !m_positions.isEmpty() && m_positions.last().second == position )
+        return;
+
+    m_positions.append( qMakePair( msecs, position ) );
+
+    // keep one position older than the window, as start of the measure
+    int outdated = 0;
+    while ( outdated + 1 < m_positions.count() && msecs - m_positions.at( outdated + 1 ).first > velocityWindow )
+        ++outdated;
+    m_positions.remove( 0, outdated );
+}
+
+void PrefetchPlanner::reset()
+{
+    m_positions.clear();
+}
+
+double PrefetchPlanner::velocity( qint64 msecs ) const
+{
+    if ( m_positions.count() < 2 || msecs - m_positions.last().first > stoppedDelay )
+        return 0;
+
+    const QPair< qint64, int > &first = m_positions.first();
+    const QPair< qint64, int > &last = m_positions.last();
+    const qint64 elapsed = qMax( last.first - first.first, qint64( 1 ) );
+    return ( last.second - first.second ) * 1000.0 / elapsed;
+}
+
+PrefetchPlanner::Plan PrefetchPlanner::plan( qint64 msecs, int basePages, int pageHeight, int viewportHeight ) const
+{
+    Plan plan = { basePages, basePages, true, false };
+
+    const double speed = velocity( msecs );
+    if ( speed == 0 || pageHeight <= 0 )
+        return plan;
+
+    // the pages that will scroll by while the next ones get rendered go ahead,
+    // as many less go behind, where the user is not going back to right now
+    const int extra = static_cast< int >( std::ceil( std::fabs( speed ) * lookAheadSeconds / pageHeight ) );
+    const int ahead = qMin( basePages + extra, basePages * maximumPagesFactor );
+    const int behind = qMax( 0, basePages - extra );
+
+    plan.afterFirst = speed > 0;
+    plan.pagesAfter = plan.afterFirst ? ahead : behind;
+    plan.pagesBefore = plan.afterFirst ? behind : ahead;
+    plan.lowResolution = viewportHeight > 0 && std::fabs( speed ) > lowResolutionSpeed * viewportHeight;
+    return plan;
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef OKULAR_PREFETCHPLANNER_H
+#define OKULAR_PREFETCHPLANNER_H
+
+#include <QPair>
+#include <QVector>
+
+/**
+ * Decides how many pages PageView preloads around the visible ones.
+ *
+ * It follows the recent vertical scroll positions to know where and how
+ * fast the user is going: the faster the scrolling, the more pages are
+ * preloaded ahead and the fewer behind, and when going really fast the
+ * preloaded pages are asked at low resolution first.
+ */
+class PrefetchPlanner
+{
+    public:
+        struct Plan
+        {
+            // pages to preload after the visible ones
+            int pagesAfter;
+            // pages to preload before the visible ones
+            int pagesBefore;
+            // whether the pages after should be requested first
+            bool afterFirst;
+            // whether to request low resolution previews of the preloaded pages
+            bool lowResolution;
+        };
+
+        PrefetchPlanner();
+
+        // the vertical scroll position was 'position' at 'msecs'
+        void addPosition( int position, qint64 msecs );
+
+        // forget the scroll history, e.g. when the zoom or the layout changes
+        void reset();
+
+        // the scrolling speed at 'msecs' in pixels per second, positive when going down
+        double velocity( qint64 msecs ) const;
+
+        // the preload plan at 'msecs' for 'basePages' pages preloaded when not
+        // scrolling, with pages of about 'pageHeight' pixels in a viewport
+        // 'viewportHeight' pixels high
+        Plan plan( qint64 msecs, int basePages, int pageHeight, int viewportHeight ) const;
+
+    private:
+        // (msecs, position) pairs, oldest first
+        QVector< QPair< qint64, int > > m_positions;
+};
+
+#endif
@@ -73,7 +73,9 @@ public:
     ~SignatureModelPrivate() override;
 
     void notifySetup( const QVector<Okular::Page *> &pages, int setupFlags ) override;
+    void notifyPageChanged( int page, int flags ) override;
 
+    void resetItems();
     QModelIndex indexForItem( SignatureItem *item ) const;
 
     SignatureModel *q;
@@ -124,12 +126,33 @@ void SignatureModelPrivate::notifySetup( const QVector<Okular::Page*> &pages, in
         return;
     }
 
+    resetItems();
+}
+
+void SignatureModelPrivate::notifyPageChanged( int page, int flags )
+{
+    // the form fields of the page may have been loaded after the document was set up
+    if ( !( flags & Okular::DocumentObserver::Annotations ) )
+        return;
+
+    for ( const SignatureItem *item : qAsConst( root->children ) )
+    {
+        if ( item->page == page )
+            return;
+    }
+
+    if ( !SignatureGuiUtils::getSignatureFormFields( document, false, page ).isEmpty() )
+        resetItems();
+}
+
+void SignatureModelPrivate::resetItems()
+{
     q->beginResetModel();
     qDeleteAll( root->children );
     root->children.clear();
-    for ( const Okular::Page *page : pages )
+    const int pageCount = document->pages();
+    for ( int currentPage = 0; currentPage < pageCount; ++currentPage )
     {
-        const int currentPage = page->number();
         // get form fields page by page so that page number and index of the form can be determined.
         const QVector<const Okular::FormFieldSignature*> signatureFormFields = SignatureGuiUtils::getSignatureFormFields( document, false, currentPage );
         if ( signatureFormFields.isEmpty() )
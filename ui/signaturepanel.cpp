@@ -107,6 +107,17 @@ void SignaturePanel::notifySetup( const QVector<Okular::Page *> &/*pages*/, int
     emit documentHasSignatures( !signatureForms.isEmpty() );
 }
 
+void SignaturePanel::notifyPageChanged( int page, int flags )
+{
+    // the form fields of the page may have been loaded after the document was set up
+    if ( !( flags & Okular::DocumentObserver::Annotations ) )
+        return;
+
+    Q_D( SignaturePanel );
+    if ( !SignatureGuiUtils::getSignatureFormFields( d->m_document, false, page ).isEmpty() )
+        emit documentHasSignatures( true );
+}
+
 SignaturePanel::~SignaturePanel()
 {
     Q_D( SignaturePanel );
@@ -32,6 +32,7 @@ class SignaturePanel : public QWidget, public Okular::DocumentObserver
 
         // inherited from DocumentObserver
         void notifySetup( const QVector<Okular::Page *> &pages, int setupFlags ) override;
+        void notifyPageChanged( int page, int flags ) override;
 
         void setPageView( PageView *pv );
 
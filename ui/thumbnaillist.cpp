@@ -63,9 +63,14 @@ class ThumbnailListPrivate : public QWidget
         QPoint m_mouseGrabPos;
         ThumbnailWidget *m_mouseGrabItem;
         int m_pageCurrentlyGrabbed;
+        bool m_relayoutPending;
 
         // resize thumbnails to fit the width
         void viewportResizeEvent( QResizeEvent * );
+        // resize and reposition the thumbnails and the contents area
+        void relayoutThumbnails();
+        // relayout once the pages resized together have all been notified
+        void delayedRelayoutThumbnails();
         // called by ThumbnailWidgets to get the overlay bookmark pixmap
         const QPixmap * getBookmarkOverlay() const;
         // called by ThumbnailWidgets to send (forward) the mouse move signals
@@ -143,7 +148,7 @@ class ThumbnailWidget
 
 ThumbnailListPrivate::ThumbnailListPrivate( ThumbnailList *qq, Okular::Document *document )
     : QWidget(), q( qq ), m_document( document ), m_selected( nullptr ),
-    m_delayTimer( nullptr ), m_bookmarkOverlay( nullptr ), m_vectorIndex( 0 )
+    m_delayTimer( nullptr ), m_bookmarkOverlay( nullptr ), m_vectorIndex( 0 ), m_relayoutPending( false )
 {
     setMouseTracking( true );
     m_mouseGrabItem = nullptr;
@@ -339,6 +344,13 @@ void ThumbnailList::notifyCurrentPageChanged( int previousPage, int currentPage
 void ThumbnailList::notifyPageChanged( int pageNumber, int changedFlags )
 {
     static const int interestingFlags = DocumentObserver::Pixmap | DocumentObserver::Bookmark | DocumentObserver::Highlights | DocumentObserver::Annotations;
+    // the thumbnail of a resized page gets a new height, move the following ones
+    if ( changedFlags & DocumentObserver::Size )
+    {
+        d->delayedRelayoutThumbnails();
+        return;
+    }
+
     // only handle change notifications we are interested in
     if ( !( changedFlags & interestingFlags ) )
         return;
@@ -561,29 +573,7 @@ void ThumbnailListPrivate::viewportResizeEvent( QResizeEvent * e )
         // runs the timer avoiding a thumbnail regeneration by 'contentsMoving'
         delayedRequestVisiblePixmaps( 2000 );
 
-        // resize and reposition items
-        const int newWidth = q->viewport()->width();
-        int newHeight = 0;
-        QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-        for ( ; tIt != tEnd; ++tIt )
-        {
-            ThumbnailWidget *t = *tIt;
-            t->move(0, newHeight);
-            t->resizeFitWidth( newWidth );
-            newHeight += t->height() + this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
-        }
-
-        // update scrollview's contents size (sets scrollbars limits)
-        newHeight -= this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
-        const int oldHeight = q->widget()->height();
-        const int oldYCenter = q->verticalScrollBar()->value() + q->viewport()->height() / 2;
-        q->widget()->resize( newWidth, newHeight );
-
-        // enable scrollbar when there's something to scroll
-        q->verticalScrollBar()->setEnabled( q->viewport()->height() < newHeight );
-
-        // ensure that what was visible before remains visible now
-        q->ensureVisible( 0, int( (qreal)oldYCenter * q->widget()->height() / oldHeight ), 0, q->viewport()->height() / 2 );
+        relayoutThumbnails();
     }
     else if ( e->size().height() <= e->oldSize().height() )
         return;
@@ -598,6 +588,49 @@ void ThumbnailListPrivate::viewportResizeEvent( QResizeEvent * e )
     // update Thumbnails since width has changed or height has increased
     delayedRequestVisiblePixmaps( 500 );
 }
+
+void ThumbnailListPrivate::relayoutThumbnails()
+{
+    // resize and reposition items
+    const int newWidth = q->viewport()->width();
+    int newHeight = 0;
+    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
+    for ( ; tIt != tEnd; ++tIt )
+    {
+        ThumbnailWidget *t = *tIt;
+        t->move(0, newHeight);
+        t->resizeFitWidth( newWidth );
+        newHeight += t->height() + this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+    }
+
+    // update scrollview's contents size (sets scrollbars limits)
+    newHeight -= this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+    const int oldHeight = q->widget()->height();
+    const int oldYCenter = q->verticalScrollBar()->value() + q->viewport()->height() / 2;
+    q->widget()->resize( newWidth, newHeight );
+
+    // enable scrollbar when there's something to scroll
+    q->verticalScrollBar()->setEnabled( q->viewport()->height() < newHeight );
+
+    // ensure that what was visible before remains visible now
+    q->ensureVisible( 0, int( (qreal)oldYCenter * q->widget()->height() / oldHeight ), 0, q->viewport()->height() / 2 );
+}
+
+void ThumbnailListPrivate::delayedRelayoutThumbnails()
+{
+    if ( m_relayoutPending )
+        return;
+
+    m_relayoutPending = true;
+    QTimer::singleShot( 0, this, [this] {
+        m_relayoutPending = false;
+        if ( m_thumbnails.isEmpty() || width() < 1 )
+            return;
+
+        relayoutThumbnails();
+        delayedRequestVisiblePixmaps();
+    } );
+}
 //END widget events
 
 //BEGIN internal SLOTS